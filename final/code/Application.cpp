@@ -13,6 +13,8 @@
 
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <utility>
 #include <vector>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +37,8 @@
 
 #include "Buffers.h"
 #include "Canvas.h"
+#include "GeometryCache.h"
+#include "GeometryMemory.h"
 #include "Lighting.h"
 #include "Materials.h"
 #include "Models.h"
@@ -55,8 +59,20 @@ static const char *fs_p = "phong.frag";
 static const char *vs_t = "texture.vert";
 static const char *fs_t = "texture.frag";
 
-// our Canvas
-static Canvas *canvas;
+// our Canvases, one per shape, so that the shapes can be built at
+// the same time
+static Canvas *canvas[N_OBJECTS];
+
+// our meshes share most of their vertices between triangles, so
+// only upload each distinct vertex once
+static const bool weldShapes = true;
+
+// where the built shapes are kept between runs (see GeometryCache.h)
+static const char *cacheDir = "geocache";
+
+// where the report of the memory our shapes hold is written (see
+// GeometryMemory.h)
+static const char *memReport = "geomemory.json";
 
 // buffers for our shapes
 static BufferSet buffers[N_OBJECTS];
@@ -195,20 +211,101 @@ GLFWwindow *w_window;
 // PRIVATE FUNCTIONS
 //
 
+///
+/// Report the memory one of our shapes holds
+///
+/// @param obj     - the shape
+/// @param extra   - other CPU memory (bytes) it is using just now
+///
+static void recordMemory( int obj, size_t extra )
+{
+    size_t used = extra, reserved = extra;
+
+    canvas[obj]->memoryUsage( used, reserved );
+    if( buffers[obj].getMesh() != NULL ) {
+        buffers[obj].getMesh()->memoryUsage( used, reserved );
+    }
+    memRecord( objects[obj], MemStaging, used, reserved );
+
+    size_t gpu = buffers[obj].vSize + buffers[obj].eSize;
+    memRecord( objects[obj], MemGPU, gpu, gpu );
+}
+
 ///
 /// Create our shapes
 ///
-/// @param C  - the Canvas to use when drawing the objects
+/// @param C  - the Canvases to use when drawing the objects, one per
+///             object
 ///
-static void createImage( Canvas &C )
+static void createImage( Canvas *C[] )
 {
-    createObject( C, Quad,     buffers[Quad] );
-    createObject( C, Cylinder, buffers[Cylinder] );
-    createObject( C, Discs,    buffers[Discs] );
-    createObject( C, Teapot,    buffers[Teapot] );
-    createObject( C, Cube,    buffers[Cube] );
-    createObject( C, Basket,    buffers[Basket] );
-    createObject( C, Sphere,    buffers[Sphere] );
+    uint64_t key[N_OBJECTS];
+    string path[N_OBJECTS];
+    CachedMesh cached[N_OBJECTS];
+    bool hit[N_OBJECTS];
+
+    // the shapes that aren't in the cache, and their Canvases
+    Object objs[N_OBJECTS];
+    Canvas *build[N_OBJECTS];
+    int n = 0;
+
+    bool useCache = cacheDirectory( cacheDir );
+    for( int obj = Quad; obj < N_OBJECTS; ++obj ) {
+        // a shape's vertices depend on what it's built from, and on
+        // whether they are welded; cacheLoad() checks their layout
+        key[obj] = cacheHash( &weldShapes, sizeof(weldShapes),
+                              objectKey( (Object) obj ) );
+        path[obj] = string( cacheDir ) + "/" + objects[obj] + ".geo";
+        hit[obj] = useCache && cacheLoad( path[obj].c_str(), key[obj],
+                                          Canvas::format(), cached[obj] );
+        if( !hit[obj] ) {
+            objs[n] = (Object) obj;
+            build[n] = C[obj];
+            ++n;
+        }
+    }
+
+    // build the rest on as many threads as there are cores
+    buildObjects( build, objs, n );
+    for( int obj = Quad; obj < N_OBJECTS; ++obj ) {
+        recordMemory( obj, hit[obj] ? cached[obj].mapSize : 0 );
+    }
+
+    // the buffers must be created on this thread, which owns the
+    // OpenGL context; after that, the Canvases' memory isn't needed
+    for( int obj = Quad; obj < N_OBJECTS; ++obj ) {
+        // upload the objects in the packed vertex formats
+        buffers[obj].setPacking( true );
+
+        // the memory holding the mesh while it is uploaded
+        size_t staged = 0, unused = 0;
+
+        if( hit[obj] ) {
+            // straight from the mapped file
+            const CachedMesh &m = cached[obj];
+            buffers[obj].createBuffers( m.format, m.numVertices, m.vertices,
+                                        m.numElements, m.elements );
+            staged = m.mapSize;
+            cacheUnmap( cached[obj] );
+        } else {
+            // the mesh is moved out of the Canvas, not copied
+            CanvasMesh m = C[obj]->takeMesh();
+            if( useCache ) {
+                cacheStore( path[obj].c_str(), key[obj], m.format(),
+                            m.numVertices(), m.getVertexData(),
+                            m.numElements(), m.getElements() );
+            }
+            m.memoryUsage( unused, staged );
+            buffers[obj].createBuffers( std::move( m ) );
+        }
+
+        // count what the upload needed, then what is left afterwards
+        recordMemory( obj, staged + buffers[obj].scratchBytes );
+        C[obj]->release();
+        recordMemory( obj, 0 );
+    }
+
+    memWriteJSON( memReport );
 }
 
 ///
@@ -250,8 +347,7 @@ static void display( void )
                 map_obj[obj] ? "vTexCoord" : NULL );
             checkErrors( "display select" );
 
-            glDrawElements( GL_TRIANGLES, buffers[obj].numElements,
-                            GL_UNSIGNED_INT, (void *) 0 );
+            buffers[obj].drawBuffers();
             checkErrors( "display draw" );
         }
     }
@@ -285,11 +381,15 @@ static bool init( void )
     }
     checkErrors( "init shaders 2" );
 
-    // create our Canvas
-    canvas = new Canvas( w_width, w_height );
-    if( canvas == NULL ) {
-        cerr << "Error - cannot create Canvas" << endl;
-        return( false );
+    // create our Canvases
+    for( int obj = Quad; obj < N_OBJECTS; ++obj ) {
+        canvas[obj] = new Canvas( w_width, w_height );
+        if( canvas[obj] == NULL ) {
+            cerr << "Error - cannot create Canvas" << endl;
+            return( false );
+        }
+
+        canvas[obj]->setWelding( weldShapes );
     }
 
     // need a VAO if we're using a core context;
@@ -308,7 +408,7 @@ static bool init( void )
     checkErrors( "init setup" );
 
     // create the geometry for our shapes.
-    createImage( *canvas );
+    createImage( canvas );
     checkErrors( "init image" );
 
     // initialize all texture-related things
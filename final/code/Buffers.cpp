@@ -10,8 +10,13 @@
 //  This file should not be modified by students.
 //
 
+#include <climits>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
 #include <iostream>
+#include <vector>
+#include <stdint.h>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -31,19 +36,65 @@
 ///
 BufferSet::BufferSet( void ) {
     // do this the easy way
+    mesh = NULL;
     initBuffer();
+    packing = false;
+    chunkSize = BUFFER_CHUNK_SIZE;
+}
+
+///
+/// Destructor
+///
+BufferSet::~BufferSet( void ) {
+    delete mesh;
 }
 
 ///
 /// initBuffer() - reset the BufferSet to its "empty" state
 ///
 void BufferSet::initBuffer( void ) {
-    vbuffer = ebuffer = 0;
-    numElements = 0;
-    vSize = eSize = tSize = cSize = nSize = 0;
+    chunks.clear();
+    numElements = numVertices = 0;
+    vSize = eSize = 0;
+    scratchBytes = 0;
+    VertexFormat none = { 0, -1, -1, -1, -1 };
+    format = none;
+    packed = false;
+    for( int i = 0; i < 3; ++i ) {
+        posScale[i] = 1.0f;
+        posBias[i] = 0.0f;
+    }
+    delete mesh;
+    mesh = NULL;
     bufferInit = false;
 }
 
+///
+/// setPacking(on) - turn packed vertex encodings on or off for the
+///     buffers created after this call
+///
+/// @param on   Whether the vertices should be packed
+/// @return  The old setting
+///
+bool BufferSet::setPacking( bool on ) {
+    bool old = packing;
+    packing = on;
+    return( old );
+}
+
+///
+/// setChunkSize(bytes) - set the largest vertex or element buffer to
+///     make for the meshes uploaded after this call
+///
+/// @param bytes   The largest buffer size
+/// @return  The old setting
+///
+GLsizeiptr BufferSet::setChunkSize( GLsizeiptr bytes ) {
+    GLsizeiptr old = chunkSize;
+    chunkSize = bytes;
+    return( old );
+}
+
 ///
 /// dumpBuffer(which) - dump the contents of the BufferSet
 ///
@@ -55,10 +106,244 @@ void BufferSet::dumpBuffer( const char *which ) {
         cout << "not ";
     }
     cout << "initialized)" << endl;
-    cout << "  IDs: v " << vbuffer << " e " << ebuffer <<
-        " #elements: " << numElements << endl;
-    cout << "  Sizes:  v " << vSize << " e " << eSize <<
-        " t " << tSize << " c " << cSize << " n " << nSize << endl;
+    cout << "  #elements: " << numElements << " #vertices: "
+        << numVertices << " #chunks: " << chunks.size() << endl;
+    cout << "  Sizes:  v " << vSize << " e " << eSize << endl;
+    for( size_t c = 0; c < chunks.size(); ++c ) {
+        cout << "  Chunk " << c << ":  IDs: v " << chunks[c].vbuffer
+            << " e " << chunks[c].ebuffer << " #elements: "
+            << chunks[c].numElements << " sizes: v " << chunks[c].vSize
+            << " e " << chunks[c].eSize << endl;
+    }
+    cout << "  Layout:  stride " << format.stride << " offsets p "
+        << format.position << " c " << format.color << " n "
+        << format.normal << " t " << format.texCoord
+        << (packed ? " (packed)" : "") << endl;
+    if( packed ) {
+        cout << "  Position scale " << posScale[0] << " " << posScale[1]
+            << " " << posScale[2] << " bias " << posBias[0] << " "
+            << posBias[1] << " " << posBias[2] << endl;
+    }
+}
+
+//
+// Packed vertex encodings (see setPacking()):
+//
+//   position   4 unsigned shorts, normalized:  x, y and z relative to
+//              the bounds of the mesh, and w (always 1)
+//   color      4 unsigned bytes, normalized
+//   normal     2 shorts, normalized:  the octahedral encoding of the
+//              unit normal, which the shader turns back into 3 values
+//   texCoord   2 half floats (texture coordinates may repeat, so they
+//              are not limited to [0,1])
+//
+// Each attribute takes a multiple of 4 bytes, so all stay aligned.
+//
+
+///
+/// packedFormat() - layout of a packed vertex holding the same
+///     attributes as a vertex with layout 'fmt'
+///
+static VertexFormat packedFormat( const VertexFormat &fmt ) {
+    VertexFormat f;
+    int size = 4 * sizeof(GLushort);
+
+    f.position = 0;
+    f.color = f.normal = f.texCoord = -1;
+    if( fmt.color >= 0 ) {
+        f.color = size;
+        size += 4 * sizeof(GLubyte);
+    }
+    if( fmt.normal >= 0 ) {
+        f.normal = size;
+        size += 2 * sizeof(GLshort);
+    }
+    if( fmt.texCoord >= 0 ) {
+        f.texCoord = size;
+        size += 2 * sizeof(GLushort);
+    }
+    f.stride = size;
+
+    return( f );
+}
+
+///
+/// toHalf() - convert a float to a half float, rounding to nearest even
+///
+static GLushort toHalf( float f ) {
+    uint32_t x;
+    memcpy( &x, &f, sizeof(x) );
+
+    GLushort sign = (x >> 16) & 0x8000;
+    int exp = (int) ((x >> 23) & 0xff);
+    uint32_t mant = x & 0x7fffff;
+
+    // infinity and NaN
+    if( exp == 0xff ) {
+        return( sign | 0x7c00 | (mant ? 0x200 : 0) );
+    }
+
+    exp += 15 - 127;
+    if( exp >= 31 ) {
+        // too large:  infinity
+        return( sign | 0x7c00 );
+    }
+
+    int shift = 13;
+    uint32_t h;
+    if( exp <= 0 ) {
+        // subnormal (or zero) as a half
+        if( exp < -10 ) {
+            return( sign );
+        }
+        mant |= 0x800000;
+        shift = 14 - exp;
+        h = mant >> shift;
+    } else {
+        h = ((uint32_t) exp << 10) | (mant >> shift);
+    }
+
+    // round; a carry out of the mantissa correctly bumps the exponent
+    uint32_t rest = mant & ((1u << shift) - 1);
+    uint32_t half = 1u << (shift - 1);
+    if( rest > half || (rest == half && (h & 1)) ) {
+        ++h;
+    }
+
+    return( sign | (GLushort) h );
+}
+
+///
+/// toUnorm() - convert a value in [0,1] to an unsigned normalized integer
+///
+static uint32_t toUnorm( float f, float max ) {
+    if( !(f > 0.0f) ) return( 0 );
+    if( f >= 1.0f ) return( (uint32_t) max );
+    return( (uint32_t) lrintf(f * max) );
+}
+
+///
+/// toSnorm16() - convert a value in [-1,1] to a signed normalized short
+///
+static GLshort toSnorm16( float f ) {
+    if( f <= -1.0f ) return( -32767 );
+    if( f >= 1.0f ) return( 32767 );
+    return( (GLshort) lrintf(f * 32767.0f) );
+}
+
+///
+/// octEncode() - octahedral encoding of a normal:  project it onto the
+///     octahedron |x| + |y| + |z| = 1, and fold the lower half over
+///     the upper half (the shader's octDecode() undoes this)
+///
+static void octEncode( const Normal &n, GLshort out[2] ) {
+    float len = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    float x = 0.0f, y = 0.0f;
+
+    if( len > 0.0f ) {
+        x = n.x / len;
+        y = n.y / len;
+        if( n.z < 0.0f ) {
+            float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+    }
+
+    out[0] = toSnorm16( x );
+    out[1] = toSnorm16( y );
+}
+
+///
+/// packVertices() - pack nv vertices with layout 'fmt' into 'out',
+///     whose layout is packedFormat(fmt)
+///
+/// @param fmt     layout of the vertices
+/// @param nv      number of vertices
+/// @param verts   the vertices
+/// @param out     where the packed vertices go
+/// @param scale   set to the scale to decode the positions with
+/// @param bias    set to the bias to decode the positions with
+///
+static void packVertices( const VertexFormat &fmt, size_t nv,
+                          const void *verts, vector<unsigned char> &out,
+                          float scale[3], float bias[3] ) {
+    const unsigned char *src = (const unsigned char *) verts;
+    VertexFormat pf = packedFormat( fmt );
+    Vertex v;
+
+    // find the bounds of the mesh
+    float lo[3], hi[3];
+    for( size_t i = 0; i < nv; ++i ) {
+        memcpy( &v, src + i * fmt.stride + fmt.position, sizeof(v) );
+        float p[3] = { v.x, v.y, v.z };
+        for( int k = 0; k < 3; ++k ) {
+            if( i == 0 || p[k] < lo[k] ) lo[k] = p[k];
+            if( i == 0 || p[k] > hi[k] ) hi[k] = p[k];
+        }
+    }
+    for( int k = 0; k < 3; ++k ) {
+        bias[k] = nv > 0 ? lo[k] : 0.0f;
+        scale[k] = nv > 0 ? hi[k] - lo[k] : 1.0f;
+    }
+
+    out.resize( nv * pf.stride );
+    for( size_t i = 0; i < nv; ++i ) {
+        const unsigned char *s = src + i * fmt.stride;
+        unsigned char *d = &out[0] + i * pf.stride;
+
+        memcpy( &v, s + fmt.position, sizeof(v) );
+        float p[3] = { v.x, v.y, v.z };
+        GLushort q[4];
+        for( int k = 0; k < 3; ++k ) {
+            q[k] = scale[k] > 0.0f ?
+                toUnorm( (p[k] - bias[k]) / scale[k], 65535.0f ) : 0;
+        }
+        q[3] = 65535;
+        memcpy( d + pf.position, q, sizeof(q) );
+
+        if( pf.color >= 0 ) {
+            Color c;
+            memcpy( &c, s + fmt.color, sizeof(c) );
+            GLubyte b[4] = { (GLubyte) toUnorm( c.r, 255.0f ),
+                             (GLubyte) toUnorm( c.g, 255.0f ),
+                             (GLubyte) toUnorm( c.b, 255.0f ),
+                             (GLubyte) toUnorm( c.a, 255.0f ) };
+            memcpy( d + pf.color, b, sizeof(b) );
+        }
+
+        if( pf.normal >= 0 ) {
+            Normal n;
+            memcpy( &n, s + fmt.normal, sizeof(n) );
+            GLshort e[2];
+            octEncode( n, e );
+            memcpy( d + pf.normal, e, sizeof(e) );
+        }
+
+        if( pf.texCoord >= 0 ) {
+            TexCoord t;
+            memcpy( &t, s + fmt.texCoord, sizeof(t) );
+            GLushort h[2] = { toHalf( t.u ), toHalf( t.v ) };
+            memcpy( d + pf.texCoord, h, sizeof(h) );
+        }
+    }
+}
+
+///
+/// inOrder() - do a mesh's indices just count up from 0?
+///
+/// @param elements  the connectivity data
+/// @param ne        number of indices
+///
+static bool inOrder( const GLuint *elements, size_t ne ) {
+    for( size_t i = 0; i < ne; ++i ) {
+        if( elements[i] != i ) {
+            return( false );
+        }
+    }
+
+    return( true );
 }
 
 ///
@@ -70,7 +355,8 @@ void BufferSet::dumpBuffer( const char *which ) {
 ///
 /// @return the ID of the new buffer
 ///
-GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size ) {
+GLuint BufferSet::makeBuffer( GLenum target, const void *data,
+                              GLsizeiptr size ) {
     GLuint buffer;
 
     glGenBuffers( 1, &buffer );
@@ -81,18 +367,31 @@ GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size ) {
 }
 
 ///
-/// createBuffers(canvas) create a set of buffers for the object
-///     currently held in 'canvas'.
+/// createBuffers(fmt,nv,verts,ne,elements) - create a set of buffers
+///     for nv interleaved vertices, drawn through ne indices
 ///
-/// @param C     the Canvas we'll use for drawing
+/// @param fmt       layout of one vertex
+/// @param nv        number of vertices
+/// @param verts     the vertex data
+/// @param ne        number of indices
+/// @param elements  the connectivity data
 ///
-void BufferSet::createBuffers( Canvas &C ) {
+void BufferSet::createBuffers( const VertexFormat &fmt, size_t nv,
+                               const void *verts, size_t ne,
+                               const GLuint *elements ) {
+
+    // a kept mesh describes the old buffers, but may be what is being
+    // uploaded now, so it is only freed once that's done
+    MeshData *old = mesh;
+    mesh = NULL;
 
     // reset this BufferSet if it has already been used
     if( bufferInit ) {
         // must delete the existing buffer IDs first
-        glDeleteBuffers( 1, &(vbuffer) );
-        glDeleteBuffers( 1, &(ebuffer) );
+        for( size_t c = 0; c < chunks.size(); ++c ) {
+            glDeleteBuffers( 1, &(chunks[c].vbuffer) );
+            glDeleteBuffers( 1, &(chunks[c].ebuffer) );
+        }
         // clear everything out
         initBuffer();
     }
@@ -100,103 +399,231 @@ void BufferSet::createBuffers( Canvas &C ) {
     //
     // vertex buffer structure
     //
-    // our vertex buffers will always have locations, but the
-    // other fields may or may not be present; this depends on
-    // how the shape was created
-    //
-    //             data        components   offset to beginning
-    //          [ locations ]  XYZW         0
-    //          [ colors    ]  RGBA         vSize
-    //          [ normals   ]  XYZ          vSize+cSize
-    //          [ t. coords ]  UV           vSize+cSize+nSize
+    // the vertices are interleaved:  each one holds its location
+    // followed by whatever other data the Canvas layout stores (see
+    // VertexLayout.h), and 'format' says where each of those is
     //
 
-    // get the vertex count
-    numElements = C.numVertices();
+    // get the vertex and index counts; if the Canvas welded its
+    // vertices, there are fewer vertices than indices
+    numElements = ne;
+    numVertices = nv;
 
     // if there are no vertices, there's nothing for us to do
-    if( numElements < 1 ) {
+    if( numElements < 1 ||
+        (elements == NULL && numVertices != numElements) ) {
+        delete old;
         return;
     }
 
-    // OK, we have vertices!
-    float *points = C.getVertices();
-    // #bytes = number of elements * 4 floats/element * bytes/float
-    vSize = numElements * 4 * sizeof(float);
-
-    // accumulate the total vertex buffer size
-    GLsizeiptr vbufSize = vSize;
-
-    // get the color data (if there is any)
-    float *colors = C.getColors();
-    if( colors != NULL ) {
-        cSize = numElements * 4 * sizeof(float);
-        vbufSize += cSize;
+    // if the indices would just count from 0, draw without them
+    if( numVertices == numElements &&
+        (elements == NULL || inOrder( elements, numElements )) ) {
+        elements = NULL;
     }
 
-    // get the normal data (if there is any)
-    float *normals = C.getNormals();
-    if( normals != NULL ) {
-        nSize = numElements * 3 * sizeof(float);
-        vbufSize += nSize;
+    // pack the vertices if asked to; the packed copy is only needed
+    // until it has been uploaded
+    vector<unsigned char> pack;
+    if( packing ) {
+        packVertices( fmt, numVertices, verts, pack, posScale, posBias );
+        verts = &pack[0];
+        format = packedFormat( fmt );
+        packed = true;
+        scratchBytes = pack.capacity();
+    } else {
+        format = fmt;
     }
 
-    // get the (u,v) data (if there is any)
-    float *uv = C.getUV();
-    if( uv != NULL ) {
-        tSize = numElements * 2 * sizeof(float);
-        vbufSize += tSize;
+    // how many vertices, and how many indices (whole triangles, and
+    // few enough for glDrawElements() to count), fit in one buffer
+    size_t maxV = chunkSize / format.stride;
+    size_t maxE = min( (size_t) chunkSize / sizeof(GLuint), (size_t) INT_MAX );
+    maxE -= maxE % 3;
+    maxV = max( maxV, (size_t) 3 );
+    maxE = max( maxE, (size_t) 3 );
+
+    if( elements == NULL ) {
+        // each chunk takes the next run of whole triangles, few
+        // enough for glDrawArrays() to count
+        size_t maxA = min( maxV, (size_t) INT_MAX );
+        maxA = max( maxA - maxA % 3, (size_t) 3 );
+        const unsigned char *src = (const unsigned char *) verts;
+        for( size_t first = 0; first < numVertices; first += maxA ) {
+            size_t n = min( maxA, numVertices - first );
+            addChunk( src + first * format.stride, n, NULL, n );
+        }
+    } else if( numVertices <= maxV && numElements <= maxE ) {
+        // unless they were packed, the Canvas already holds the
+        // vertices exactly as they are to be uploaded
+        addChunk( verts, numVertices, elements, numElements );
+    } else {
+        splitMesh( verts, numVertices, elements, numElements, maxV, maxE );
     }
 
-    // get the element data
-    GLuint *elements = C.getElements();
-    // #bytes = number of elements * bytes/element
-    eSize = numElements * sizeof(GLuint);
+    // finally, mark it as set up
+    bufferInit = true;
 
-    // first, create the connectivity data
-    ebuffer = makeBuffer( GL_ELEMENT_ARRAY_BUFFER, elements, eSize );
+    delete old;
+}
 
-    // next, the vertex buffer, containing vertices and "extra" data
-    // note that we use glBufferSubData() calls to do the copying
-    vbuffer = makeBuffer( GL_ARRAY_BUFFER, NULL, vbufSize );
+///
+/// addChunk() - upload one chunk of a mesh
+///
+/// @param verts     the vertex data
+/// @param nv        number of vertices
+/// @param elements  the connectivity data, indexing 'verts' (or NULL
+///                  if the vertices are drawn in order)
+/// @param ne        number of indices
+///
+void BufferSet::addChunk( const void *verts, size_t nv,
+                          const GLuint *elements, size_t ne ) {
+    BufferChunk c;
+
+    // #bytes = number of things * bytes/thing
+    c.numElements = ne;
+    c.vSize = (GLsizeiptr) (nv * format.stride);
+    c.eSize = 0;
+    c.ebuffer = 0;
+
+    // first, create the connectivity data, if there is any
+    if( elements != NULL ) {
+        c.eSize = (GLsizeiptr) (ne * sizeof(GLuint));
+        c.ebuffer = makeBuffer( GL_ELEMENT_ARRAY_BUFFER, elements, c.eSize );
+    }
 
-    // copy in the location data
-    glBufferSubData( GL_ARRAY_BUFFER, 0, vSize, points );
+    // next, the vertex buffer
+    c.vbuffer = makeBuffer( GL_ARRAY_BUFFER, verts, c.vSize );
 
-    // offsets to subsequent sections are the sum of
-    // the preceding section sizes (in bytes)
-    GLintptr offset = vSize;
+    chunks.push_back( c );
+    vSize += c.vSize;
+    eSize += c.eSize;
+}
 
-    // add in the color data (if there is any)
-    if( cSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, cSize, colors );
-        offset += cSize;
-    }
+///
+/// splitMesh() - upload a mesh too big for one buffer, in chunks
+///
+/// The triangles are taken in order, and each chunk gets as many as
+/// fit, along with the vertices they use, renumbered from 0.
+///
+/// @param verts     the vertex data
+/// @param nv        number of vertices
+/// @param elements  the connectivity data
+/// @param ne        number of indices
+/// @param maxV      most vertices in one chunk
+/// @param maxE      most indices in one chunk
+///
+void BufferSet::splitMesh( const void *verts, size_t nv,
+                           const GLuint *elements, size_t ne,
+                           size_t maxV, size_t maxE ) {
+    const unsigned char *src = (const unsigned char *) verts;
+    const GLuint none = 0xffffffffu;
+    size_t stride = format.stride;
+
+    // the index of each vertex in the current chunk (or 'none'), the
+    // vertices in it, their data, and the chunk's indices
+    vector<GLuint> local( nv, none );
+    vector<size_t> used;
+    vector<unsigned char> data;
+    vector<GLuint> idx;
+
+    used.reserve( maxV );
+    idx.reserve( maxE );
+
+    for( size_t t = 0; t + 3 <= ne; t += 3 ) {
+
+        // will this triangle fit?
+        size_t fresh = 0;
+        for( int k = 0; k < 3; ++k ) {
+            if( local[elements[t + k]] == none ) {
+                ++fresh;
+            }
+        }
+
+        if( used.size() + fresh > maxV || idx.size() + 3 > maxE ) {
+            // no; finish this chunk
+            data.resize( used.size() * stride );
+            for( size_t u = 0; u < used.size(); ++u ) {
+                memcpy( &data[u * stride], src + used[u] * stride, stride );
+                local[used[u]] = none;
+            }
+            addChunk( &data[0], used.size(), &idx[0], idx.size() );
+            used.clear();
+            idx.clear();
+        }
 
-    // add in the normal data (if there is any)
-    if( nSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, nSize, normals );
-        offset += nSize;
+        for( int k = 0; k < 3; ++k ) {
+            GLuint g = elements[t + k];
+            if( local[g] == none ) {
+                local[g] = used.size();
+                used.push_back( g );
+            }
+            idx.push_back( local[g] );
+        }
     }
 
-    // add in the (u,v) data (if there is any)
-    if( tSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, tSize, uv );
-        offset += tSize;
+    // and the last one
+    if( !idx.empty() ) {
+        data.resize( used.size() * stride );
+        for( size_t u = 0; u < used.size(); ++u ) {
+            memcpy( &data[u * stride], src + used[u] * stride, stride );
+        }
+        addChunk( &data[0], used.size(), &idx[0], idx.size() );
     }
 
-    // sanity check!
-    if( offset != vbufSize ) {
-        cerr << "*** createBuffers: size mismatch, offset "
-            << offset << " vbufSize " << vbufSize << endl;
+    // what all that cost
+    scratchBytes += local.capacity() * sizeof(GLuint) +
+                    used.capacity() * sizeof(size_t) +
+                    data.capacity() + idx.capacity() * sizeof(GLuint);
+}
+
+///
+/// enableAttrib() - find and enable one attribute variable
+///
+/// @param program   GLSL program object
+/// @param name      name of the attribute variable
+/// @param size      number of components
+/// @param type      type of each component
+/// @param norm      whether integer components are normalized
+/// @param offset    offset of the attribute within a vertex, or -1
+/// @param attribs   where to add the attribute
+///
+static void enableAttrib( GLuint program, const char *name, GLint size,
+                          GLenum type, GLboolean norm, int offset,
+                          vector<AttribBinding> &attribs ) {
+
+    if( offset < 0 ) {
+#if defined(DEBUG)
+        cerr << "selectBuffers(): " << name
+             << " requested, but the vertex layout has no such data"
+             << endl;
+#endif
+        return;
     }
 
-    // NOTE:  'points', 'colors', and 'elements' are dynamically allocated,
-    // but we don't free them here because they will be freed at the next
-    // call to clear() or the get*() functions
+    GLint loc = getAttribLoc( program, name );
+    if( loc >= 0 ) {
+        glEnableVertexAttribArray( loc );
+        AttribBinding a = { loc, size, type, norm, offset };
+        attribs.push_back( a );
+    }
+}
 
-    // finally, mark it as set up
-    bufferInit = true;
+///
+/// bindChunk() - bind a chunk's buffers, and point the attribute
+///     variables into its vertex buffer
+///
+/// @param c   the chunk
+///
+void BufferSet::bindChunk( const BufferChunk &c ) {
+    glBindBuffer( GL_ARRAY_BUFFER, c.vbuffer );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, c.ebuffer );
+
+    for( size_t i = 0; i < attribs.size(); ++i ) {
+        const AttribBinding &a = attribs[i];
+        glVertexAttribPointer( a.loc, a.size, a.type, a.norm, format.stride,
+                               BUFFER_OFFSET(a.offset) );
+    }
 }
 
 ///
@@ -211,11 +638,11 @@ void BufferSet::createBuffers( Canvas &C ) {
 void BufferSet::selectBuffers( GLuint program,
     const char *vp, const char *vc, const char *vn, const char *vt ) {
 
-    // bind the buffers
-    glBindBuffer( GL_ARRAY_BUFFER, vbuffer );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebuffer );
-
-    // set up the vertex attribute variables
+    // set up the vertex attribute variables; the offsets come from
+    // the layout of the Canvas the buffers were made from, or from
+    // packedFormat(), and the component types from whether the
+    // vertices were packed
+    attribs.clear();
 
     // we always want position data
 #if defined(DEBUG)
@@ -224,64 +651,74 @@ void BufferSet::selectBuffers( GLuint program,
              << endl;
     }
 #endif
-    GLint loc = getAttribLoc( program , vp );
-    if( loc >= 0 ) {
-        glEnableVertexAttribArray( loc );
-        glVertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, 0,
-                               BUFFER_OFFSET(0) );
+    if( packed ) {
+        enableAttrib( program, vp, 4, GL_UNSIGNED_SHORT, GL_TRUE,
+                      format.position, attribs );
+    } else {
+        enableAttrib( program, vp, 4, GL_FLOAT, GL_FALSE,
+                      format.position, attribs );
     }
 
-    // cumulative byte offset for subsequent data sections
-    int offset = vSize;
-
     // do we also want color?
     if( vc != NULL ) {
-#if defined(DEBUG)
-        if( cSize == 0 ) {
-            cerr << "selectBuffers(): Color data requested, but cSize is 0",
-                 << endl;
-        }
-#endif
-        loc = getAttribLoc( program, vc );
-        if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
+        if( packed ) {
+            enableAttrib( program, vc, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          format.color, attribs );
+        } else {
+            enableAttrib( program, vc, 4, GL_FLOAT, GL_FALSE,
+                          format.color, attribs );
         }
-        offset += cSize;
     }
 
     // how about a surface normal?
     if( vn != NULL ) {
-#if defined(DEBUG)
-        if( nSize == 0 ) {
-            cerr << "selectBuffers(): Normal data requested, but nSize is 0",
-                 << endl;
-        }
-#endif
-        loc = getAttribLoc( program, vn );
-        if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 3, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
+        if( packed ) {
+            enableAttrib( program, vn, 2, GL_SHORT, GL_TRUE,
+                          format.normal, attribs );
+        } else {
+            enableAttrib( program, vn, 3, GL_FLOAT, GL_FALSE,
+                          format.normal, attribs );
         }
-        offset += nSize;
     }
 
     // what about texture coordinates?
     if( vt != NULL ) {
-#if defined(DEBUG)
-        if( tSize == 0 ) {
-            cerr << "selectBuffers(): Texture data requested, but tSize is 0",
-                 << endl;
+        if( packed ) {
+            enableAttrib( program, vt, 2, GL_HALF_FLOAT, GL_FALSE,
+                          format.texCoord, attribs );
+        } else {
+            enableAttrib( program, vt, 2, GL_FLOAT, GL_FALSE,
+                          format.texCoord, attribs );
         }
-#endif
-        loc = getAttribLoc( program, vt );
-        if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 2, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
+    }
+
+    // bind the buffers (the first chunk's, if there are several)
+    if( chunks.empty() ) {
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    } else {
+        bindChunk( chunks[0] );
+    }
+
+    // tell the shader how to decode the data; a program that does
+    // not use one of these just doesn't have it, so don't complain
+    glUniform3fv( glGetUniformLocation( program, "posScale" ), 1, posScale );
+    glUniform3fv( glGetUniformLocation( program, "posBias" ), 1, posBias );
+    glUniform1i( glGetUniformLocation( program, "octNormals" ),
+                 packed && format.normal >= 0 );
+}
+
+///
+/// drawBuffers() - draw the triangles, chunk by chunk
+///
+void BufferSet::drawBuffers( void ) {
+    for( size_t c = 0; c < chunks.size(); ++c ) {
+        bindChunk( chunks[c] );
+        if( chunks[c].ebuffer == 0 ) {
+            glDrawArrays( GL_TRIANGLES, 0, chunks[c].numElements );
+        } else {
+            glDrawElements( GL_TRIANGLES, chunks[c].numElements,
+                            GL_UNSIGNED_INT, (void *) 0 );
         }
-        offset += tSize;
     }
 }
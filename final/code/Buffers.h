@@ -29,26 +29,119 @@ using namespace std;
 //
 #define BUFFER_OFFSET(i)        ((GLvoid *)(((char *)0) + (i)))
 
+//
+// What to do with a mesh once it has been uploaded
+//
+typedef
+    enum meshpolicy_e {
+        ReleaseMesh = 0,    // free it
+        KeepMesh            // keep it in the BufferSet (see getMesh())
+        // Sentinel gives us the number of policies
+        , N_POLICIES
+    } MeshPolicy;
+
+//
+// The largest buffer a BufferSet makes, in bytes, unless told
+// otherwise (see setChunkSize())
+//
+#define BUFFER_CHUNK_SIZE       (256L * 1024 * 1024)
+
+//
+// One piece of a mesh:  a vertex buffer, and an element buffer whose
+// indices are into that vertex buffer; if the vertices are simply
+// drawn in order, there is no element buffer (ebuffer is 0)
+//
+struct BufferChunk {
+    GLuint vbuffer, ebuffer;    // buffer handles
+    GLsizei numElements;        // number of vertices to draw
+    GLsizeiptr vSize, eSize;    // buffer sizes (bytes)
+};
+
+//
+// Where an attribute variable finds its data within a vertex
+//
+struct AttribBinding {
+    GLint loc;                  // location of the variable
+    GLint size;                 // number of components
+    GLenum type;                // type of each component
+    GLboolean norm;             // are integer components normalized?
+    int offset;                 // offset within a vertex (bytes)
+};
+
 //
 // All the relevant information needed to keep
 // track of vertex and element buffers
 //
+// A mesh too big for one buffer of at most chunkSize bytes is split
+// into chunks, each with its own vertex and element buffer and drawn
+// with its own glDrawElements() call (see drawBuffers()).  A vertex
+// used by triangles in more than one chunk is stored in each of them.
+//
+// A mesh whose indices just count up from 0 (one that was not
+// welded) gets no element buffers at all, and is drawn with
+// glDrawArrays() instead.
+//
 
 class BufferSet {
 
 public:
-    // buffer handles
-    GLuint vbuffer, ebuffer;
+    // the buffers, one pair per chunk
+    vector<BufferChunk> chunks;
 
-    // total number of vertices
-    int numElements;
+    // total number of indices to draw, and of distinct vertices
+    size_t numElements;
+    size_t numVertices;
 
-    // component sizes (bytes)
-    long vSize, eSize, tSize, cSize, nSize;
+    // total buffer sizes (bytes)
+    GLsizeiptr vSize, eSize;
+
+    // the largest buffer to make (bytes)
+    GLsizeiptr chunkSize;
+
+    // the most temporary CPU memory the last createBuffers() call
+    // needed, for the packed copy of the vertices and for splitting
+    // the mesh into chunks (bytes)
+    size_t scratchBytes;
+
+    // where each attribute sits within a vertex
+    VertexFormat format;
+
+    // should the vertices be packed when uploaded, and are the ones
+    // in the vertex buffer packed?  (see setPacking())
+    bool packing;
+    bool packed;
+
+    // packed positions are stored relative to the bounds of the mesh;
+    // position = stored * posScale + posBias
+    float posScale[3];
+    float posBias[3];
 
     // have these already been set up?
     bool bufferInit;
 
+private:
+    // the mesh the buffers were made from, if it was kept
+    MeshData *mesh;
+
+    // the attribute variables selectBuffers() set up, so drawBuffers()
+    // can point them into each chunk's vertex buffer
+    vector<AttribBinding> attribs;
+
+    // upload one chunk
+    void addChunk( const void *verts, size_t nv,
+                   const GLuint *elements, size_t ne );
+
+    // split a mesh into chunks of at most maxV vertices and maxE indices
+    void splitMesh( const void *verts, size_t nv, const GLuint *elements,
+                    size_t ne, size_t maxV, size_t maxE );
+
+    // bind a chunk's buffers, and point the attributes into it
+    void bindChunk( const BufferChunk &c );
+
+    // BufferSets own GL buffers, and can't be copied
+    BufferSet( const BufferSet & );
+    BufferSet &operator=( const BufferSet & );
+
 public:
 
     ///
@@ -56,11 +149,41 @@ public:
     ///
     BufferSet( void );
 
+    ///
+    /// Destructor
+    ///
+    ~BufferSet( void );
+
     ///
     /// initBuffer() - reset the supplied buffer to its "empty" state
     ///
     void initBuffer( void );
 
+    ///
+    /// setPacking(on) - turn packed vertex encodings on or off for the
+    ///     buffers created after this call
+    ///
+    /// Packed vertices store positions as 16-bit values relative to
+    /// the bounds of the mesh, normals as two 16-bit values (octahedral
+    /// encoding), texture coordinates as half floats, and colors as
+    /// 8-bit values.  The shaders must decode them (see phong.vert);
+    /// selectBuffers() sets the uniforms they need to do so.
+    ///
+    /// @param on   Whether the vertices should be packed
+    /// @return  The old setting
+    ///
+    bool setPacking( bool on );
+
+    ///
+    /// setChunkSize(bytes) - set the largest vertex or element buffer
+    ///     to make for the meshes uploaded after this call; bigger
+    ///     meshes are split into chunks
+    ///
+    /// @param bytes   The largest buffer size
+    /// @return  The old setting
+    ///
+    GLsizeiptr setChunkSize( GLsizeiptr bytes );
+
     ///
     /// dumpBuffer(which) - dump the contents of the BufferSet
     ///
@@ -77,7 +200,7 @@ public:
     ///
     /// @return the ID of the new buffer
     ///
-    GLuint makeBuffer( GLenum target, const void *data, GLsizei size );
+    GLuint makeBuffer( GLenum target, const void *data, GLsizeiptr size );
 
     ///
     /// createBuffers(canvas) - create a set of buffers for the object
@@ -85,11 +208,83 @@ public:
     ///
     /// @param C     the Canvas we'll use for drawing
     ///
-    void createBuffers( Canvas &C );
+    template <class L>
+    void createBuffers( BasicCanvas<L> &C ) {
+        createBuffers( C.format(), C.numUniqueVertices(), C.getVertexData(),
+                       C.numVertices(), C.getElements() );
+    }
+
+    ///
+    /// createBuffers(canvas) - create a set of buffers for the object
+    ///     held in a Canvas that is no longer needed; its mesh is moved
+    ///     out of it, rather than copied
+    ///
+    /// @param C        the Canvas we used for drawing
+    /// @param policy   what to do with the mesh once it is uploaded
+    ///
+    template <class L>
+    void createBuffers( BasicCanvas<L> &&C, MeshPolicy policy = ReleaseMesh ) {
+        createBuffers( C.takeMesh(), policy );
+    }
+
+    ///
+    /// createBuffers(mesh) - create a set of buffers for a mesh taken
+    ///     out of a Canvas (see BasicCanvas::takeMesh())
+    ///
+    /// The mesh is uploaded as it is, then freed or, if the policy
+    /// says so, moved into this BufferSet, where getMesh() finds it.
+    ///
+    /// @param M        the mesh
+    /// @param policy   what to do with the mesh once it is uploaded
+    ///
+    template <class L>
+    void createBuffers( BasicMeshData<L> &&M, MeshPolicy policy = ReleaseMesh ) {
+        createBuffers( M.format(), M.numVertices(), M.getVertexData(),
+                       M.numElements(), M.getElements() );
+        if( policy == KeepMesh ) {
+            BasicMeshData<L> *kept = new BasicMeshData<L>;
+            kept->vertices.swap( M.vertices );
+            kept->elements.swap( M.elements );
+            mesh = kept;
+        } else {
+            vector<L>().swap( M.vertices );
+            vector<GLuint>().swap( M.elements );
+        }
+    }
+
+    ///
+    /// getMesh() - the mesh these buffers were made from, if it was
+    ///     kept (see createBuffers(mesh))
+    ///
+    /// @return the mesh, or NULL
+    ///
+    const MeshData *getMesh( void ) const { return mesh; }
+
+    ///
+    /// createBuffers(fmt,nv,verts,ne,elements) - create a set of buffers
+    ///     for nv interleaved vertices, drawn through ne indices
+    ///
+    /// If the indices are 0, 1, 2, ..., nv-1, or 'elements' is NULL
+    /// and nv is ne, the vertices are drawn in order, and no element
+    /// buffer is made.
+    ///
+    /// @param fmt       layout of one vertex
+    /// @param nv        number of vertices
+    /// @param verts     the vertex data
+    /// @param ne        number of indices
+    /// @param elements  the connectivity data (or NULL)
+    ///
+    void createBuffers( const VertexFormat &fmt, size_t nv,
+                        const void *verts, size_t ne,
+                        const GLuint *elements );
 
     ///
     /// selectBuffers() - bind the correct vertex and element buffers
     ///
+    /// Binds the first chunk's buffers.  Also sets the uniforms
+    /// 'posScale', 'posBias' and 'octNormals', which tell the shader
+    /// how to decode the vertex data
+    ///
     /// @param program   GLSL program object
     /// @param vp        name of the position attribute variable
     /// @param vc        name of the color attribute variable (or NULL)
@@ -99,6 +294,12 @@ public:
     void selectBuffers( GLuint program,
         const char *vp, const char * vc, const char *vn, const char *vt );
 
+    ///
+    /// drawBuffers() - draw the triangles, chunk by chunk, with the
+    ///     attribute variables chosen by the last selectBuffers()
+    ///
+    void drawBuffers( void );
+
 };
 
 #endif
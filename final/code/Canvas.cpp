@@ -11,6 +11,9 @@
 //
 //  This file should not be modified by students.
 //
+//  Changing the vertices or indices a Canvas produces means bumping
+//  GEOMETRY_GENERATOR_VERSION (GeometryCache.h).
+//
 //  This module provides two basic interfaces:  a pixel interface for
 //  simple 2D drawings, and a vertex interface for 3D drawings. The pixel
 //  interface consists of two functions:
@@ -35,8 +38,10 @@
 //
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <stdint.h>
 #include <glm/vec3.hpp>
 #include <glm/geometric.hpp>
 
@@ -44,79 +49,253 @@
 #include "Canvas.h"
 #include "Utils.h"
 
+// an empty slot in the welding hash table; also one more than the
+// largest index a 32-bit index can hold
+static const GLuint NO_VERTEX = 0xffffffffu;
+
 ///
 /// Constructor
 ///
 /// @param w width of canvas
 /// @param h height of canvas
 ///
-Canvas::Canvas( int w, int h ) : width(w), height(h) {
+template <class L>
+BasicCanvas<L>::BasicCanvas( int w, int h ) : width(w), height(h) {
     // G++ allows us to use (Color) { ... }, but Visual Studio
     // doesn't, so we do this the long way to keep everyone happy
     Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
     currentColor = black;
     currentDepth = -1.0f;
-    pointArray = 0;
-    colorArray = 0;
-    normalArray = 0;
-    uvArray = 0;
-    elemArray = 0;
     numElements = 0;
+    numColors = numNormals = numUV = 0;
+    welding = welded = false;
 }
 
 ///
 /// Destructor
 ///
-Canvas::~Canvas( void ) {
+template <class L>
+BasicCanvas<L>::~BasicCanvas( void ) {
     clear();
 }
 
-    /////////////////////////////////////
-    // Basic Canvas manipulation
-    /////////////////////////////////////
-
 ///
-/// Clear the canvas
+/// The i-th vertex, making room for it if need be
 ///
-void Canvas::clear( void )
+/// A vertex whose data has only partly been added reads as zero in
+/// the missing fields.
+///
+template <class L>
+L &BasicCanvas<L>::slot( size_t i )
 {
-    if( pointArray ) {
-        delete [] pointArray;
-        pointArray = 0;
+    welded = false;
+    if( i >= verts.size() ) {
+        verts.resize( i + 1 );
     }
-    if( normalArray ) {
-        delete [] normalArray;
-        normalArray = 0;
+    return verts[i];
+}
+
+///
+/// Vertices first .. first+count-1, making room for them if need be
+///
+/// @param first   the first vertex
+/// @param count   how many
+///
+/// @return A pointer to the first one
+///
+template <class L>
+L *BasicCanvas<L>::slots( size_t first, size_t count )
+{
+    welded = false;
+    if( first + count > verts.size() ) {
+        verts.resize( first + count );
     }
-    if( uvArray ) {
-        delete [] uvArray;
-        uvArray = 0;
+    return &verts[first];
+}
+
+///
+/// Hash the bytes of a vertex (the layouts hold only floats, so there
+/// is no padding to worry about)
+///
+template <class L>
+static uint32_t hashVertex( const L &v )
+{
+    const unsigned char *p = (const unsigned char *) &v;
+    uint32_t h = 0;
+
+    // MurmurHash3 over 32-bit words:  each word is mixed on its own
+    // before it is combined, since the bits that differ between
+    // nearby float values sit in the middle of the word
+    for( size_t k = 0; k + 4 <= sizeof(L); k += 4 ) {
+        uint32_t w;
+        memcpy( &w, p + k, 4 );
+        w *= 0xcc9e2d51u;
+        w = (w << 15) | (w >> 17);
+        w *= 0x1b873593u;
+        h ^= w;
+        h = (h << 13) | (h >> 19);
+        h = h * 5 + 0xe6546b64u;
     }
-    if( elemArray ) {
-        delete [] elemArray;
-        elemArray = 0;
+
+    // final mix, so that the low bits (which pick the table slot)
+    // depend on all of them
+    h ^= sizeof(L);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+///
+/// Find the distinct vertices, and index them
+///
+/// Uses an open-addressing hash table with linear probing.  The table
+/// is kept at most half full of distinct vertices, and doubled (and
+/// refilled) when it would get fuller, so its size follows the number
+/// of distinct vertices rather than the number added.
+///
+template <class L>
+void BasicCanvas<L>::weld( void )
+{
+    size_t n = numElements;
+    size_t mask = 15;
+
+    unique.clear();
+    indices.resize( n );
+    table.assign( mask + 1, NO_VERTEX );
+
+    for( size_t i = 0; i < n; ++i ) {
+        const L &v = verts[i];
+        size_t h = hashVertex( v ) & mask;
+        while( table[h] != NO_VERTEX &&
+               memcmp( &unique[table[h]], &v, sizeof(L) ) != 0 ) {
+            h = (h + 1) & mask;
+        }
+
+        if( table[h] == NO_VERTEX ) {
+            if( unique.size() == NO_VERTEX ) {
+                // a 32-bit index can't tell this vertex from the rest
+                cerr << "Canvas: more than " << NO_VERTEX
+                     << " distinct vertices; can't weld" << endl;
+                welding = false;
+                vector<L>().swap( unique );
+                vector<GLuint>().swap( indices );
+                vector<GLuint>().swap( table );
+                return;
+            }
+            if( 2 * (unique.size() + 1) > mask + 1 ) {
+                // grow the table, then find the new vertex's slot in it
+                mask = 2 * mask + 1;
+                table.assign( mask + 1, NO_VERTEX );
+                for( size_t u = 0; u < unique.size(); ++u ) {
+                    size_t g = hashVertex( unique[u] ) & mask;
+                    while( table[g] != NO_VERTEX ) {
+                        g = (g + 1) & mask;
+                    }
+                    table[g] = u;
+                }
+                h = hashVertex( v ) & mask;
+                while( table[h] != NO_VERTEX ) {
+                    h = (h + 1) & mask;
+                }
+            }
+            table[h] = unique.size();
+            unique.push_back( v );
+        }
+        indices[i] = table[h];
     }
-    if( colorArray ) {
-        delete [] colorArray;
-        colorArray = 0;
+
+    welded = true;
+}
+
+///
+/// Weld the vertices if they have changed since they were last welded
+///
+/// @return Whether the data is welded (welding may have been turned
+///         off, if there were too many distinct vertices to index)
+///
+template <class L>
+bool BasicCanvas<L>::isWelded( void )
+{
+    if( welding && !welded ) {
+        weld();
     }
-    points.clear();
-    normals.clear();
-    uv.clear();
-    colors.clear();
+
+    return welding;
+}
+
+    /////////////////////////////////////
+    // Basic Canvas manipulation
+    /////////////////////////////////////
+
+///
+/// Clear the canvas
+///
+template <class L>
+void BasicCanvas<L>::clear( void )
+{
+    verts.clear();
     numElements = 0;
+    numColors = numNormals = numUV = 0;
+    welded = false;
     Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
     currentColor = black;
     currentDepth = -1.0f;
 }
 
+///
+/// Make room for a number of vertices
+///
+/// @param vertices   The number of vertices expected
+///
+template <class L>
+void BasicCanvas<L>::reserve( size_t vertices )
+{
+    if( vertices > 0 ) {
+        verts.reserve( vertices );
+    }
+}
+
+///
+/// Add up the memory the Canvas holds
+///
+/// @param used       Incremented by the bytes holding data
+/// @param reserved   Incremented by the bytes allocated
+///
+template <class L>
+void BasicCanvas<L>::memoryUsage( size_t &used, size_t &reserved ) const
+{
+    vectorMemory( verts, used, reserved );
+    vectorMemory( elements, used, reserved );
+    vectorMemory( unique, used, reserved );
+    vectorMemory( indices, used, reserved );
+    vectorMemory( table, used, reserved );
+}
+
+///
+/// Clear the canvas and give back the memory holding its vertices
+///
+template <class L>
+void BasicCanvas<L>::release( void )
+{
+    clear();
+    vector<L>().swap( verts );
+    vector<GLuint>().swap( elements );
+    vector<L>().swap( unique );
+    vector<GLuint>().swap( indices );
+    vector<GLuint>().swap( table );
+}
+
 ///
 /// Set the pixel Z coordinate
 ///
 /// @param d   The depth to use
 /// @return    The old depth value
 ///
-float Canvas::setDepth( float d )
+template <class L>
+float BasicCanvas<L>::setDepth( float d )
 {
     float r = currentDepth;
 
@@ -130,7 +309,8 @@ float Canvas::setDepth( float d )
 /// @param color   The desired color
 /// @return The old color value
 ///
-Color Canvas::setColor( Color color )
+template <class L>
+Color BasicCanvas<L>::setColor( Color color )
 {
     Color old = currentColor;
 
@@ -138,6 +318,22 @@ Color Canvas::setColor( Color color )
     return( old );
 }
 
+///
+/// Turn vertex welding on or off
+///
+/// @param on   Whether identical vertices should be stored once
+/// @return The old setting
+///
+template <class L>
+bool BasicCanvas<L>::setWelding( bool on )
+{
+    bool old = welding;
+
+    welding = on;
+    welded = false;
+    return( old );
+}
+
     /////////////////////////////////////
     //
     // Adding things to the Canvas
@@ -154,7 +350,8 @@ Color Canvas::setColor( Color color )
 /// @param x   The x coordinate of the pixel to be added
 /// @param y   The y coordinate of the pixel to be added
 ///
-void Canvas::addPixel( int x, int y )
+template <class L>
+void BasicCanvas<L>::addPixel( int x, int y )
 {
     // we assume that we're working in 2D, and ignore the Z
     // coordinate that came in with the pixel location
@@ -172,7 +369,8 @@ void Canvas::addPixel( int x, int y )
 ///
 /// @param p   The pixel to be added
 ///
-void Canvas::addPixel( Vertex p )
+template <class L>
+void BasicCanvas<L>::addPixel( Vertex p )
 {
     // we assume that we're working in 2D, and ignore the Z
     // coordinate that came in with the pixel location
@@ -191,7 +389,8 @@ void Canvas::addPixel( Vertex p )
 /// @param p     The pixel to be set
 /// @param c     The desired color
 ///
-void Canvas::addPixel( Vertex p, Color c )
+template <class L>
+void BasicCanvas<L>::addPixel( Vertex p, Color c )
 {
     Vertex pix = { p.x, p.y, currentDepth };
     Color col = { c.r, c.g, c.b, 1.0f };
@@ -209,12 +408,10 @@ void Canvas::addPixel( Vertex p, Color c )
 ///
 /// @param c   The color to be added
 ///
-void Canvas::addColor( Color c )
+template <class L>
+void BasicCanvas<L>::addColor( Color c )
 {
-    colors.push_back( c.r );
-    colors.push_back( c.g );
-    colors.push_back( c.b );
-    colors.push_back( c.a );
+    slot( numColors++ ).setColor( c );
 }
 
 ///
@@ -222,12 +419,14 @@ void Canvas::addColor( Color c )
 ///
 /// @param v   The vertex to be added
 ///
-void Canvas::addVertex( Vertex v )
+template <class L>
+void BasicCanvas<L>::addVertex( Vertex v )
 {
-    points.push_back( v.x );
-    points.push_back( v.y );
-    points.push_back( v.z );
-    points.push_back( 1.0f );  // ignore the homogeneous coordinate
+    Vertex &p = slot( numElements ).pos;
+    p.x = v.x;
+    p.y = v.y;
+    p.z = v.z;
+    p.w = 1.0f;  // ignore the homogeneous coordinate
 
     // here is where we actually count the number of
     // things that have been put into the canvas
@@ -239,11 +438,10 @@ void Canvas::addVertex( Vertex v )
 ///
 /// @param n   The normal to be added
 ///
-void Canvas::addNormal( Normal n )
+template <class L>
+void BasicCanvas<L>::addNormal( Normal n )
 {
-    normals.push_back( n.x );
-    normals.push_back( n.y );
-    normals.push_back( n.z );
+    slot( numNormals++ ).setNormal( n );
 }
 
 ///
@@ -251,10 +449,10 @@ void Canvas::addNormal( Normal n )
 ///
 /// @param t   The texture coordinate to be added
 ///
-void Canvas::addTexCoord( TexCoord t )
+template <class L>
+void BasicCanvas<L>::addTexCoord( TexCoord t )
 {
-    uv.push_back( t.u );
-    uv.push_back( t.v );
+    slot( numUV++ ).setTexCoord( t );
 }
 
     /////////////////////////////////////
@@ -270,7 +468,8 @@ void Canvas::addTexCoord( TexCoord t )
 /// @param p1 second triangle vertex
 /// @param p2 final triangle vertex
 ///
-void Canvas::addTriangle( Vertex p0, Vertex p1, Vertex p2 )
+template <class L>
+void BasicCanvas<L>::addTriangle( Vertex p0, Vertex p1, Vertex p2 )
 {
     // calculate the normal for the triangle
     glm::vec3 u( p1.x - p0.x, p1.y - p0.y, p1.z - p0.z );
@@ -292,7 +491,8 @@ void Canvas::addTriangle( Vertex p0, Vertex p1, Vertex p2 )
 /// @param p2 final triangle vertex
 /// @param n2 final triangle normal data
 ///
-void Canvas::addTriangleWithNorms( Vertex p0, Normal n0,
+template <class L>
+void BasicCanvas<L>::addTriangleWithNorms( Vertex p0, Normal n0,
              Vertex p1, Normal n1, Vertex p2, Normal n2 )
 {
     addVertex( p0 );   addNormal( n0 );
@@ -307,167 +507,213 @@ void Canvas::addTriangleWithNorms( Vertex p0, Normal n0,
 /// @param uv1 second vertex (u,v) data
 /// @param uv2 final vertex (u,v) data
 ///
-void Canvas::addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 )
+template <class L>
+void BasicCanvas<L>::addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 )
 {
     addTexCoord( uv0 );
     addTexCoord( uv1 );
     addTexCoord( uv2 );
 }
 
-    /////////////////////////////////////
-    //
-    // Retrieving things from the Canvas
-    //
-    /////////////////////////////////////
-
 ///
-/// Retrieve the array of element data from this Canvas
+/// Add a number of vertices (every three making a triangle), and
+/// optionally a normal for each
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @param count   number of vertices
+/// @param v       the vertices
+/// @param n       their normals (or NULL)
 ///
-GLuint *Canvas::getElements( void )
+template <class L>
+void BasicCanvas<L>::addTriangles( size_t count, const Vertex v[],
+                                   const Normal n[] )
 {
-    // delete the old element array if we have one
-    if( elemArray ) {
-        delete [] elemArray;
-        elemArray = 0;
+    if( count < 1 ) {
+        return;
     }
 
-    int n = numElements;
+    L *p = slots( numElements, count );
+    for( size_t i = 0; i < count; ++i ) {
+        p[i].pos = v[i];
+        p[i].pos.w = 1.0f;  // ignore the homogeneous coordinate
+    }
+    numElements += count;
 
-    if( n > 0 ) {
-        // create and fill a new element array
-        elemArray = new GLuint[ n ];
-        if( elemArray == 0 ) {
-            cerr << "element allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            elemArray[i] = i;
+    if( n != NULL ) {
+        p = slots( numNormals, count );
+        for( size_t i = 0; i < count; ++i ) {
+            p[i].setNormal( n[i] );
         }
+        numNormals += count;
     }
-
-    return elemArray;
 }
 
 ///
-/// Retrieve the array of vertex data from this Canvas
+/// Add a mesh given as an indexed triangle list, for either type of
+/// index (see addIndexedMesh())
 ///
-/// @return A pointer to a dynamic array of data, or NULL
-///
-float *Canvas::getVertices( void )
+template <class L> template <class I>
+void BasicCanvas<L>::addIndexed( size_t count, const Vertex verts[],
+                                 const I vi[], const Normal norms[],
+                                 const I ni[] )
 {
-    // delete the old point array if we have one
-    if( pointArray ) {
-        delete [] pointArray;
-        pointArray = 0;
+    count -= count % 3;
+    if( count < 1 ) {
+        return;
     }
 
-    int n = points.size();
+    L *p = slots( numElements, count );
+    for( size_t i = 0; i < count; ++i ) {
+        p[i].pos = verts[vi[i]];
+        p[i].pos.w = 1.0f;  // ignore the homogeneous coordinate
+    }
+    numElements += count;
 
-    if( n > 0 ) {
-        // create and fill a new point array
-        pointArray = new float[ n ];
-        if( pointArray == 0 ) {
-            cerr << "point allocation failure" << endl;
-            exit( 1 );
+    p = slots( numNormals, count );
+    if( norms != NULL ) {
+        if( ni == NULL ) {
+            ni = vi;
+        }
+        for( size_t i = 0; i < count; ++i ) {
+            p[i].setNormal( norms[ni[i]] );
         }
-        for( int i = 0; i < n; i++ ) {
-            pointArray[i] = points[i];
+    } else {
+        // calculate the normal for each triangle, as addTriangle() does
+        for( size_t i = 0; i < count; i += 3 ) {
+            const Vertex &p0 = verts[vi[i]];
+            const Vertex &p1 = verts[vi[i + 1]];
+            const Vertex &p2 = verts[vi[i + 2]];
+            glm::vec3 u( p1.x - p0.x, p1.y - p0.y, p1.z - p0.z );
+            glm::vec3 v( p2.x - p0.x, p2.y - p0.y, p2.z - p0.z );
+            glm::vec3 n( glm::cross(u,v) );
+
+            Normal nn = { n[0], n[1], n[2] };
+            p[i].setNormal( nn );
+            p[i + 1].setNormal( nn );
+            p[i + 2].setNormal( nn );
         }
     }
-
-    return pointArray;
+    numNormals += count;
 }
 
 ///
-/// Retrieve the array of normal data from this Canvas
+/// Add a mesh given as an indexed triangle list
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @param count   number of indices; only whole triangles are added
+/// @param verts   the vertices
+/// @param vi      index of each vertex to add
+/// @param norms   the normals (or NULL)
+/// @param ni      index of each normal to add (or NULL)
 ///
-float *Canvas::getNormals( void )
+template <class L>
+void BasicCanvas<L>::addIndexedMesh( size_t count, const Vertex verts[],
+                                     const GLuint vi[], const Normal norms[],
+                                     const GLuint ni[] )
 {
-    // delete the old normal array if we have one
-    if( normalArray ) {
-        delete [] normalArray;
-        normalArray = 0;
-    }
+    addIndexed( count, verts, vi, norms, ni );
+}
 
-    int n = normals.size();
+template <class L>
+void BasicCanvas<L>::addIndexedMesh( size_t count, const Vertex verts[],
+                                     const int vi[], const Normal norms[],
+                                     const int ni[] )
+{
+    addIndexed( count, verts, vi, norms, ni );
+}
 
-    if( n > 0 ) {
-        // create and fill a new normal array
-        normalArray = new float[ n ];
-        if( normalArray == 0 ) {
-            cerr << "normal allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            normalArray[i] = normals[i];
-        }
+///
+/// Add texture coordinates for a number of vertices
+///
+/// @param count   number of vertices
+/// @param t       their (u,v) data
+///
+template <class L>
+void BasicCanvas<L>::addTextureCoords( size_t count, const TexCoord t[] )
+{
+    if( count < 1 ) {
+        return;
     }
 
-    return normalArray;
+    L *p = slots( numUV, count );
+    for( size_t i = 0; i < count; ++i ) {
+        p[i].setTexCoord( t[i] );
+    }
+    numUV += count;
 }
 
+    /////////////////////////////////////
+    //
+    // Retrieving things from the Canvas
+    //
+    /////////////////////////////////////
+
 ///
-/// Retrieve the array of texture coordinate data from this Canvas
+/// Retrieve the array of element data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to numVertices() indices, or NULL
 ///
-float *Canvas::getUV( void )
+template <class L>
+const GLuint *BasicCanvas<L>::getElements( void )
 {
-    // delete the old texture coordinate array if we have one
-    if( uvArray ) {
-        delete [] uvArray;
-        uvArray = 0;
+    if( numElements < 1 ) {
+        return NULL;
     }
 
-    int n = uv.size();
+    if( isWelded() ) {
+        return &indices[0];
+    }
 
-    if( n > 0 ) {
-        // create and fill a new texture coordinate array
-        uvArray = new float[ n ];
-        if( uvArray == 0 ) {
-            cerr << "uv allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            uvArray[i] = uv[i];
+    if( numElements > NO_VERTEX ) {
+        cerr << "Canvas: " << numElements << " vertices are too many to"
+             << " index without welding" << endl;
+        return NULL;
+    }
+
+    // the indices are always 0, 1, 2, ..., so only the new ones
+    // need to be filled in
+    size_t n = elements.size();
+    if( n < numElements ) {
+        elements.resize( numElements );
+        for( ; n < numElements; n++ ) {
+            elements[n] = n;
         }
     }
 
-    return uvArray;
+    return &elements[0];
 }
 
 ///
-/// Retrieve the array of color data from this Canvas
+/// Retrieve the interleaved vertex data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to numUniqueVertices() vertices, or NULL
 ///
-float *Canvas::getColors( void )
+template <class L>
+const L *BasicCanvas<L>::getVertexData( void )
 {
-    // delete the old color array if we have one
-    if( colorArray ) {
-        delete [] colorArray;
-        colorArray = 0;
+    if( numElements < 1 ) {
+        return NULL;
     }
 
-    int n = colors.size();
+    if( isWelded() ) {
+        return &unique[0];
+    }
 
-    if( n > 0 ) {
-        // create and fill a new color array
-        colorArray = new float[ n ];
-        if( colorArray == 0 ) {
-            cerr << "color allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            colorArray[i] = colors[i];
-        }
+    return &verts[0];
+}
+
+///
+/// Retrieve the number of vertices getVertexData() returns
+///
+/// @return The number of distinct vertices if welding is on, and
+///         otherwise the number of vertices in the canvas
+///
+template <class L>
+size_t BasicCanvas<L>::numUniqueVertices( void )
+{
+    if( numElements > 0 && isWelded() ) {
+        return unique.size();
     }
 
-    return colorArray;
+    return numElements;
 }
 
 ///
@@ -475,7 +721,44 @@ float *Canvas::getColors( void )
 ///
 /// @return The number of vertices in the canvas
 ///
-int Canvas::numVertices( void )
+template <class L>
+size_t BasicCanvas<L>::numVertices( void )
 {
     return numElements;
 }
+
+///
+/// Take the finished mesh out of this Canvas, leaving it empty
+///
+/// @return The vertices getVertexData() would have returned, and,
+///         if the Canvas was welded, the indices into them
+///
+template <class L>
+BasicMeshData<L> BasicCanvas<L>::takeMesh( void )
+{
+    BasicMeshData<L> mesh;
+
+    if( numElements > 0 ) {
+        if( isWelded() ) {
+            mesh.vertices.swap( unique );
+            mesh.elements.swap( indices );
+        } else {
+            // data may have been added for vertices that never came;
+            // the vertices are drawn in order, so there are no indices
+            verts.resize( numElements );
+            mesh.vertices.swap( verts );
+        }
+    }
+
+    clear();
+
+    return mesh;
+}
+
+//
+// The layouts a Canvas can be built with
+//
+template class BasicCanvas<PosNormal>;
+template class BasicCanvas<PosNormalUV>;
+template class BasicCanvas<PosColor>;
+template class BasicCanvas<PosColorNormalUV>;
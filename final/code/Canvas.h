@@ -34,6 +34,31 @@
 //  all the relevant data has been added to the canvas in the proper
 //  sequence.
 //
+//  The data is stored interleaved:  BasicCanvas<L> keeps one L (see
+//  VertexLayout.h) per vertex, holding its location and whichever of
+//  color, normal and (u,v) data the layout L has room for; data for
+//  attributes the layout does not store is ignored.  Each kind of data
+//  is matched to the vertices in the order it was added, so the i-th
+//  normal belongs to the i-th vertex, whether it was added right after
+//  that vertex or later.  'Canvas' is the layout this application uses.
+//
+//  When a mesh is finished, takeMesh() moves its vertices and indices
+//  out of the Canvas into a BasicMeshData<L>, which can be handed to
+//  BufferSet::createBuffers() without copying anything.
+//
+//  With welding turned on (setWelding()), vertices that are identical
+//  in every field are only stored once:  getVertexData() returns the
+//  distinct vertices and getElements() a real index buffer into them,
+//  rather than 0, 1, 2, ...  Since the data for a vertex may arrive
+//  after the vertex itself, the welding is done when the data is first
+//  retrieved after a change, not as each vertex is added.
+//
+//  Counts are 64-bit, but indices are 32-bit:  a Canvas can hold any
+//  number of vertices, but only 2^32-1 distinct ones can be indexed,
+//  so beyond that many vertices, it must be welding (and have fewer
+//  distinct vertices than that).  BufferSet splits big meshes into
+//  pieces each GL buffer can hold.
+//
 
 #ifndef CANVAS_H_
 #define CANVAS_H_
@@ -46,16 +71,105 @@
 #include <GLFW/glfw3.h>
 
 #include "Types.h"
+#include "VertexLayout.h"
 
 using namespace std;
 
 #include <vector>
 
+///
+/// Add up the memory a vector holds, in bytes
+///
+/// @param v          The vector
+/// @param used       Incremented by the bytes holding elements
+/// @param reserved   Incremented by the bytes allocated
+///
+template <class T>
+inline void vectorMemory( const vector<T> &v, size_t &used,
+                          size_t &reserved ) {
+    used += v.size() * sizeof(T);
+    reserved += v.capacity() * sizeof(T);
+}
+
+///
+/// A finished mesh:  the vertices and indices of a drawing, in a form
+/// that doesn't depend on the vertex layout
+///
+class MeshData {
+
+public:
+    ///
+    /// Destructor
+    ///
+    virtual ~MeshData( void ) { }
+
+    ///
+    /// Describe the vertex data
+    ///
+    virtual VertexFormat format( void ) const = 0;
+
+    ///
+    /// Retrieve the vertex count and data
+    ///
+    virtual size_t numVertices( void ) const = 0;
+    virtual const void *getVertexData( void ) const = 0;
+
+    ///
+    /// Retrieve the index count and data; with no data (NULL), the
+    /// vertices are drawn in order
+    ///
+    virtual size_t numElements( void ) const = 0;
+    virtual const GLuint *getElements( void ) const = 0;
+
+    ///
+    /// Add up the memory the mesh holds
+    ///
+    /// @param used       Incremented by the bytes holding data
+    /// @param reserved   Incremented by the bytes allocated
+    ///
+    virtual void memoryUsage( size_t &used, size_t &reserved ) const = 0;
+
+};
+
+///
+/// The mesh taken out of a BasicCanvas<L> (see takeMesh())
+///
+template <class L>
+class BasicMeshData : public MeshData {
+
+public:
+    // the vertices, and the indices drawing them; with no indices,
+    // the vertices are drawn in order
+    vector<L> vertices;
+    vector<GLuint> elements;
+
+    VertexFormat format( void ) const { return L::format(); }
+
+    size_t numVertices( void ) const { return vertices.size(); }
+    const void *getVertexData( void ) const {
+        return vertices.empty() ? NULL : &vertices[0];
+    }
+
+    size_t numElements( void ) const {
+        return elements.empty() ? vertices.size() : elements.size();
+    }
+    const GLuint *getElements( void ) const {
+        return elements.empty() ? NULL : &elements[0];
+    }
+
+    void memoryUsage( size_t &used, size_t &reserved ) const {
+        vectorMemory( vertices, used, reserved );
+        vectorMemory( elements, used, reserved );
+    }
+
+};
+
 ///
 /// Simple canvas class that allows for pixel-by-pixel rendering.
 ///
 
-class Canvas {
+template <class L>
+class BasicCanvas {
 
     //
     // canvas size information
@@ -67,25 +181,29 @@ class Canvas {
     // point-related data
     //
 
-    // vertex locations
-    vector<float> points;
-    float *pointArray;
-
-    // associated normal vectors
-    vector<float> normals;
-    float *normalArray;
-
-    // associated (u,v) coordinates
-    vector<float> uv;
-    float *uvArray;
-
-    // associated color data
-    vector<float> colors;
-    float *colorArray;
-
-    // element count and connectivity data
-    int numElements;
-    GLuint *elemArray;
+    // the vertices, with their associated data
+    vector<L> verts;
+
+    // how many colors, normals and (u,v) pairs have been added
+    size_t numColors;
+    size_t numNormals;
+    size_t numUV;
+
+    // element count and connectivity data; the connectivity is always
+    // 0, 1, 2, ..., so it is kept (and only ever extended) across
+    // calls to clear()
+    size_t numElements;
+    vector<GLuint> elements;
+
+    // vertex welding:  whether it is on, whether 'unique' and 'indices'
+    // are up to date, the distinct vertices and an index for each
+    // vertex added, and the open-addressing hash table used to find
+    // them (index into 'unique', or NO_VERTEX for an empty slot)
+    bool welding;
+    bool welded;
+    vector<L> unique;
+    vector<GLuint> indices;
+    vector<GLuint> table;
 
     //
     // other Canvas defaults
@@ -97,6 +215,23 @@ class Canvas {
     // drawing depth
     float currentDepth;
 
+    // the i-th vertex, making room for it if need be
+    L &slot( size_t i );
+
+    // vertices first .. first+count-1, making room for them if need be
+    L *slots( size_t first, size_t count );
+
+    // addIndexedMesh(), for either type of index
+    template <class I>
+    void addIndexed( size_t count, const Vertex verts[], const I vi[],
+                     const Normal norms[], const I ni[] );
+
+    // find the distinct vertices, and index them
+    void weld( void );
+
+    // weld if need be; returns whether the data is welded
+    bool isWelded( void );
+
 public:
     ///
     /// Constructor
@@ -104,12 +239,12 @@ public:
     /// @param w width of canvas
     /// @param h height of canvas
     ///
-    Canvas( int w, int h );
+    BasicCanvas( int w, int h );
 
     ///
     /// Destructor
     ///
-    ~Canvas( void );
+    ~BasicCanvas( void );
 
     /////////////////////////////////////
     // Basic Canvas manipulation
@@ -118,8 +253,39 @@ public:
     ///
     /// Clear the canvas
     ///
+    /// The memory holding the vertices is kept, so that rebuilding a
+    /// mesh of the same size (or smaller) allocates nothing.
+    ///
     void clear( void );
 
+    ///
+    /// Make room for a number of vertices, so that adding that many
+    /// vertices and their data allocates no memory
+    ///
+    /// @param vertices   The number of vertices expected
+    ///
+    void reserve( size_t vertices );
+
+    ///
+    /// Number of vertices the Canvas has room for
+    ///
+    size_t capacity( void ) const { return verts.capacity(); }
+
+    ///
+    /// Add up the memory the Canvas holds:  its vertices and indices,
+    /// and the welded copies and hash table if it has them
+    ///
+    /// @param used       Incremented by the bytes holding data
+    /// @param reserved   Incremented by the bytes allocated, including
+    ///                   the spare capacity of each vector
+    ///
+    void memoryUsage( size_t &used, size_t &reserved ) const;
+
+    ///
+    /// Clear the canvas and give back the memory holding its vertices
+    ///
+    void release( void );
+
     ///
     /// Set the pixel Z coordinate
     ///
@@ -136,6 +302,14 @@ public:
     ///
     Color setColor( Color color );
 
+    ///
+    /// Turn vertex welding on or off
+    ///
+    /// @param on   Whether identical vertices should be stored once
+    /// @return  The old setting
+    ///
+    bool setWelding( bool on );
+
     /////////////////////////////////////
     //
     // Adding things to the Canvas
@@ -239,53 +413,119 @@ public:
     void addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 );
 
     /////////////////////////////////////
+    // Whole meshes at once
     //
-    // Retrieving things from the Canvas
-    //
+    // These do what the calls above would do for each vertex, but
+    // make room for all the vertices at once and fill them in with a
+    // simple loop, rather than a few function calls per vertex.
     /////////////////////////////////////
 
     ///
-    /// Retrieve the array of element data from this Canvas
+    /// Add a number of vertices (every three making a triangle), and
+    /// optionally a normal for each
+    ///
+    /// @param count   number of vertices
+    /// @param v       the vertices
+    /// @param n       their normals (or NULL)
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    void addTriangles( size_t count, const Vertex v[],
+                       const Normal n[] = NULL );
+
+    ///
+    /// Add a mesh given as an indexed triangle list
+    ///
+    /// Vertex i added is verts[vi[i]], and its normal norms[ni[i]];
+    /// without ni, the normals use the same indices as the vertices,
+    /// and without norms, each triangle gets a triangle-wide normal,
+    /// as addTriangle() gives it.
     ///
-    GLuint *getElements( void );
+    /// @param count   number of indices; only whole triangles are added
+    /// @param verts   the vertices
+    /// @param vi      index of each vertex to add
+    /// @param norms   the normals (or NULL)
+    /// @param ni      index of each normal to add (or NULL)
+    ///
+    void addIndexedMesh( size_t count, const Vertex verts[],
+                         const GLuint vi[], const Normal norms[] = NULL,
+                         const GLuint ni[] = NULL );
+    void addIndexedMesh( size_t count, const Vertex verts[],
+                         const int vi[], const Normal norms[] = NULL,
+                         const int ni[] = NULL );
 
     ///
-    /// Retrieve the array of vertex data from this Canvas
+    /// Add texture coordinates for a number of vertices
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @param count   number of vertices
+    /// @param t       their (u,v) data
     ///
-    float *getVertices( void );
+    void addTextureCoords( size_t count, const TexCoord t[] );
+
+    /////////////////////////////////////
+    //
+    // Retrieving things from the Canvas
+    //
+    // These return pointers into the Canvas's own storage; nothing is
+    // copied.  A pointer stays valid until the next call that adds
+    // anything to the Canvas, or clears it, or until the Canvas is
+    // destroyed, and must not be freed by the caller.
+    //
+    /////////////////////////////////////
 
     ///
-    /// Retrieve the array of normal data from this Canvas
+    /// Retrieve the array of element data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to numVertices() indices, or NULL
     ///
-    float *getNormals( void );
+    const GLuint *getElements( void );
 
     ///
-    /// Retrieve the array of (u,v) data from this Canvas
+    /// Retrieve the interleaved vertex data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to numUniqueVertices() vertices, or NULL
     ///
-    float *getUV( void );
+    const L *getVertexData( void );
 
     ///
-    /// Retrieve the array of color data from this Canvas
+    /// Retrieve the number of vertices getVertexData() returns:  the
+    /// number of distinct vertices if welding is on, and otherwise
+    /// the same as numVertices()
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    size_t numUniqueVertices( void );
+
+    ///
+    /// Describe the interleaved vertex data
+    ///
+    /// @return The size of a vertex and the offset of each attribute
     ///
-    float *getColors( void );
+    static VertexFormat format( void ) { return L::format(); }
 
     ///
     /// Retrieve the vertex count from this Canvas
     ///
     /// @return The number of vertices in the canvas
     ///
-    int numVertices( void );
+    size_t numVertices( void );
+
+    ///
+    /// Take the finished mesh out of this Canvas, leaving it empty
+    ///
+    /// The vertices and indices are moved, not copied:  the mesh
+    /// takes over the memory holding them, so the Canvas has to grow
+    /// again when the next drawing is added.  An unwelded Canvas
+    /// gives no indices:  its vertices are drawn in order.
+    ///
+    /// @return The vertices getVertexData() would have returned, and,
+    ///         if the Canvas was welded, the indices into them
+    ///
+    BasicMeshData<L> takeMesh( void );
 
 };
 
+//
+// The layout used by this application:  every object is shaded, and
+// some are textured
+//
+typedef BasicCanvas<PosNormalUV> Canvas;
+typedef BasicMeshData<PosNormalUV> CanvasMesh;
+
 #endif
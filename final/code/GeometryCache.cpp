@@ -0,0 +1,336 @@
+//
+//  GeometryCache.cpp
+//
+//  On-disk cache of built meshes.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "GeometryCache.h"
+#include "Utils.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// bump CACHE_VERSION whenever the layout of the file changes
+static const char CACHE_MAGIC[8] = { 'G', 'E', 'O', 'C', 'A', 'C', 'H', 'E' };
+static const uint32_t CACHE_VERSION = 3;
+
+//
+// The start of a cache file
+//
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;        // sizeof(CacheHeader)
+    uint64_t key;
+    int32_t stride, position, color, normal, texCoord;
+    int32_t unused;
+    uint64_t numVertices;
+    uint64_t numElements;       // 0 if the vertices are drawn in order
+    uint64_t vertexOffset;      // where the vertices start
+    uint64_t elementOffset;     // where the indices start
+    uint64_t fileSize;
+};
+
+//
+// What cacheStore() writes
+//
+struct CacheFile {
+    const CacheHeader *h;
+    const void *verts;
+    const GLuint *elements;
+};
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// writeCacheFile() - write a cache file's contents (see replaceFile())
+///
+/// @param fp    where to write them
+/// @param arg   the CacheFile to write
+///
+/// @return true if everything was written
+///
+static bool writeCacheFile( FILE *fp, void *arg ) {
+    const CacheFile *f = (const CacheFile *) arg;
+    const CacheHeader &h = *f->h;
+
+    static const char zeros[16] = { 0 };
+    size_t vbytes = (size_t) h.numVertices * h.stride;
+    size_t ebytes = (size_t) h.numElements * sizeof(GLuint);
+    return( fwrite( &h, sizeof(h), 1, fp ) == 1 &&
+        fwrite( zeros, 1, h.vertexOffset - sizeof(h), fp ) ==
+            h.vertexOffset - sizeof(h) &&
+        (vbytes == 0 || fwrite( f->verts, 1, vbytes, fp ) == vbytes) &&
+        fwrite( zeros, 1, h.elementOffset - h.vertexOffset - vbytes, fp ) ==
+            h.elementOffset - h.vertexOffset - vbytes &&
+        (ebytes == 0 || fwrite( f->elements, 1, ebytes, fp ) == ebytes) );
+}
+
+///
+/// align16() - round an offset up to a multiple of 16
+///
+static uint64_t align16( uint64_t n ) {
+    return( (n + 15) & ~(uint64_t) 15 );
+}
+
+///
+/// mapFile() - map a whole file into memory, read-only
+///
+/// @param path   the file
+/// @param size   receives its size
+///
+/// @return the mapping, or NULL
+///
+static void *mapFile( const char *path, size_t &size ) {
+#if defined(_WIN32) || defined(_WIN64)
+    // no mmap() here; just read it in
+    FILE *fp = fopen( path, "rb" );
+    if( fp == NULL ) {
+        return( NULL );
+    }
+    fseek( fp, 0, SEEK_END );
+    long len = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    void *data = NULL;
+    if( len > 0 ) {
+        data = new char[len];
+        if( fread( data, 1, len, fp ) != (size_t) len ) {
+            delete [] (char *) data;
+            data = NULL;
+        }
+    }
+    fclose( fp );
+    size = len;
+    return( data );
+#else
+    int fd = open( path, O_RDONLY );
+    if( fd < 0 ) {
+        return( NULL );
+    }
+
+    struct stat st;
+    void *data = NULL;
+    if( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+        data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( data == MAP_FAILED ) {
+            data = NULL;
+        }
+        size = st.st_size;
+    }
+
+    // the mapping stays valid after the file is closed
+    close( fd );
+    return( data );
+#endif
+}
+
+///
+/// unmapFile() - undo mapFile()
+///
+static void unmapFile( void *data, size_t size ) {
+#if defined(_WIN32) || defined(_WIN64)
+    (void) size;
+    delete [] (char *) data;
+#else
+    munmap( data, size );
+#endif
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Hash some data into a cache key (64-bit FNV-1a)
+///
+/// @param data   the data to hash
+/// @param len    its length in bytes
+/// @param h      the key so far (CACHE_KEY_INIT to start)
+///
+/// @return the new key
+///
+uint64_t cacheHash( const void *data, size_t len, uint64_t h ) {
+    const unsigned char *p = (const unsigned char *) data;
+
+    for( size_t i = 0; i < len; ++i ) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+
+    return( h );
+}
+
+///
+/// Make sure a directory for cache files exists
+///
+/// @param dir   the directory
+///
+/// @return true if it exists (or was created)
+///
+bool cacheDirectory( const char *dir ) {
+    struct stat st;
+
+    if( stat( dir, &st ) == 0 ) {
+        return( (st.st_mode & S_IFDIR) != 0 );
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    return( _mkdir( dir ) == 0 );
+#else
+    return( mkdir( dir, 0755 ) == 0 );
+#endif
+}
+
+///
+/// Map a cached mesh into memory
+///
+/// @param path   the cache file
+/// @param key    the key the mesh must have been stored with
+/// @param fmt    the layout its vertices must have
+/// @param mesh   receives the mesh
+///
+/// @return true if the file held a matching mesh
+///
+bool cacheLoad( const char *path, uint64_t key, const VertexFormat &fmt,
+                CachedMesh &mesh ) {
+
+    mesh.map = NULL;
+    mesh.mapSize = 0;
+
+    size_t size = 0;
+    void *data = mapFile( path, size );
+    if( data == NULL ) {
+        // not cached yet
+        return( false );
+    }
+
+    // check that this is the mesh we want, and that the file is whole
+    CacheHeader h;
+    bool ok = size >= sizeof(h);
+    if( ok ) {
+        memcpy( &h, data, sizeof(h) );
+        ok = memcmp( h.magic, CACHE_MAGIC, sizeof(h.magic) ) == 0 &&
+             h.version == CACHE_VERSION &&
+             h.headerSize == sizeof(h) &&
+             h.key == key &&
+             h.stride == fmt.stride && h.position == fmt.position &&
+             h.color == fmt.color && h.normal == fmt.normal &&
+             h.texCoord == fmt.texCoord &&
+             h.fileSize == size &&
+             h.numVertices <= size && h.numElements <= size &&
+             h.vertexOffset <= size && h.elementOffset <= size &&
+             h.elementOffset % sizeof(GLuint) == 0 &&
+             h.vertexOffset + h.numVertices * h.stride <= size &&
+             h.elementOffset + h.numElements * sizeof(GLuint) <= size;
+    }
+
+    if( !ok ) {
+        cerr << "Ignoring out-of-date geometry cache file " << path << endl;
+        unmapFile( data, size );
+        return( false );
+    }
+
+    // every index must name a vertex; a damaged one would have
+    // BufferSet::splitMesh() or the GPU read or write past the end
+    const GLuint *elements =
+        (const GLuint *) ((const char *) data + h.elementOffset);
+    for( uint64_t i = 0; i < h.numElements; ++i ) {
+        if( elements[i] >= h.numVertices ) {
+            cerr << "Ignoring corrupt geometry cache file " << path << endl;
+            unmapFile( data, size );
+            return( false );
+        }
+    }
+
+    mesh.format = fmt;
+    mesh.numVertices = h.numVertices;
+    mesh.numElements = h.numElements > 0 ? h.numElements : h.numVertices;
+    mesh.vertices = (const char *) data + h.vertexOffset;
+    mesh.elements = h.numElements > 0 ? elements : NULL;
+    mesh.map = data;
+    mesh.mapSize = size;
+
+    return( true );
+}
+
+///
+/// Unmap a mesh returned by cacheLoad()
+///
+/// @param mesh   the mesh
+///
+void cacheUnmap( CachedMesh &mesh ) {
+    if( mesh.map != NULL ) {
+        unmapFile( mesh.map, mesh.mapSize );
+        mesh.map = NULL;
+        mesh.mapSize = 0;
+    }
+}
+
+///
+/// Save a mesh in the cache
+///
+/// @param path      the cache file
+/// @param key       the key identifying what the mesh was built from
+/// @param fmt       layout of one vertex
+/// @param nv        number of vertices
+/// @param verts     the vertex data
+/// @param ne        number of indices
+/// @param elements  the connectivity data (NULL if drawn in order)
+///
+/// @return true if the mesh was saved
+///
+bool cacheStore( const char *path, uint64_t key, const VertexFormat &fmt,
+                 size_t nv, const void *verts, size_t ne,
+                 const GLuint *elements ) {
+
+    // a mesh drawn in order is stored without indices
+    if( elements == NULL ) {
+        ne = 0;
+    }
+
+    CacheHeader h;
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.magic, CACHE_MAGIC, sizeof(h.magic) );
+    h.version = CACHE_VERSION;
+    h.headerSize = sizeof(h);
+    h.key = key;
+    h.stride = fmt.stride;
+    h.position = fmt.position;
+    h.color = fmt.color;
+    h.normal = fmt.normal;
+    h.texCoord = fmt.texCoord;
+    h.numVertices = nv;
+    h.numElements = ne;
+    h.vertexOffset = align16( sizeof(h) );
+    h.elementOffset = align16( h.vertexOffset + (uint64_t) nv * fmt.stride );
+    h.fileSize = h.elementOffset + (uint64_t) ne * sizeof(GLuint);
+
+    CacheFile f = { &h, verts, elements };
+    if( !replaceFile( path, writeCacheFile, &f ) ) {
+        cerr << "Can't write geometry cache file " << path << endl;
+        return( false );
+    }
+
+    return( true );
+}
@@ -0,0 +1,123 @@
+//
+//  GeometryCache.h
+//
+//  On-disk cache of built meshes.
+//
+//  Building a mesh (computing its normals and texture coordinates,
+//  adding each vertex to a Canvas, welding) gives the same vertex and
+//  index data every time, as long as the code and data it is built
+//  from are the same.  This module saves that data to a file, along
+//  with a key identifying what it was built from, and at the next
+//  startup maps the file into memory, so the data can be handed to
+//  BufferSet::createBuffers() without building the mesh at all.
+//
+//  The file holds a header (magic number, version, key, vertex layout
+//  and counts) followed by the vertices and then the indices, each
+//  starting on a 16-byte boundary.  A file whose header does not
+//  match what is asked for, or that holds an index past the last
+//  vertex, is ignored, and is replaced when the mesh is stored again.
+//
+
+#ifndef GEOMETRYCACHE_H_
+#define GEOMETRYCACHE_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "VertexLayout.h"
+
+///
+/// A mesh read from the cache; the pointers are into the mapped file
+///
+struct CachedMesh {
+    VertexFormat format;        // layout of one vertex
+    size_t numVertices;         // number of vertices
+    size_t numElements;         // number of indices
+    const void *vertices;       // the vertex data
+    const GLuint *elements;     // the connectivity data, or NULL
+                                // if the vertices are drawn in order
+
+    // the mapping itself
+    void *map;
+    size_t mapSize;
+};
+
+///
+/// Hash some data into a cache key (64-bit FNV-1a)
+///
+/// Keys are built up by hashing each input in turn, passing the
+/// result of one call as 'h' to the next.
+///
+/// @param data   the data to hash
+/// @param len    its length in bytes
+/// @param h      the key so far (CACHE_KEY_INIT to start)
+///
+/// @return the new key
+///
+#define CACHE_KEY_INIT  14695981039346656037ULL
+uint64_t cacheHash( const void *data, size_t len, uint64_t h );
+
+//
+// The version of the code that generates the meshes:  the builders in
+// Models.cpp, the Canvas (normals, welding order) and the vertex
+// layouts in VertexLayout.h.  It is part of every object's key, so
+// bump it whenever any of those change the vertices or indices they
+// produce; otherwise the cache keeps serving the old meshes.
+//
+#define GEOMETRY_GENERATOR_VERSION      1
+
+///
+/// Make sure a directory for cache files exists
+///
+/// @param dir   the directory
+///
+/// @return true if it exists (or was created)
+///
+bool cacheDirectory( const char *dir );
+
+///
+/// Map a cached mesh into memory
+///
+/// @param path   the cache file
+/// @param key    the key the mesh must have been stored with
+/// @param fmt    the layout its vertices must have
+/// @param mesh   receives the mesh
+///
+/// @return true if the file held a matching mesh with valid indices;
+///         if not, 'mesh' is left unmapped
+///
+bool cacheLoad( const char *path, uint64_t key, const VertexFormat &fmt,
+                CachedMesh &mesh );
+
+///
+/// Unmap a mesh returned by cacheLoad()
+///
+/// @param mesh   the mesh
+///
+void cacheUnmap( CachedMesh &mesh );
+
+///
+/// Save a mesh in the cache (through replaceFile(), see Utils.h)
+///
+/// @param path      the cache file
+/// @param key       the key identifying what the mesh was built from
+/// @param fmt       layout of one vertex
+/// @param nv        number of vertices
+/// @param verts     the vertex data
+/// @param ne        number of indices
+/// @param elements  the connectivity data (NULL if drawn in order)
+///
+/// @return true if the mesh was saved
+///
+bool cacheStore( const char *path, uint64_t key, const VertexFormat &fmt,
+                 size_t nv, const void *verts, size_t ne,
+                 const GLuint *elements );
+
+#endif
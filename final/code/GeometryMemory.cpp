@@ -0,0 +1,229 @@
+//
+//  GeometryMemory.cpp
+//
+//  Accounting of the memory held by the objects' geometry.
+//
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "GeometryMemory.h"
+#include "Utils.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// the names of the kinds of memory, as they appear in the JSON
+static const char *kindNames[N_MEMKINDS] = { "staging", "gpu" };
+
+//
+// Everything reported for one object
+//
+struct MemObject {
+    MemUsage kind[N_MEMKINDS];
+};
+
+// the objects, by name, and the totals; 'memLock' guards them all
+static map<string,MemObject> objectMem;
+static MemUsage totalMem[N_MEMKINDS];
+static mutex memLock;
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// writeUsage() - write one MemUsage as a JSON object
+///
+/// @param out   where to write it
+/// @param u     the figures
+///
+static void writeUsage( ostream &out, const MemUsage &u ) {
+    out << "{ \"used\": " << u.used
+        << ", \"reserved\": " << u.reserved
+        << ", \"peak\": " << u.peak << " }";
+}
+
+///
+/// writeKinds() - write the figures for each kind of memory
+///
+/// @param out      where to write them
+/// @param u        the figures, one per kind
+/// @param indent   how far to indent them
+///
+static void writeKinds( ostream &out, const MemUsage u[], const char *indent ) {
+    out << "{" << endl;
+    for( int k = 0; k < N_MEMKINDS; ++k ) {
+        out << indent << "  \"" << kindNames[k] << "\": ";
+        writeUsage( out, u[k] );
+        out << (k + 1 < N_MEMKINDS ? "," : "") << endl;
+    }
+    out << indent << "}";
+}
+
+///
+/// writeString() - write a string as a JSON string
+///
+/// @param out   where to write it
+/// @param s     the string
+///
+static void writeString( ostream &out, const string &s ) {
+    out << '"';
+    for( size_t i = 0; i < s.size(); ++i ) {
+        unsigned char c = s[i];
+        if( c == '"' || c == '\\' ) {
+            out << '\\' << c;
+        } else if( c < ' ' ) {
+            char hex[8];
+            snprintf( hex, sizeof(hex), "\\u%04x", c );
+            out << hex;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+///
+/// writeReport() - write the JSON report to a file (see replaceFile())
+///
+/// @param fp    where to write it
+/// @param arg   unused
+///
+/// @return true if it was written
+///
+static bool writeReport( FILE *fp, void * ) {
+    ostringstream out;
+    memDumpJSON( out );
+    string s = out.str();
+    return( fwrite( s.data(), 1, s.size(), fp ) == s.size() );
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Report the memory an object holds
+///
+/// @param name       the object
+/// @param kind       the kind of memory
+/// @param used       bytes holding data
+/// @param reserved   bytes allocated
+///
+void memRecord( const char *name, MemKind kind, size_t used,
+                size_t reserved ) {
+
+    if( (int) kind < 0 || kind >= N_MEMKINDS ) {
+        cerr << "memRecord(): bad memory kind " << kind << endl;
+        return;
+    }
+
+    lock_guard<mutex> hold( memLock );
+
+    // a new object starts out holding nothing
+    map<string,MemObject>::iterator it = objectMem.find( name );
+    if( it == objectMem.end() ) {
+        MemObject none = {};
+        it = objectMem.insert( make_pair( string(name), none ) ).first;
+    }
+
+    // replace the object's share of the total with the new figures
+    MemUsage &u = it->second.kind[kind];
+    MemUsage &t = totalMem[kind];
+    t.used = t.used - u.used + used;
+    t.reserved = t.reserved - u.reserved + reserved;
+
+    u.used = used;
+    u.reserved = reserved;
+
+    if( u.reserved > u.peak ) {
+        u.peak = u.reserved;
+    }
+    if( t.reserved > t.peak ) {
+        t.peak = t.reserved;
+    }
+}
+
+///
+/// Retrieve the memory an object holds
+///
+/// @param name   the object
+/// @param kind   the kind of memory
+///
+/// @return its current and peak usage (all 0 if it never reported)
+///
+MemUsage memObject( const char *name, MemKind kind ) {
+    MemUsage none = { 0, 0, 0 };
+
+    if( (int) kind < 0 || kind >= N_MEMKINDS ) {
+        return( none );
+    }
+
+    lock_guard<mutex> hold( memLock );
+
+    map<string,MemObject>::const_iterator it = objectMem.find( name );
+    return( it == objectMem.end() ? none : it->second.kind[kind] );
+}
+
+///
+/// Retrieve the memory all the objects hold
+///
+/// @param kind   the kind of memory
+///
+/// @return the current and peak total
+///
+MemUsage memTotal( MemKind kind ) {
+    MemUsage none = { 0, 0, 0 };
+
+    if( (int) kind < 0 || kind >= N_MEMKINDS ) {
+        return( none );
+    }
+
+    lock_guard<mutex> hold( memLock );
+    return( totalMem[kind] );
+}
+
+///
+/// Write all the figures as a JSON object
+///
+/// @param out   where to write it
+///
+void memDumpJSON( ostream &out ) {
+    lock_guard<mutex> hold( memLock );
+
+    out << "{" << endl << "  \"objects\": {";
+    for( map<string,MemObject>::const_iterator it = objectMem.begin();
+         it != objectMem.end(); ++it ) {
+        out << (it == objectMem.begin() ? "" : ",") << endl << "    ";
+        writeString( out, it->first );
+        out << ": ";
+        writeKinds( out, it->second.kind, "    " );
+    }
+    out << endl << "  }," << endl << "  \"total\": ";
+    writeKinds( out, totalMem, "  " );
+    out << endl << "}" << endl;
+}
+
+///
+/// Write all the figures to a JSON file
+///
+/// @param path   the file
+///
+/// @return true if the file was written
+///
+bool memWriteJSON( const char *path ) {
+    if( !replaceFile( path, writeReport, NULL ) ) {
+        cerr << "Can't write geometry memory report " << path << endl;
+        return( false );
+    }
+
+    return( true );
+}
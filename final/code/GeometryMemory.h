@@ -0,0 +1,102 @@
+//
+//  GeometryMemory.h
+//
+//  Accounting of the memory held by the objects' geometry.
+//
+//  Each object reports what its geometry holds, under its name:  the
+//  CPU memory used to build and upload it (its Canvas, a mesh moved
+//  out of the Canvas or mapped from the geometry cache, and the
+//  temporary copies made while uploading), and the GPU memory of its
+//  vertex and element buffers.  A report replaces the object's
+//  previous one, so the figures are always the current ones.
+//
+//  For each object, and for all of them together, this module keeps
+//  the bytes holding data ("used"), the bytes allocated for it
+//  ("reserved", which includes the spare capacity of vectors) and the
+//  largest "reserved" figure seen so far ("peak").  The figures can
+//  be read back one at a time, or written out as JSON.
+//
+//  The functions may be called from any thread.
+//
+
+#ifndef GEOMETRYMEMORY_H_
+#define GEOMETRYMEMORY_H_
+
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+
+//
+// The kinds of memory accounted for
+//
+typedef
+    enum memkind_e {
+        MemStaging = 0,     // CPU memory:  Canvases, meshes, upload copies
+        MemGPU              // vertex and element buffers
+        // Sentinel gives us the number of kinds
+        , N_MEMKINDS
+    } MemKind;
+
+//
+// The memory of one kind held by one object, or by all of them
+//
+struct MemUsage {
+    size_t used;        // bytes holding data
+    size_t reserved;    // bytes allocated
+    size_t peak;        // the most bytes ever allocated
+};
+
+///
+/// Report the memory an object holds
+///
+/// @param name       the object
+/// @param kind       the kind of memory
+/// @param used       bytes holding data
+/// @param reserved   bytes allocated
+///
+void memRecord( const char *name, MemKind kind, size_t used,
+                size_t reserved );
+
+///
+/// Retrieve the memory an object holds
+///
+/// @param name   the object
+/// @param kind   the kind of memory
+///
+/// @return its current and peak usage (all 0 if it never reported)
+///
+MemUsage memObject( const char *name, MemKind kind );
+
+///
+/// Retrieve the memory all the objects hold
+///
+/// @param kind   the kind of memory
+///
+/// @return the current and peak total
+///
+MemUsage memTotal( MemKind kind );
+
+///
+/// Write all the figures as a JSON object
+///
+/// The object has a member "objects", holding one member per object,
+/// and a member "total"; each of those holds a member per kind of
+/// memory ("staging" and "gpu"), each with members "used", "reserved"
+/// and "peak".
+///
+/// @param out   where to write it
+///
+void memDumpJSON( ostream &out );
+
+///
+/// Write all the figures to a JSON file (see memDumpJSON()), through
+/// replaceFile() (see Utils.h)
+///
+/// @param path   the file
+///
+/// @return true if the file was written
+///
+bool memWriteJSON( const char *path );
+
+#endif
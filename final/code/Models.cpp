@@ -10,9 +10,15 @@
 //
 //  Contributor:  Owen Sullivan
 //
+//  Changing what the builders here produce means bumping
+//  GEOMETRY_GENERATOR_VERSION (GeometryCache.h).
+//
 
 #include <iostream>
 #include <cmath>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -23,6 +29,7 @@
 #include <glm/vec3.hpp>
 
 #include "Models.h"
+#include "GeometryCache.h"
 
 // data for the three objects
 #include "CylinderData.h"
@@ -45,7 +52,7 @@ float PI  = 3.141592654;
 
 // object names (must match the sequence in Models.h)
 const char *objects[ N_OBJECTS ] = {
-    "Quad", "Cylinder", "Discs", "Teapot", "Cube"
+    "Quad", "Cylinder", "Discs", "Teapot", "Cube", "Basket", "Sphere"
 };
 
 //
@@ -78,6 +85,10 @@ TexCoord convertVertexToTexCoordDisc(Vertex vertex) {
 ///
 static void makeQuad( Canvas &C )
 {
+    // one Canvas vertex per element; making room for all of them up
+    // front means the Canvas never has to grow while we add them
+    C.reserve( quadElementsLength );
+
     for( int i = 0; i < quadElementsLength - 2; i += 3 ) {
 
         // Calculate the base indices of the three vertices
@@ -117,26 +128,10 @@ Normal calculateNormal(Vertex p1, Vertex p2, Vertex p3) {
 ///
 static void makeCube( Canvas &C )
 {
-    for( int i = 0; i < cubeElementsLength - 2; i += 3 ) {
-
-        // Calculate the base indices of the three vertices
-        int point1 = cubeElements[i];
-        int point2 = cubeElements[i + 1];
-        int point3 = cubeElements[i + 2];
-
-        Vertex p1 = cubeVertices[point1];
-        Vertex p2 = cubeVertices[point2];
-        Vertex p3 = cubeVertices[point3];
-
-        // Add this triangle to the collection
-        Normal norm = calculateNormal(p1, p2, p3);
+    C.reserve( cubeElementsLength );
 
-        C.addTriangleWithNorms( p1, norm, p2, norm, p3, norm );
-
-        // // Add the texture coordinates
-        // C.addTextureCoords( quadUV[point1], quadUV[point2],
-        //                     quadUV[point3] );
-    }
+    // every triangle, with a triangle-wide normal
+    C.addIndexedMesh( cubeElementsLength, cubeVertices, cubeElements );
 }
 
 ///
@@ -145,6 +140,8 @@ static void makeCube( Canvas &C )
 void makeCylinder( Canvas &C )
 {
     // Only use the vertices for the body itself
+    C.reserve( body.nverts );
+
     for( int i = body.first; i <= body.last - 2; i += 3 ) {
 
         // Calculate the base indices of the three vertices
@@ -180,6 +177,7 @@ void makeCylinder( Canvas &C )
 static void makeDiscs( Canvas &C )
 {
     // Only use the vertices for the top and bottom discs
+    C.reserve( bdisc.nverts + tdisc.nverts );
 
     for( int disc = 0; disc < 2; ++disc ) {
 
@@ -222,35 +220,25 @@ static void makeDiscs( Canvas &C )
 
 static void createTeapot( Canvas &C )
 {
-    for( int i = 0; i < teapotElementsLen - 2; i += 3 ) {
-        C.addTriangleWithNorms(
-          teapotVerts[ teapotElements[i] ],   teapotNorms[ teapotNormIx[i] ],
-          teapotVerts[ teapotElements[i+1] ], teapotNorms[ teapotNormIx[i+1] ],
-          teapotVerts[ teapotElements[i+2] ], teapotNorms[ teapotNormIx[i+2] ]
-        );
+    C.reserve( teapotElementsLen );
 
-    }
+    // the normals have their own indices
+    C.addIndexedMesh( teapotElementsLen, teapotVerts, teapotElements,
+                      teapotNorms, teapotNormIx );
 }
 
 static void makeBasket( Canvas &C )
 {
-    for( int i = 0; i < basketElementsLen - 2; i += 3 ) {
-        Vertex p1 = basketVerts[ basketElements[i] ];
-        Vertex p2 = basketVerts[ basketElements[i+1] ];
-        Vertex p3 = basketVerts[ basketElements[i+2] ];
+    C.reserve( basketElementsLen );
 
-        Normal norm = calculateNormal(p1, p2, p3);
-        C.addTriangleWithNorms(
-          p1,   norm,
-          p2, norm,
-          p3, norm 
-        );
-
-    }
+    // every triangle, with a triangle-wide normal
+    C.addIndexedMesh( basketElementsLen, basketVerts, basketElements );
 }
 
 static void makeSphere( Canvas &C )
 {
+    C.reserve( sphereElementsLength );
+
     for( int i = 0; i < sphereElementsLength - 2; i += 3 ) {
         Vertex p1 = sphereVertices[ sphereElements[i] ];
         Vertex p2 = sphereVertices[ sphereElements[i+1] ];
@@ -268,6 +256,25 @@ static void makeSphere( Canvas &C )
 }
 
 
+///
+/// buildWorker() - build objects until there are none left, taking
+///     the next one not yet taken each time
+///
+/// @param C      one Canvas per object
+/// @param objs   which objects to build
+/// @param n      number of objects
+/// @param next   index of the next object to build, shared by all
+///
+static void buildWorker( Canvas *C[], const Object objs[], int n,
+                         atomic<int> *next )
+{
+    int i;
+
+    while( (i = next->fetch_add( 1 )) < n ) {
+        buildObject( *C[i], objs[i] );
+    }
+}
+
 //
 // PUBLIC FUNCTIONS
 //
@@ -280,6 +287,21 @@ static void makeSphere( Canvas &C )
 /// @param buf    BufferSet to use for the object
 ///
 void createObject( Canvas &C, Object obj, BufferSet &buf )
+{
+    buildObject( C, obj );
+
+    // create the buffers for the object; the Canvas is cleared for
+    // the next object anyway, so move the mesh out of it
+    buf.createBuffers( C.takeMesh() );
+}
+
+///
+/// Build an object's geometry, without creating its buffers
+///
+/// @param C      the Canvas to build the object in
+/// @param obj    which object to build
+///
+void buildObject( Canvas &C, Object obj )
 {
     // start with a fresh Canvas
     C.clear();
@@ -295,6 +317,97 @@ void createObject( Canvas &C, Object obj, BufferSet &buf )
     case Sphere:      makeSphere( C ); break;
     }
 
-    // create the buffers for the object
-    buf.createBuffers( C );
+    // weld the vertices (if the Canvas does that) here, rather than
+    // when the buffers are created
+    C.getVertexData();
+}
+
+///
+/// Compute the key identifying what an object is built from
+///
+/// @param obj    which object
+///
+/// @return the key
+///
+uint64_t objectKey( Object obj )
+{
+    // the code building the objects is part of what they are built
+    // from; GEOMETRY_GENERATOR_VERSION stands for it, and the layout
+    // says how its output is stored
+    const uint32_t version = GEOMETRY_GENERATOR_VERSION;
+    uint64_t h = cacheHash( &version, sizeof(version), CACHE_KEY_INIT );
+
+    VertexFormat fmt = Canvas::format();
+    h = cacheHash( &fmt, sizeof(fmt), h );
+
+    h = cacheHash( &obj, sizeof(obj), h );
+    h = cacheHash( &PI, sizeof(PI), h );
+
+    // and so is the object's data
+    switch( obj ) {
+    case Quad:
+        h = cacheHash( quadVertices, sizeof(quadVertices), h );
+        h = cacheHash( quadUV, sizeof(quadUV), h );
+        h = cacheHash( &quadNorm, sizeof(quadNorm), h );
+        h = cacheHash( quadElements, sizeof(quadElements), h );
+        break;
+    case Cylinder:
+    case Discs:
+        h = cacheHash( cylinderVertices, sizeof(cylinderVertices), h );
+        h = cacheHash( cylinderElements, sizeof(cylinderElements), h );
+        h = cacheHash( &bdisc, sizeof(bdisc), h );
+        h = cacheHash( &body, sizeof(body), h );
+        h = cacheHash( &tdisc, sizeof(tdisc), h );
+        break;
+    case Teapot:
+        h = cacheHash( teapotVerts, sizeof(teapotVerts), h );
+        h = cacheHash( teapotNorms, sizeof(teapotNorms), h );
+        h = cacheHash( teapotElements, sizeof(teapotElements), h );
+        h = cacheHash( teapotNormIx, sizeof(teapotNormIx), h );
+        break;
+    case Cube:
+        h = cacheHash( cubeVertices, sizeof(cubeVertices), h );
+        h = cacheHash( cubeElements, sizeof(cubeElements), h );
+        break;
+    case Basket:
+        h = cacheHash( basketVerts, sizeof(basketVerts), h );
+        h = cacheHash( basketElements, sizeof(basketElements), h );
+        break;
+    case Sphere:
+        h = cacheHash( sphereVertices, sizeof(sphereVertices), h );
+        h = cacheHash( sphereElements, sizeof(sphereElements), h );
+        break;
+    }
+
+    return( h );
+}
+
+///
+/// Build the geometry of several objects, spread across threads
+///
+/// @param C        one Canvas per object; objs[i] is built in C[i]
+/// @param objs     which objects to build
+/// @param n        number of objects
+/// @param threads  number of worker threads (0 for one per core)
+///
+void buildObjects( Canvas *C[], const Object objs[], int n, int threads )
+{
+    if( threads <= 0 ) {
+        threads = thread::hardware_concurrency();
+    }
+    threads = max( 1, min( threads, n ) );
+
+    // the objects differ a lot in size, so rather than giving each
+    // worker a fixed share, each takes the next object when it is
+    // done with the last; the calling thread works too
+    atomic<int> next( 0 );
+    vector<thread> workers;
+    for( int t = 1; t < threads; ++t ) {
+        workers.push_back( thread( buildWorker, C, objs, n, &next ) );
+    }
+    buildWorker( C, objs, n, &next );
+
+    for( size_t t = 0; t < workers.size(); ++t ) {
+        workers[t].join();
+    }
 }
\ No newline at end of file
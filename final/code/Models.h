@@ -13,6 +13,8 @@
 #ifndef MODELS_H_
 #define MODELS_H_
 
+#include <stdint.h>
+
 #include "Buffers.h"
 #include "Canvas.h"
 
@@ -46,4 +48,41 @@ extern const char *objects[ N_OBJECTS ];
 ///
 void createObject( Canvas &C, Object obj, BufferSet &buf );
 
+///
+/// Build an object's geometry, without creating its buffers
+///
+/// Makes no OpenGL calls, so it may be called from any thread, as
+/// long as no other thread is using the Canvas.
+///
+/// @param C      the Canvas to build the object in
+/// @param obj    which object to build
+///
+void buildObject( Canvas &C, Object obj );
+
+///
+/// Compute the key identifying what an object is built from:  its
+/// data, and the code that builds it (see GeometryCache.h)
+///
+/// @param obj    which object
+///
+/// @return the key
+///
+uint64_t objectKey( Object obj );
+
+///
+/// Build the geometry of several objects, spread across threads
+///
+/// Each object is built in its own Canvas, so the threads share
+/// nothing but a counter saying which object to build next.  Once
+/// this returns, the buffers can be created from the Canvases on
+/// the thread that owns the OpenGL context.
+///
+/// @param C        one Canvas per object; objs[i] is built in C[i]
+/// @param objs     which objects to build
+/// @param n        number of objects
+/// @param threads  number of worker threads (0 for one per core)
+///
+void buildObjects( Canvas *C[], const Object objs[], int n,
+                   int threads = 0 );
+
 #endif
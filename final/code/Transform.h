@@ -0,0 +1,156 @@
+//
+//  Transform.h
+//
+//  3D transformations that carry their kind in their type.
+//
+//  Most model transformations in our scenes are a translation, or a
+//  scale plus a translation; only some objects are rotated.  A
+//  Transform3<K> stores an affine transformation (a 3x3 linear part
+//  and a translation) together with its kind K as a template
+//  parameter.  Composing two transformations yields a transformation
+//  whose kind is worked out at compile time (see KindOf), so that
+//  composing diagonal transformations costs a handful of multiplies
+//  rather than a 4x4 matrix product.
+//
+//  The results are the same as those of the equivalent chain of glm
+//  4x4 matrix operations:  the terms that are skipped are all products
+//  with 0 or 1.
+//
+
+#ifndef TRANSFORM_H_
+#define TRANSFORM_H_
+
+#include <glm/vec3.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+//
+// Transformation kinds, from the simplest to the most general.
+// Identity, Translate and ScaleTranslate have diagonal linear parts.
+//
+typedef
+    enum xkinds_e {
+        XIdentity = 0, XTranslate, XScaleTranslate, XRigid, XAffine
+        // Sentinel gives us the number of kinds
+        , N_XKINDS
+    } XformKind;
+
+///
+/// KindOf<A,B>::kind - the kind of the composition of a transformation
+/// of kind A with one of kind B.  The simpler kinds nest, so this is
+/// usually the larger of the two; the exception is that a rotation
+/// combined with a (possibly non-uniform) scale is a general affine
+/// transformation.
+///
+template <int A, int B>
+struct KindOf {
+    enum {
+        kind = ( (A == XRigid && B == XScaleTranslate) ||
+                 (A == XScaleTranslate && B == XRigid) ) ? XAffine
+               : (A > B ? A : B)
+    };
+};
+
+static_assert( (int) KindOf<XIdentity, XIdentity>::kind == XIdentity,
+               "identity composed with identity" );
+static_assert( (int) KindOf<XTranslate, XIdentity>::kind == XTranslate &&
+               (int) KindOf<XIdentity, XTranslate>::kind == XTranslate,
+               "translations nest" );
+static_assert( (int) KindOf<XTranslate, XScaleTranslate>::kind ==
+                   XScaleTranslate &&
+               (int) KindOf<XScaleTranslate, XTranslate>::kind ==
+                   XScaleTranslate,
+               "diagonal transformations stay diagonal" );
+static_assert( (int) KindOf<XTranslate, XRigid>::kind == XRigid &&
+               (int) KindOf<XRigid, XRigid>::kind == XRigid,
+               "rotations and translations stay rigid" );
+static_assert( (int) KindOf<XRigid, XScaleTranslate>::kind == XAffine &&
+               (int) KindOf<XScaleTranslate, XRigid>::kind == XAffine,
+               "a rotation with a scale is affine" );
+static_assert( (int) KindOf<XTranslate, XAffine>::kind == XAffine &&
+               (int) KindOf<XAffine, XIdentity>::kind == XAffine,
+               "affine absorbs everything" );
+
+///
+/// A 3D affine transformation of kind K
+///
+template <int K>
+struct Transform3 {
+    glm::mat3 linear;   // rotation/scale part (column-major, as in glm)
+    glm::vec3 offset;   // translation
+
+    enum { kind = K };
+
+    ///
+    /// The transformation as a glm matrix
+    ///
+    glm::mat4 matrix( void ) const
+    {
+        glm::mat4 m( linear );
+        m[3] = glm::vec4( offset, 1.0f );
+        return m;
+    }
+};
+
+//
+// Constructors for the basic transformations
+//
+
+inline Transform3<XTranslate> translate3( const glm::vec3 &d )
+{
+    Transform3<XTranslate> t = { glm::mat3( 1.0f ), d };
+    return t;
+}
+
+inline Transform3<XScaleTranslate> scale3( const glm::vec3 &s )
+{
+    Transform3<XScaleTranslate> t = { glm::mat3( 1.0f ), glm::vec3( 0.0f ) };
+    t.linear[0][0] = s.x;
+    t.linear[1][1] = s.y;
+    t.linear[2][2] = s.z;
+    return t;
+}
+
+///
+/// A rotation about an axis, built the same way glm::rotate() does
+///
+/// @param radians   the rotation angle
+/// @param axis      the rotation axis
+///
+inline Transform3<XRigid> rotate3( float radians, const glm::vec3 &axis )
+{
+    glm::mat4 r = glm::rotate( glm::mat4( 1.0f ), radians, axis );
+    Transform3<XRigid> t = { glm::mat3( r ), glm::vec3( 0.0f ) };
+    return t;
+}
+
+///
+/// Composition:  (p * q) applies q first, then p
+///
+template <int A, int B>
+inline Transform3<KindOf<A,B>::kind> operator*( const Transform3<A> &p,
+                                                const Transform3<B> &q )
+{
+    Transform3<KindOf<A,B>::kind> r;
+
+    if( A <= XScaleTranslate && B <= XScaleTranslate ) {
+        // both diagonal; the compiler drops the other branch
+        r.linear = glm::mat3( 1.0f );
+        for( int i = 0; i < 3; ++i ) {
+            r.linear[i][i] = p.linear[i][i] * q.linear[i][i];
+            r.offset[i] = p.linear[i][i] * q.offset[i] + p.offset[i];
+        }
+    } else if( A == XTranslate ) {
+        // a translation after anything just moves it
+        r.linear = q.linear;
+        r.offset = q.offset + p.offset;
+    } else {
+        r.linear = p.linear * q.linear;
+        r.offset = p.linear * q.offset + p.offset;
+    }
+
+    return r;
+}
+
+#endif
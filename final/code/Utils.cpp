@@ -16,6 +16,7 @@
 #include <cstdlib>
 // wimp out and use stdio
 #include <cstdio>
+#include <string>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -203,3 +204,41 @@ GLint getAttribLoc( GLuint program, const GLchar *name ) {
 
     return( loc );
 }
+
+///
+/// Replace a file without ever leaving a partial one behind
+///
+/// @param path   the file to replace
+/// @param write  writes the contents to the stream it is given, and
+///               returns false if that failed
+/// @param arg    passed on to 'write'
+///
+/// @return true if the file was written and put in place
+///
+bool replaceFile( const char *path, bool (*write)( FILE *fp, void *arg ),
+                  void *arg ) {
+    string tmp = string( path ) + ".tmp";
+
+    FILE *fp = fopen( tmp.c_str(), "wb" );
+    if( fp == NULL ) {
+        return( false );
+    }
+
+    bool ok = write( fp, arg );
+    if( fclose( fp ) != 0 ) {
+        ok = false;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    // rename() won't replace an existing file here
+    if( ok ) {
+        remove( path );
+    }
+#endif
+    if( !ok || rename( tmp.c_str(), path ) != 0 ) {
+        remove( tmp.c_str() );
+        return( false );
+    }
+
+    return( true );
+}
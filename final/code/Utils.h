@@ -20,6 +20,8 @@
 #include <windows.h>
 #endif
 
+#include <cstdio>
+
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
@@ -71,4 +73,22 @@ GLint getUniformLoc( GLuint program, const GLchar *name );
 ///
 GLint getAttribLoc( GLuint program, const GLchar *name );
 
+///
+/// Replace a file without ever leaving a partial one behind
+///
+/// The contents are written to a temporary file next to the target,
+/// which is then renamed over it.  A program reading the file (or
+/// polling it) sees either the old contents or the new ones, never a
+/// mix, and a failed write leaves the old file alone.
+///
+/// @param path   the file to replace
+/// @param write  writes the contents to the stream it is given, and
+///               returns false if that failed
+/// @param arg    passed on to 'write'
+///
+/// @return true if the file was written and put in place
+///
+bool replaceFile( const char *path, bool (*write)( FILE *fp, void *arg ),
+                  void *arg );
+
 #endif
@@ -0,0 +1,122 @@
+//
+//  VertexLayout.h
+//
+//  Interleaved vertex layouts for the Canvas.
+//
+//  A layout is a struct holding everything stored for one vertex, in
+//  the order it sits in the vertex buffer.  BasicCanvas<L> keeps its
+//  vertices as one array of L, and BufferSet uploads that array as it
+//  is, so each vertex's position and attributes are next to each other
+//  both while the mesh is built and when the GPU fetches it.
+//
+//  Every layout has a position.  For each attribute it stores, it has
+//  a member named 'color', 'normal' or 'uv' and a setter; for each it
+//  does not store, the setter does nothing, so the same drawing code
+//  works with any layout.  format() describes the struct to OpenGL.
+//
+//  Layouts hold nothing but floats, so they have no padding, and two
+//  vertices can be compared (and hashed) byte by byte.
+//
+//  Changing a layout means bumping GEOMETRY_GENERATOR_VERSION
+//  (GeometryCache.h).
+//
+
+#ifndef VERTEXLAYOUT_H_
+#define VERTEXLAYOUT_H_
+
+#include <cstddef>
+
+#include "Types.h"
+
+//
+// Where each attribute sits within one vertex, in bytes (-1 if the
+// layout does not store it), and the size of one vertex
+//
+struct VertexFormat {
+    int stride;
+    int position;       // 4 floats (x,y,z,w)
+    int color;          // 4 floats (r,g,b,a)
+    int normal;         // 3 floats (x,y,z)
+    int texCoord;       // 2 floats (u,v)
+};
+
+///
+/// Position and normal; enough for shaded, untextured objects
+///
+struct PosNormal {
+    Vertex pos;
+    Normal normal;
+
+    void setColor( const Color & ) { }
+    void setNormal( const Normal &n ) { normal = n; }
+    void setTexCoord( const TexCoord & ) { }
+
+    static VertexFormat format( void ) {
+        VertexFormat f = { sizeof(PosNormal), offsetof(PosNormal, pos),
+                           -1, offsetof(PosNormal, normal), -1 };
+        return f;
+    }
+};
+
+///
+/// Position, normal and texture coordinates
+///
+struct PosNormalUV {
+    Vertex pos;
+    Normal normal;
+    TexCoord uv;
+
+    void setColor( const Color & ) { }
+    void setNormal( const Normal &n ) { normal = n; }
+    void setTexCoord( const TexCoord &t ) { uv = t; }
+
+    static VertexFormat format( void ) {
+        VertexFormat f = { sizeof(PosNormalUV), offsetof(PosNormalUV, pos),
+                           -1, offsetof(PosNormalUV, normal),
+                           offsetof(PosNormalUV, uv) };
+        return f;
+    }
+};
+
+///
+/// Position and color; what the 2D pixel interface produces
+///
+struct PosColor {
+    Vertex pos;
+    Color color;
+
+    void setColor( const Color &c ) { color = c; }
+    void setNormal( const Normal & ) { }
+    void setTexCoord( const TexCoord & ) { }
+
+    static VertexFormat format( void ) {
+        VertexFormat f = { sizeof(PosColor), offsetof(PosColor, pos),
+                           offsetof(PosColor, color), -1, -1 };
+        return f;
+    }
+};
+
+///
+/// Everything the Canvas can record
+///
+struct PosColorNormalUV {
+    Vertex pos;
+    Color color;
+    Normal normal;
+    TexCoord uv;
+
+    void setColor( const Color &c ) { color = c; }
+    void setNormal( const Normal &n ) { normal = n; }
+    void setTexCoord( const TexCoord &t ) { uv = t; }
+
+    static VertexFormat format( void ) {
+        VertexFormat f = { sizeof(PosColorNormalUV),
+                           offsetof(PosColorNormalUV, pos),
+                           offsetof(PosColorNormalUV, color),
+                           offsetof(PosColorNormalUV, normal),
+                           offsetof(PosColorNormalUV, uv) };
+        return f;
+    }
+};
+
+#endif
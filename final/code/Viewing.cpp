@@ -21,6 +21,7 @@
 #include <cstring>
 
 #include "Viewing.h"
+#include "Transform.h"
 #include "Utils.h"
 
 #include <glm/vec3.hpp>
@@ -78,22 +79,33 @@ void setProjection( GLuint program )
 void setTransforms( GLuint program, glm::vec3 scale,
                     glm::vec3 rotate, glm::vec3 xlate )
 {
-    // need an identity matrix
-    glm::mat4 id(1.0f);
-
-    // create translation and scale matrices
-    glm::mat4 tMat = glm::translate( id, xlate );
-    glm::mat4 sMat = glm::scale( id, scale );
-
-    // create the three rotation matrices
-    glm::vec3 rads( glm::radians( rotate ) );
-
-    glm::mat4 xMat = glm::rotate( id, rads.x, glm::vec3(1.0f,0.0f,0.0f) );
-    glm::mat4 yMat = glm::rotate( id, rads.y, glm::vec3(0.0f,1.0f,0.0f) );
-    glm::mat4 zMat = glm::rotate( id, rads.z, glm::vec3(0.0f,0.0f,1.0f) );
-
-    // combine the transformations
-    glm::mat4 cm = tMat * xMat * yMat * zMat * sMat;
+    // most objects are only scaled and moved, so only build the
+    // rotations (and the general product) when we need them
+    bool rotated = rotate != glm::vec3( 0.0f );
+    bool scaled = scale != glm::vec3( 1.0f );
+
+    glm::mat4 cm;
+
+    if( !rotated ) {
+        if( !scaled ) {
+            cm = translate3( xlate ).matrix();
+        } else {
+            cm = (translate3( xlate ) * scale3( scale )).matrix();
+        }
+    } else {
+        // the three rotations, applied Z first, then Y, then X
+        glm::vec3 rads( glm::radians( rotate ) );
+        Transform3<XRigid> rot =
+            rotate3( rads.x, glm::vec3(1.0f,0.0f,0.0f) ) *
+            rotate3( rads.y, glm::vec3(0.0f,1.0f,0.0f) ) *
+            rotate3( rads.z, glm::vec3(0.0f,0.0f,1.0f) );
+
+        if( !scaled ) {
+            cm = (translate3( xlate ) * rot).matrix();
+        } else {
+            cm = (translate3( xlate ) * (rot * scale3( scale ))).matrix();
+        }
+    }
 
     GLint loc = getUniformLoc( program, "modelMat" );
     if( loc >= 0 ) {
@@ -37,7 +37,7 @@ LDLIBS = -lSOIL -lGL -lGLEW -lglfw -lm
 # language-specific linker options
 # add "-lgsl -lgslcblas" if using GSL
 CLDLIBS =
-CCLDLIBS =
+CCLDLIBS = -pthread
 
 # frameworks for macos - if you are compiling on a Mac, uncomment the
 # two "FMWKS +=" lines here
@@ -50,7 +50,7 @@ CCFLAGS = -ggdb $(INCLUDE) -DGL_GLEXT_PROTOTYPES
 
 # language-specific compiler flags
 CFLAGS = -std=c99 $(CCFLAGS)
-CXXFLAGS = $(CCFLAGS) -DGL_SILENCE_DEPRECATION
+CXXFLAGS = $(CCFLAGS) -pthread -DGL_SILENCE_DEPRECATION
 
 # common linker flags
 LIBFLAGS = -ggdb $(LIBDIRS) $(LDLIBS)
@@ -33,6 +33,14 @@ uniform mat4 modelMat;  // composite
 // Light position is given in world space
 uniform vec4 lightPosition;
 
+// Decoding the vertex data (see BufferSet::setPacking()):  positions
+// are stored relative to the bounds of the mesh, and normals may be
+// octahedral-encoded in two values; unpacked data has a scale of 1,
+// a bias of 0 and three-value normals
+uniform vec3 posScale;
+uniform vec3 posBias;
+uniform bool octNormals;
+
 //
 // OUTGOING DATA
 //
@@ -43,14 +51,29 @@ out vec3 lPos;
 out vec3 vPos;
 out vec3 vNorm;
 
+// Turn an octahedral-encoded normal back into a unit vector
+vec3 octDecode( vec2 e )
+{
+    vec3 n = vec3( e, 1.0 - abs(e.x) - abs(e.y) );
+    if( n.z < 0.0 ) {
+        vec2 s = vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+        n.xy = (1.0 - abs(n.yx)) * s;
+    }
+    return normalize( n );
+}
+
 void main()
 {
+    // decode the vertex data
+    vec4 position = vec4( vPosition.xyz * posScale + posBias, vPosition.w );
+    vec3 normal = octNormals ? octDecode( vNormal.xy ) : vNormal;
+
     // create the modelview matrix
     mat4 modelViewMat = viewMat * modelMat;
 
     // All vectors need to be converted to "eye" space
     // All vectors should also be normalized
-    vec4 vertexInEye = modelViewMat * vPosition;
+    vec4 vertexInEye = modelViewMat * position;
     vec4 lightInEye = viewMat * lightPosition;
 
     // "Correct" way to transform normals.  The normal matrix is the
@@ -59,7 +82,7 @@ void main()
     // TO COMPUTE because of the inverse(), and should really be done in
     // the application, not here.
     mat3 normMat = inverse( transpose( mat3(modelViewMat) ) );
-    vec4 normalInEye = vec4( normMat * vNormal, 0.0 );
+    vec4 normalInEye = vec4( normMat * normal, 0.0 );
 
     // pass our vertex data to the fragment shader
     lPos = lightInEye.xyz;
@@ -67,5 +90,5 @@ void main()
     vNorm = normalInEye.xyz;
 
     // send the vertex position into clip space
-    gl_Position =  projMat * modelViewMat * vPosition;
+    gl_Position =  projMat * modelViewMat * position;
 }
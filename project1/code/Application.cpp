@@ -30,6 +30,7 @@
 #include "Models.h"
 #include "Canvas.h"
 #include "Pipeline.h"
+#include "StencilFill.h"
 
 #include "Application.h"
 
@@ -61,6 +62,9 @@ static bool updateDisplay = true;
 // our Pipeline
 static Pipeline *pipeline;
 
+// GPU fill backend
+static StencilFill gpuFill;
+
 //
 // PUBLIC GLOBALS
 //
@@ -152,6 +156,7 @@ static void keyboard( GLFWwindow *window, int key, int scan,
         cout << " 2, t, T    Simple model transformations" << endl;
         cout << " 3, x, X    Multiple transformations" << endl;
         cout << " 4, v, V    Use alternate viewports" << endl;
+        cout << "  g, G      Toggle CPU/GPU polygon fill" << endl;
         cout << "  h, H      Print this message" << endl;
         break;
 
@@ -190,6 +195,15 @@ static void keyboard( GLFWwindow *window, int key, int scan,
         updateDisplay = true;
         break;
 
+    // switch polygon fill backends
+    case GLFW_KEY_G:
+        pipeline->setBackend( pipeline->getBackend() == FillCPU ?
+                              FillGPU : FillCPU );
+        cout << "Using " << (pipeline->getBackend() == FillCPU ?
+                             "CPU" : "GPU") << " polygon fill" << endl;
+        updateDisplay = true;
+        break;
+
     case GLFW_KEY_ESCAPE:
     case GLFW_KEY_Q:
         glfwSetWindowShouldClose( window, 1 );
@@ -219,7 +233,8 @@ static void mouse( GLFWwindow *window, int button, int action, int mods )
 static void display( void )
 {
     // clear the frame buffer
-    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+             GL_STENCIL_BUFFER_BIT );
 
     // ensure we have selected the shader program
     glUseProgram( program );
@@ -228,8 +243,16 @@ static void display( void )
     GLuint sf = glGetUniformLocation( program, "sf" );
     glUniform2f( sf, 2.0f / (w_width - 1.0f), 2.0f / (w_height - 1.0f) );
 
-    // draw the objects and create the buffers
+    // draw the objects
     drawObjects( *pipeline );
+
+    // the GPU backend fills the recorded polygons itself
+    if( pipeline->getBackend() == FillGPU ) {
+        gpuFill.draw( *pipeline, program, "vPosition", "vColor" );
+        return;
+    }
+
+    // create the buffers
     polyBuffers.createBuffers( *pipeline );
 
     // bind our buffers
@@ -237,13 +260,11 @@ static void display( void )
 
     if( pipeline->isOutline() ) {
 
-        // draw the objects as separate line loops
+        // draw all the outlines as separate line loops in one call
 
-        int skip = 0;
-        for( int i = 0; i < pipeline->countNum; ++i ) {
-            glDrawArrays( GL_LINE_LOOP, skip, pipeline->outlineCounts[i] );
-            skip += pipeline->outlineCounts[i];
-        }
+        glMultiDrawArrays( GL_LINE_LOOP, &pipeline->outlineFirsts[0],
+                           &pipeline->outlineCounts[0],
+                           pipeline->numOutlines() );
 
     } else {
 
@@ -293,6 +314,7 @@ static bool init( void )
     glClearColor( 0.0, 0.0, 0.0, 1.0 );
     glDepthFunc( GL_LEQUAL );
     glClearDepth( 1.0f );
+    glClearStencil( 0 );
     // glPolygonMode( GL_FRONT_AND_BACK, GL_POINT );
 
     // create the geometry for our shapes.
@@ -0,0 +1,407 @@
+//
+//  BatchClipper.cpp
+//
+//  Clip many polygons against many clip windows in one pass.
+//
+//  See BatchClipper.h for a description of the module.
+//
+
+#include <cfloat>
+#include <algorithm>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "BatchClipper.h"
+
+using namespace std;
+
+//
+// PRIVATE DATA
+//
+
+// polygons classified per step
+#define BATCH_LANES     8
+
+// clip boundaries, in the order clipPolygon() uses them
+enum { ClipTop = 0, ClipRight, ClipBottom, ClipLeft, N_CLIP };
+
+//
+// Scratch space for one worker:  two ping-pong vertex lists
+//
+
+struct Scratch {
+    vector<float> ax, ay, bx, by;
+};
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Is a point on the inside of a clip boundary?
+///
+static inline bool inside( float x, float y, int side, float e )
+{
+    switch( side ) {
+    case ClipTop:     return y <= e;
+    case ClipRight:   return x <= e;
+    case ClipBottom:  return y >= e;
+    default:          return x >= e;
+    }
+}
+
+///
+/// Where the edge from the current point (cx,cy) back to the previous
+/// point (px,py) crosses a clip boundary.  This is the computation
+/// getIntersect() does, step for step, so that the results match
+/// clipPolygon() exactly.
+///
+static inline void crossing( float cx, float cy, float px, float py,
+                             int side, float e, float &ox, float &oy )
+{
+    float slope = (cx == px) ? 0.0f : (py - cy) / (px - cx);
+    float b = cy - slope * cx;
+
+    if( side == ClipRight || side == ClipLeft ) {
+        ox = e;
+        oy = slope * e + b;
+    } else {
+        oy = e;
+        ox = (cx == px) ? cx : (oy - b) / slope;
+    }
+}
+
+///
+/// Classify eight polygons against a window by their bounding boxes.
+/// Bit k of 'reject' is set if polygon i+k is entirely outside one of
+/// the window boundaries, and bit k of 'accept' if it is entirely
+/// inside all of them.
+///
+static inline void classify8( const PolygonBatch &b, int i,
+                              const Vertex &ll, const Vertex &ur,
+                              unsigned &accept, unsigned &reject )
+{
+#if defined(__AVX__)
+    __m256 x0 = _mm256_loadu_ps( &b.xmin[i] );
+    __m256 x1 = _mm256_loadu_ps( &b.xmax[i] );
+    __m256 y0 = _mm256_loadu_ps( &b.ymin[i] );
+    __m256 y1 = _mm256_loadu_ps( &b.ymax[i] );
+    __m256 lx = _mm256_set1_ps( ll.x ), ly = _mm256_set1_ps( ll.y );
+    __m256 ux = _mm256_set1_ps( ur.x ), uy = _mm256_set1_ps( ur.y );
+
+    __m256 out = _mm256_or_ps(
+        _mm256_or_ps( _mm256_cmp_ps( y0, uy, _CMP_GT_OQ ),
+                      _mm256_cmp_ps( x0, ux, _CMP_GT_OQ ) ),
+        _mm256_or_ps( _mm256_cmp_ps( y1, ly, _CMP_LT_OQ ),
+                      _mm256_cmp_ps( x1, lx, _CMP_LT_OQ ) ) );
+    __m256 in = _mm256_and_ps(
+        _mm256_and_ps( _mm256_cmp_ps( y1, uy, _CMP_LE_OQ ),
+                       _mm256_cmp_ps( x1, ux, _CMP_LE_OQ ) ),
+        _mm256_and_ps( _mm256_cmp_ps( y0, ly, _CMP_GE_OQ ),
+                       _mm256_cmp_ps( x0, lx, _CMP_GE_OQ ) ) );
+
+    reject = _mm256_movemask_ps( out );
+    accept = _mm256_movemask_ps( in );
+#elif defined(__SSE2__)
+    __m128 lx = _mm_set1_ps( ll.x ), ly = _mm_set1_ps( ll.y );
+    __m128 ux = _mm_set1_ps( ur.x ), uy = _mm_set1_ps( ur.y );
+
+    reject = accept = 0;
+    for( int h = 0; h < BATCH_LANES; h += 4 ) {
+        __m128 x0 = _mm_loadu_ps( &b.xmin[i + h] );
+        __m128 x1 = _mm_loadu_ps( &b.xmax[i + h] );
+        __m128 y0 = _mm_loadu_ps( &b.ymin[i + h] );
+        __m128 y1 = _mm_loadu_ps( &b.ymax[i + h] );
+
+        __m128 out = _mm_or_ps(
+            _mm_or_ps( _mm_cmpgt_ps( y0, uy ), _mm_cmpgt_ps( x0, ux ) ),
+            _mm_or_ps( _mm_cmplt_ps( y1, ly ), _mm_cmplt_ps( x1, lx ) ) );
+        __m128 in = _mm_and_ps(
+            _mm_and_ps( _mm_cmple_ps( y1, uy ), _mm_cmple_ps( x1, ux ) ),
+            _mm_and_ps( _mm_cmpge_ps( y0, ly ), _mm_cmpge_ps( x0, lx ) ) );
+
+        reject |= (unsigned) _mm_movemask_ps( out ) << h;
+        accept |= (unsigned) _mm_movemask_ps( in ) << h;
+    }
+#else
+    reject = accept = 0;
+    for( int k = 0; k < BATCH_LANES; ++k ) {
+        int j = i + k;
+        if( b.ymin[j] > ur.y || b.xmin[j] > ur.x ||
+            b.ymax[j] < ll.y || b.xmax[j] < ll.x ) {
+            reject |= 1u << k;
+        }
+        if( b.ymax[j] <= ur.y && b.xmax[j] <= ur.x &&
+            b.ymin[j] >= ll.y && b.xmin[j] >= ll.x ) {
+            accept |= 1u << k;
+        }
+    }
+#endif
+}
+
+///
+/// Append polygon p of the batch, unclipped, to a set of results
+///
+static void emitWhole( const PolygonBatch &b, int p, ClipResults &r )
+{
+    int s = b.first[p], e = b.first[p + 1];
+
+    r.x.insert( r.x.end(), b.x.begin() + s, b.x.begin() + e );
+    r.y.insert( r.y.end(), b.y.begin() + s, b.y.begin() + e );
+    r.first.push_back( r.x.size() );
+    r.source.push_back( p );
+}
+
+///
+/// Clip polygon p of the batch against one window with
+/// Sutherland-Hodgman, in the same boundary order and producing the
+/// same vertices as clipPolygon(), and append the result (if any)
+///
+static void emitClipped( const PolygonBatch &b, int p, const Vertex &ll,
+                         const Vertex &ur, Scratch &s, ClipResults &r )
+{
+    const float edge[N_CLIP] = { ur.y, ur.x, ll.y, ll.x };
+    int start = b.first[p];
+    int n = b.first[p + 1] - start;
+
+    // each boundary adds at most one vertex per input vertex
+    size_t room = 5 * n + 4;
+    if( s.ax.size() < room ) {
+        s.ax.resize( room ); s.ay.resize( room );
+        s.bx.resize( room ); s.by.resize( room );
+    }
+
+    float *ix = &s.ax[0], *iy = &s.ay[0];
+    float *ox = &s.bx[0], *oy = &s.by[0];
+    copy( b.x.begin() + start, b.x.begin() + start + n, ix );
+    copy( b.y.begin() + start, b.y.begin() + start + n, iy );
+
+    for( int side = 0; side < N_CLIP && n > 0; ++side ) {
+        float e = edge[side];
+        int m = 0;
+        for( int i = 0; i < n; ++i ) {
+            int j = (i == 0 ? n - 1 : i - 1);
+            bool curIn = inside( ix[i], iy[i], side, e );
+            bool prevIn = inside( ix[j], iy[j], side, e );
+
+            if( curIn ) {
+                if( !prevIn ) {
+                    crossing( ix[i], iy[i], ix[j], iy[j], side, e,
+                              ox[m], oy[m] );
+                    ++m;
+                }
+                ox[m] = ix[i];
+                oy[m] = iy[i];
+                ++m;
+            } else if( prevIn ) {
+                crossing( ix[i], iy[i], ix[j], iy[j], side, e,
+                          ox[m], oy[m] );
+                ++m;
+            }
+        }
+        swap( ix, ox );
+        swap( iy, oy );
+        n = m;
+    }
+
+    if( n > 0 ) {
+        r.x.insert( r.x.end(), ix, ix + n );
+        r.y.insert( r.y.end(), iy, iy + n );
+        r.first.push_back( r.x.size() );
+        r.source.push_back( p );
+    }
+}
+
+///
+/// Clip the whole batch against windows w0 .. w1-1; the results are
+/// numbered from zero
+///
+static void clipWindows( const PolygonBatch &b, int w0, int w1,
+                         const Vertex windows[][2], ClipResults *r )
+{
+    Scratch s;
+    int np = b.size();
+
+    r->x.clear();
+    r->y.clear();
+    r->first.assign( 1, 0 );
+    r->source.clear();
+    r->window.assign( 1, 0 );
+
+    for( int w = w0; w < w1; ++w ) {
+        const Vertex &ll = windows[w][0];
+        const Vertex &ur = windows[w][1];
+
+        for( int i = 0; i < np; i += BATCH_LANES ) {
+            unsigned accept, reject;
+            classify8( b, i, ll, ur, accept, reject );
+
+            // the padding is always rejected, so this ends the loop
+            // at the last real polygon
+            unsigned live = ~reject & ((1u << BATCH_LANES) - 1);
+            while( live != 0 ) {
+                int k = __builtin_ctz( live );
+                live &= live - 1;
+                if( accept & (1u << k) ) {
+                    emitWhole( b, i + k, *r );
+                } else {
+                    emitClipped( b, i + k, ll, ur, s, *r );
+                }
+            }
+        }
+
+        r->window.push_back( r->source.size() );
+    }
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Constructor
+///
+PolygonBatch::PolygonBatch( void )
+{
+    clear();
+}
+
+///
+/// Add a polygon to the batch
+///
+/// @param n   number of vertices
+/// @param v   the vertices
+///
+void PolygonBatch::add( int n, const Vertex v[] )
+{
+    // drop the padding, add the new box, and pad again
+    int np = size();
+    xmin.resize( np ); xmax.resize( np );
+    ymin.resize( np ); ymax.resize( np );
+
+    // an empty polygon gets an impossible box so it is always rejected
+    float x0 = FLT_MAX, x1 = -FLT_MAX, y0 = FLT_MAX, y1 = -FLT_MAX;
+    for( int i = 0; i < n; ++i ) {
+        x.push_back( v[i].x );
+        y.push_back( v[i].y );
+        x0 = min( x0, v[i].x ); x1 = max( x1, v[i].x );
+        y0 = min( y0, v[i].y ); y1 = max( y1, v[i].y );
+    }
+    first.push_back( x.size() );
+
+    xmin.push_back( x0 ); xmax.push_back( x1 );
+    ymin.push_back( y0 ); ymax.push_back( y1 );
+
+    size_t padded = (np + 1 + BATCH_LANES - 1) & ~(BATCH_LANES - 1);
+    xmin.resize( padded, FLT_MAX ); xmax.resize( padded, -FLT_MAX );
+    ymin.resize( padded, FLT_MAX ); ymax.resize( padded, -FLT_MAX );
+}
+
+///
+/// Remove all polygons from the batch
+///
+void PolygonBatch::clear( void )
+{
+    x.clear();
+    y.clear();
+    first.assign( 1, 0 );
+    xmin.clear(); xmax.clear();
+    ymin.clear(); ymax.clear();
+}
+
+///
+/// Copy clipped polygon k out as a list of vertices
+///
+/// @param k     which clipped polygon
+/// @param outV  receives the vertices
+///
+/// @return the number of vertices
+///
+int ClipResults::vertices( int k, Vertex outV[] ) const
+{
+    int s = first[k], n = first[k + 1] - s;
+
+    for( int i = 0; i < n; ++i ) {
+        outV[i].x = x[s + i];
+        outV[i].y = y[s + i];
+        outV[i].z = 0.0f;
+        outV[i].w = 1.0f;
+    }
+
+    return n;
+}
+
+///
+/// clipBatch - Clip every polygon in a batch against every window.
+///
+/// @param batch     the polygons to clip
+/// @param nwindows  number of clip windows
+/// @param windows   the windows
+/// @param results   receives the clipped polygons
+/// @param threads   number of worker threads (0 for one per core)
+///
+void clipBatch( const PolygonBatch &batch, int nwindows,
+                const Vertex windows[][2], ClipResults &results,
+                int threads )
+{
+    if( threads <= 0 ) {
+        threads = thread::hardware_concurrency();
+    }
+    threads = max( 1, min( threads, nwindows ) );
+
+    // give each worker a contiguous range of windows
+    vector<ClipResults> part( threads );
+    vector<thread> workers;
+    for( int t = 0; t < threads; ++t ) {
+        int w0 = (int) ((long long) nwindows * t / threads);
+        int w1 = (int) ((long long) nwindows * (t + 1) / threads);
+        if( t == threads - 1 ) {
+            // the calling thread does the last range itself
+            clipWindows( batch, w0, w1, windows, &part[t] );
+        } else {
+            workers.push_back( thread( clipWindows, cref( batch ), w0, w1,
+                                       windows, &part[t] ) );
+        }
+    }
+    for( size_t t = 0; t < workers.size(); ++t ) {
+        workers[t].join();
+    }
+
+    // stitch the parts together in window order
+    size_t nv = 0, npoly = 0;
+    for( int t = 0; t < threads; ++t ) {
+        nv += part[t].x.size();
+        npoly += part[t].source.size();
+    }
+
+    results.x.resize( nv );
+    results.y.resize( nv );
+    results.first.resize( npoly + 1 );
+    results.source.resize( npoly );
+    results.window.resize( 1 );
+    results.window.reserve( nwindows + 1 );
+    results.first[0] = 0;
+    results.window[0] = 0;
+
+    size_t vbase = 0, pbase = 0;
+    for( int t = 0; t < threads; ++t ) {
+        const ClipResults &p = part[t];
+        copy( p.x.begin(), p.x.end(), results.x.begin() + vbase );
+        copy( p.y.begin(), p.y.end(), results.y.begin() + vbase );
+        copy( p.source.begin(), p.source.end(),
+              results.source.begin() + pbase );
+        for( size_t k = 1; k < p.first.size(); ++k ) {
+            results.first[pbase + k] = vbase + p.first[k];
+        }
+        for( size_t w = 1; w < p.window.size(); ++w ) {
+            results.window.push_back( pbase + p.window[w] );
+        }
+        vbase += p.x.size();
+        pbase += p.source.size();
+    }
+}
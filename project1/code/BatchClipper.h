@@ -0,0 +1,126 @@
+//
+//  BatchClipper.h
+//
+//  Clip many polygons against many clip windows in one pass.
+//
+//  clipPolygon() clips one polygon against one window, and a tiling
+//  workload that clips every polygon against hundreds of tile
+//  rectangles ends up calling it (polygons x windows) times.  Most of
+//  those calls are wasted:  the polygon is entirely outside the window
+//  (its outcodes share a bit) or entirely inside it (its outcodes are
+//  all zero).  The AND and OR of a polygon's outcodes only depend on
+//  its bounding box, so clipBatch() computes the boxes once and then
+//  classifies eight polygons at a time against each window with SSE
+//  (or AVX, when the compiler is allowed to use it), falling back to
+//  scalar code elsewhere.  Only the polygons that straddle a window
+//  boundary go through Sutherland-Hodgman clipping, which is done in
+//  scratch buffers with no allocation per polygon.
+//
+//  The input is a PolygonBatch, which stores the vertices as separate
+//  x and y arrays (structure of arrays).  The output is a ClipResults:
+//  every clipped polygon for every window, in one contiguous pair of
+//  coordinate arrays, with offset tables that say where each window's
+//  polygons and each polygon's vertices start.  The windows are split
+//  between worker threads; the results are the same whatever the
+//  number of threads, and are vertex-for-vertex the same as calling
+//  clipPolygon() on each (polygon, window) pair.
+//
+
+#ifndef BATCHCLIPPER_H_
+#define BATCHCLIPPER_H_
+
+#include <vector>
+
+#include "Types.h"
+
+///
+/// A batch of polygons in structure-of-arrays form
+///
+class PolygonBatch {
+
+public:
+    // vertex coordinates of all polygons, one after another
+    std::vector<float> x, y;
+
+    // polygon i has vertices first[i] .. first[i+1]-1
+    std::vector<int> first;
+
+    // bounding boxes, padded with empty boxes to a multiple of eight
+    std::vector<float> xmin, xmax, ymin, ymax;
+
+    PolygonBatch( void );
+
+    ///
+    /// Add a polygon to the batch
+    ///
+    /// @param n   number of vertices
+    /// @param v   the vertices
+    ///
+    void add( int n, const Vertex v[] );
+
+    ///
+    /// Remove all polygons from the batch
+    ///
+    void clear( void );
+
+    ///
+    /// Number of polygons in the batch
+    ///
+    int size( void ) const { return first.size() - 1; }
+
+    ///
+    /// Number of vertices in the batch
+    ///
+    int numVertices( void ) const { return x.size(); }
+};
+
+///
+/// The clipped polygons for a set of windows
+///
+struct ClipResults {
+    // vertex coordinates of all clipped polygons, one after another
+    std::vector<float> x, y;
+
+    // clipped polygon k has vertices first[k] .. first[k+1]-1
+    std::vector<int> first;
+
+    // the batch index of the polygon clipped polygon k came from
+    std::vector<int> source;
+
+    // window w produced clipped polygons window[w] .. window[w+1]-1
+    std::vector<int> window;
+
+    ///
+    /// Number of clipped polygons
+    ///
+    int size( void ) const { return source.size(); }
+
+    ///
+    /// Copy clipped polygon k out as a list of vertices
+    ///
+    /// @param k     which clipped polygon
+    /// @param outV  receives the vertices
+    ///
+    /// @return the number of vertices
+    ///
+    int vertices( int k, Vertex outV[] ) const;
+};
+
+///
+/// clipBatch - Clip every polygon in a batch against every window.
+///
+/// Windows are given the same way as the clip regions in lab 3, as
+/// (lower-left, upper-right) corner pairs.  Polygons that clip away to
+/// nothing are left out of the results.
+///
+/// @param batch     the polygons to clip
+/// @param nwindows  number of clip windows
+/// @param windows   the windows
+/// @param results   receives the clipped polygons
+/// @param threads   number of worker threads (0 for one per core)
+///
+void clipBatch( const PolygonBatch &batch, int nwindows,
+                const Vertex windows[][2], ClipResults &results,
+                int threads = 0 );
+
+#endif
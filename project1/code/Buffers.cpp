@@ -120,7 +120,7 @@ void BufferSet::createBuffers( Canvas &C ) {
     }
 
     // OK, we have vertices!
-    float *points = C.getVertices();
+    const float *points = C.getVertices();
     // #bytes = number of elements * 4 floats/element * bytes/float
     vSize = numElements * 4 * sizeof(float);
 
@@ -128,28 +128,28 @@ void BufferSet::createBuffers( Canvas &C ) {
     GLsizeiptr vbufSize = vSize;
 
     // get the color data (if there is any)
-    float *colors = C.getColors();
+    const float *colors = C.getColors();
     if( colors != NULL ) {
         cSize = numElements * 4 * sizeof(float);
         vbufSize += cSize;
     }
 
     // get the normal data (if there is any)
-    float *normals = C.getNormals();
+    const float *normals = C.getNormals();
     if( normals != NULL ) {
         nSize = numElements * 3 * sizeof(float);
         vbufSize += nSize;
     }
 
     // get the (u,v) data (if there is any)
-    float *uv = C.getUV();
+    const float *uv = C.getUV();
     if( uv != NULL ) {
         tSize = numElements * 2 * sizeof(float);
         vbufSize += tSize;
     }
 
     // get the element data
-    GLuint *elements = C.getElements();
+    const GLuint *elements = C.getElements();
     // #bytes = number of elements * bytes/element
     eSize = numElements * sizeof(GLuint);
 
@@ -191,9 +191,9 @@ void BufferSet::createBuffers( Canvas &C ) {
             << offset << " vbufSize " << vbufSize << endl;
     }
 
-    // NOTE:  'points', 'colors', and 'elements' are dynamically allocated,
-    // but we don't free them here because they will be freed at the next
-    // call to clear() or the get*() functions
+    // NOTE:  'points', 'colors', etc. point into the Canvas's own
+    // storage; GL has its own copy of the data now, so they can be
+    // forgotten
 
     // finally, mark it as set up
     bufferInit = true;
@@ -58,22 +58,15 @@
 /// @param w width of canvas
 /// @param h height of canvas
 ///
-Canvas::Canvas( int w, int h ) : width(w), height(h), countNumLimit(100) {
+Canvas::Canvas( int w, int h ) : width(w), height(h) {
     // G++ allows us to use (Color) { ... }, but Visual Studio
     // doesn't, so we do this the long way to keep everyone happy
     Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
     currentColor = black;
     currentDepth = -1.0f;
-    pointArray = 0;
-    colorArray = 0;
-    normalArray = 0;
-    uvArray = 0;
-    elemArray = 0;
     numElements = 0;
     // Midterm assignment additions
-    outlineCounts = 0;
     drawingOutlines = false;
-    countNum = 0;
 }
 
 ///
@@ -92,26 +85,6 @@ Canvas::~Canvas( void ) {
 ///
 void Canvas::clear( void )
 {
-    if( pointArray ) {
-        delete [] pointArray;
-        pointArray = 0;
-    }
-    if( normalArray ) {
-        delete [] normalArray;
-        normalArray = 0;
-    }
-    if( uvArray ) {
-        delete [] uvArray;
-        uvArray = 0;
-    }
-    if( elemArray ) {
-        delete [] elemArray;
-        elemArray = 0;
-    }
-    if( colorArray ) {
-        delete [] colorArray;
-        colorArray = 0;
-    }
     points.clear();
     normals.clear();
     uv.clear();
@@ -122,13 +95,9 @@ void Canvas::clear( void )
     currentDepth = -1.0f;
 
     // Midterm assignment additions
-    if( outlineCounts ) {
-        delete [] outlineCounts;
-        outlineCounts = 0;
-    }
-    outlineCounts = new int[countNumLimit];
+    outlineFirsts.clear();
+    outlineCounts.clear();
     drawingOutlines = false;
-    countNum = 0;
 }
 
 ///
@@ -159,6 +128,16 @@ Color Canvas::setColor( Color color )
     return( old );
 }
 
+///
+/// Retrieve the current drawing color
+///
+/// @return The current color value
+///
+Color Canvas::getColor( void )
+{
+    return( currentColor );
+}
+
     /////////////////////////////////////
     //
     // Adding things to the Canvas
@@ -344,151 +323,65 @@ void Canvas::addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 )
 ///
 /// Retrieve the array of element data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to numVertices() indices, or NULL
 ///
-GLuint *Canvas::getElements( void )
+const GLuint *Canvas::getElements( void )
 {
-    // delete the old element array if we have one
-    if( elemArray ) {
-        delete [] elemArray;
-        elemArray = 0;
+    if( numElements < 1 ) {
+        return NULL;
     }
 
-    int n = numElements;
-
-    if( n > 0 ) {
-        // create and fill a new element array
-        elemArray = new GLuint[ n ];
-        if( elemArray == 0 ) {
-            cerr << "element allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            elemArray[i] = i;
+    // the indices are always 0, 1, 2, ..., so only the new ones
+    // need to be filled in
+    GLuint n = elements.size();
+    if( n < (GLuint) numElements ) {
+        elements.resize( numElements );
+        for( ; n < (GLuint) numElements; n++ ) {
+            elements[n] = n;
         }
     }
 
-    return elemArray;
+    return &elements[0];
 }
 
 ///
 /// Retrieve the array of vertex data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to the (x,y,z,w) data, or NULL
 ///
-float *Canvas::getVertices( void )
+const float *Canvas::getVertices( void ) const
 {
-    // delete the old point array if we have one
-    if( pointArray ) {
-        delete [] pointArray;
-        pointArray = 0;
-    }
-
-    int n = points.size();
-
-    if( n > 0 ) {
-        // create and fill a new point array
-        pointArray = new float[ n ];
-        if( pointArray == 0 ) {
-            cerr << "point allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            pointArray[i] = points[i];
-        }
-    }
-
-    return pointArray;
+    return points.empty() ? NULL : &points[0];
 }
 
 ///
 /// Retrieve the array of normal data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to the (x,y,z) data, or NULL
 ///
-float *Canvas::getNormals( void )
+const float *Canvas::getNormals( void ) const
 {
-    // delete the old normal array if we have one
-    if( normalArray ) {
-        delete [] normalArray;
-        normalArray = 0;
-    }
-
-    int n = normals.size();
-
-    if( n > 0 ) {
-        // create and fill a new normal array
-        normalArray = new float[ n ];
-        if( normalArray == 0 ) {
-            cerr << "normal allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            normalArray[i] = normals[i];
-        }
-    }
-
-    return normalArray;
+    return normals.empty() ? NULL : &normals[0];
 }
 
 ///
 /// Retrieve the array of texture coordinate data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to the (u,v) data, or NULL
 ///
-float *Canvas::getUV( void )
+const float *Canvas::getUV( void ) const
 {
-    // delete the old texture coordinate array if we have one
-    if( uvArray ) {
-        delete [] uvArray;
-        uvArray = 0;
-    }
-
-    int n = uv.size();
-
-    if( n > 0 ) {
-        // create and fill a new texture coordinate array
-        uvArray = new float[ n ];
-        if( uvArray == 0 ) {
-            cerr << "uv allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            uvArray[i] = uv[i];
-        }
-    }
-
-    return uvArray;
+    return uv.empty() ? NULL : &uv[0];
 }
 
 ///
 /// Retrieve the array of color data from this Canvas
 ///
-/// @return A pointer to a dynamic array of data, or NULL
+/// @return A pointer to the (r,g,b,a) data, or NULL
 ///
-float *Canvas::getColors( void )
+const float *Canvas::getColors( void ) const
 {
-    // delete the old color array if we have one
-    if( colorArray ) {
-        delete [] colorArray;
-        colorArray = 0;
-    }
-
-    int n = colors.size();
-
-    if( n > 0 ) {
-        // create and fill a new color array
-        colorArray = new float[ n ];
-        if( colorArray == 0 ) {
-            cerr << "color allocation failure" << endl;
-            exit( 1 );
-        }
-        for( int i = 0; i < n; i++ ) {
-            colorArray[i] = colors[i];
-        }
-    }
-
-    return colorArray;
+    return colors.empty() ? NULL : &colors[0];
 }
 
 ///
@@ -518,13 +411,13 @@ int Canvas::numVertices( void )
 
 void Canvas::drawOutline( int n, const Vertex v[] )
 {
-    if( countNum >= countNumLimit ) {
-        cerr << "too many outlines to draw!" << endl;
+    if( n < 1 ) {
         return;
     }
 
     drawingOutlines = true;
-    outlineCounts[countNum++] = n;
+    outlineFirsts.push_back( numElements );
+    outlineCounts.push_back( n );
 
     for( int i = 0; i < n; i++ )
         addPixel( v[i] );
@@ -77,23 +77,21 @@ class Canvas {
 
     // vertex locations
     vector<float> points;
-    float *pointArray;
 
     // associated normal vectors
     vector<float> normals;
-    float *normalArray;
 
     // associated (u,v) coordinates
     vector<float> uv;
-    float *uvArray;
 
     // associated color data
     vector<float> colors;
-    float *colorArray;
 
-    // element count and connectivity data
+    // element count and connectivity data; the connectivity is always
+    // 0, 1, 2, ..., so it is kept (and only ever extended) across
+    // calls to clear()
     int numElements;
-    GLuint *elemArray;
+    vector<GLuint> elements;
 
     //
     // other Canvas defaults
@@ -144,6 +142,13 @@ public:
     ///
     Color setColor( Color color );
 
+    ///
+    /// Retrieve the current drawing color
+    ///
+    /// @return  The current color value
+    ///
+    Color getColor( void );
+
     /////////////////////////////////////
     //
     // Adding things to the Canvas
@@ -250,42 +255,47 @@ public:
     //
     // Retrieving things from the Canvas
     //
+    // These return pointers into the Canvas's own storage; nothing is
+    // copied.  A pointer stays valid until the next call that adds
+    // anything to the Canvas, or clears it, or until the Canvas is
+    // destroyed, and must not be freed by the caller.
+    //
     /////////////////////////////////////
 
     ///
     /// Retrieve the array of element data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to numVertices() indices, or NULL
     ///
-    GLuint *getElements( void );
+    const GLuint *getElements( void );
 
     ///
     /// Retrieve the array of vertex data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to the (x,y,z,w) data, or NULL
     ///
-    float *getVertices( void );
+    const float *getVertices( void ) const;
 
     ///
     /// Retrieve the array of normal data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to the (x,y,z) data, or NULL
     ///
-    float *getNormals( void );
+    const float *getNormals( void ) const;
 
     ///
     /// Retrieve the array of (u,v) data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to the (u,v) data, or NULL
     ///
-    float *getUV( void );
+    const float *getUV( void ) const;
 
     ///
     /// Retrieve the array of color data from this Canvas
     ///
-    /// @return A pointer to a dynamic array of data, or NULL
+    /// @return A pointer to the (r,g,b,a) data, or NULL
     ///
-    float *getColors( void );
+    const float *getColors( void ) const;
 
     ///
     /// Retrieve the vertex count from this Canvas
@@ -305,12 +315,14 @@ public:
     //
     // outline vs. polygon drawing variables
     //
-    // these are public to facilitate use by the driver program
+    // these are public to facilitate use by the driver program;
+    // outline i is the line loop made of the outlineCounts[i] points
+    // starting with point number outlineFirsts[i], so all the loops
+    // can be drawn with a single glMultiDrawArrays() call
     //
     bool drawingOutlines;
-    int countNum;
-    const int countNumLimit;
-    int *outlineCounts;
+    vector<GLint> outlineFirsts;
+    vector<GLsizei> outlineCounts;
 
     //
     // Member functions
@@ -333,6 +345,11 @@ public:
     ///
     bool isOutline( void );
 
+    ///
+    /// Return the number of outlines drawn since the last clear()
+    ///
+    int numOutlines( void ) const { return outlineCounts.size(); }
+
 };
 
 #endif
@@ -0,0 +1,278 @@
+//
+//  Fixed.cpp
+//
+//  16.16 fixed-point arithmetic for the 2D pipeline.
+//
+//  See Fixed.h for a description of the module.
+//
+
+#include <vector>
+
+#include "Fixed.h"
+
+using namespace std;
+
+//
+// PRIVATE DATA
+//
+
+//
+// CORDIC angle table:  atan(2^-i) in degrees, as 8.24 fixed point,
+// and the gain of the 24 iterations (in 2.30)
+//
+
+#define CORDIC_STEPS    24
+#define CORDIC_SHIFT    24
+
+static const int32_t cordicAngle[CORDIC_STEPS] = {
+    754974720, 445687602, 235489088, 119537938, 60000934, 30029717,
+    15018523, 7509720, 3754917, 1877466, 938734, 469367,
+    234684, 117342, 58671, 29335, 14668, 7334,
+    3667, 1833, 917, 458, 229, 115
+};
+
+static const int64_t cordicGain = 652032874;
+
+// clip boundaries, in the order clipPolygon() uses them
+enum { ClipTop = 0, ClipRight, ClipBottom, ClipLeft, N_CLIP };
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Is a point on the inside of a clip boundary?
+///
+static bool inside( const FixedVertex &p, int side, Fixed e )
+{
+    switch( side ) {
+    case ClipTop:     return p.y <= e;
+    case ClipRight:   return p.x <= e;
+    case ClipBottom:  return p.y >= e;
+    default:          return p.x >= e;
+    }
+}
+
+///
+/// Where the edge from p to q crosses a clip boundary
+///
+/// The crossing is always computed from the endpoint with the smaller
+/// coordinate, so an edge gives the same point whichever way it runs.
+///
+static FixedVertex crossing( FixedVertex p, FixedVertex q, int side,
+                             Fixed e )
+{
+    FixedVertex v;
+
+    if( side == ClipRight || side == ClipLeft ) {
+        if( q.x < p.x ) {
+            FixedVertex t = p; p = q; q = t;
+        }
+        v.x = e;
+        v.y = p.y + fixMulDiv( q.y - p.y, e - p.x, q.x - p.x );
+    } else {
+        if( q.y < p.y ) {
+            FixedVertex t = p; p = q; q = t;
+        }
+        v.y = e;
+        v.x = p.x + fixMulDiv( q.x - p.x, e - p.y, q.y - p.y );
+    }
+
+    return v;
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// The identity transformation
+///
+FixedMatrix fixIdentity( void )
+{
+    FixedMatrix m = { FIX_ONE, 0, 0, FIX_ONE, 0, 0 };
+    return m;
+}
+
+///
+/// Compose two transformations:  the result applies m, then op
+///
+/// @param op   the transformation applied second
+/// @param m    the transformation applied first
+///
+FixedMatrix fixCompose( const FixedMatrix &op, const FixedMatrix &m )
+{
+    FixedMatrix r;
+
+    // each entry is a sum of products, rounded once
+    r.a = (Fixed) (((int64_t) op.a * m.a + (int64_t) op.c * m.b + FIX_HALF)
+                   >> FIX_SHIFT);
+    r.b = (Fixed) (((int64_t) op.b * m.a + (int64_t) op.d * m.b + FIX_HALF)
+                   >> FIX_SHIFT);
+    r.c = (Fixed) (((int64_t) op.a * m.c + (int64_t) op.c * m.d + FIX_HALF)
+                   >> FIX_SHIFT);
+    r.d = (Fixed) (((int64_t) op.b * m.c + (int64_t) op.d * m.d + FIX_HALF)
+                   >> FIX_SHIFT);
+    r.tx = (Fixed) (((int64_t) op.a * m.tx + (int64_t) op.c * m.ty + FIX_HALF)
+                    >> FIX_SHIFT) + op.tx;
+    r.ty = (Fixed) (((int64_t) op.b * m.tx + (int64_t) op.d * m.ty + FIX_HALF)
+                    >> FIX_SHIFT) + op.ty;
+
+    return r;
+}
+
+///
+/// A translation
+///
+FixedMatrix fixTranslate( Fixed tx, Fixed ty )
+{
+    FixedMatrix m = fixIdentity();
+    m.tx = tx;
+    m.ty = ty;
+    return m;
+}
+
+///
+/// A scale
+///
+FixedMatrix fixScale( Fixed sx, Fixed sy )
+{
+    FixedMatrix m = fixIdentity();
+    m.a = sx;
+    m.d = sy;
+    return m;
+}
+
+///
+/// A counterclockwise rotation
+///
+FixedMatrix fixRotate( Fixed degrees )
+{
+    Fixed s, c;
+    fixSinCos( degrees, s, c );
+
+    FixedMatrix m = { c, s, -s, c, 0, 0 };
+    return m;
+}
+
+///
+/// Sine and cosine of an angle, computed with CORDIC (no libm)
+///
+/// @param degrees   the angle
+/// @param s         receives the sine
+/// @param c         receives the cosine
+///
+void fixSinCos( Fixed degrees, Fixed &s, Fixed &c )
+{
+    // reduce to (-180,180], then to [-90,90] by turning half way round
+    const Fixed full = 360 * FIX_ONE;
+    const Fixed half = 180 * FIX_ONE;
+
+    Fixed a = degrees % full;
+    if( a > half ) a -= full;
+    if( a <= -half ) a += full;
+
+    bool flip = false;
+    if( a > half / 2 ) {
+        a -= half;
+        flip = true;
+    } else if( a < -half / 2 ) {
+        a += half;
+        flip = true;
+    }
+
+    // rotate (K,0) by the angle; x and y are 2.30, z is 8.24
+    int64_t x = cordicGain;
+    int64_t y = 0;
+    int64_t z = (int64_t) a << (CORDIC_SHIFT - FIX_SHIFT);
+
+    for( int i = 0; i < CORDIC_STEPS; ++i ) {
+        int64_t dx = y >> i;
+        int64_t dy = x >> i;
+        if( z >= 0 ) {
+            x -= dx;
+            y += dy;
+            z -= cordicAngle[i];
+        } else {
+            x += dx;
+            y -= dy;
+            z += cordicAngle[i];
+        }
+    }
+
+    // back to 16.16
+    const int shift = 30 - FIX_SHIFT;
+    c = (Fixed) ((x + (1 << (shift - 1))) >> shift);
+    s = (Fixed) ((y + (1 << (shift - 1))) >> shift);
+
+    if( flip ) {
+        c = -c;
+        s = -s;
+    }
+}
+
+///
+/// Apply a transformation to a set of points, rounding each result to
+/// the nearest integer as the floating-point applyMatrix() does
+///
+/// @param n   number of points
+/// @param v   the points (modified in place)
+/// @param m   the transformation
+///
+void applyMatrix( int n, FixedVertex v[], const FixedMatrix &m )
+{
+    for( int i = 0; i < n; ++i ) {
+        int64_t x = (int64_t) m.a * v[i].x + (int64_t) m.c * v[i].y;
+        int64_t y = (int64_t) m.b * v[i].x + (int64_t) m.d * v[i].y;
+        v[i].x = fixRoundPixel( (Fixed) ((x + FIX_HALF) >> FIX_SHIFT) + m.tx );
+        v[i].y = fixRoundPixel( (Fixed) ((y + FIX_HALF) >> FIX_SHIFT) + m.ty );
+    }
+}
+
+///
+/// Fixed-point version of clipPolygon()
+///
+/// @param num   the number of vertices in the polygon to be clipped
+/// @param inV   the incoming vertex list
+/// @param outV  the outgoing vertex list
+/// @param ll    the lower-left corner of the clipping rectangle
+/// @param ur    the upper-right corner of the clipping rectangle
+///
+/// @return number of vertices in the polygon resulting after clipping
+///
+int clipPolygon( int num, const FixedVertex inV[], FixedVertex outV[],
+                 FixedVertex ll, FixedVertex ur )
+{
+    const Fixed edge[N_CLIP] = { ur.y, ur.x, ll.y, ll.x };
+
+    vector<FixedVertex> in( inV, inV + num );
+    vector<FixedVertex> out;
+    out.reserve( 2 * num + 4 );
+
+    for( int side = 0; side < N_CLIP && !in.empty(); ++side ) {
+        out.clear();
+        int n = in.size();
+        for( int i = 0; i < n; ++i ) {
+            const FixedVertex &cur = in[i];
+            const FixedVertex &prev = in[i == 0 ? n - 1 : i - 1];
+            bool curIn = inside( cur, side, edge[side] );
+            bool prevIn = inside( prev, side, edge[side] );
+
+            if( curIn ) {
+                if( !prevIn ) {
+                    out.push_back( crossing( prev, cur, side, edge[side] ) );
+                }
+                out.push_back( cur );
+            } else if( prevIn ) {
+                out.push_back( crossing( prev, cur, side, edge[side] ) );
+            }
+        }
+        in.swap( out );
+    }
+
+    for( size_t i = 0; i < in.size(); ++i ) {
+        outV[i] = in[i];
+    }
+
+    return( in.size() );
+}
@@ -0,0 +1,196 @@
+//
+//  Fixed.h
+//
+//  16.16 fixed-point arithmetic for the 2D pipeline.
+//
+//  In the Pipeline's fixed-point mode (see Pipeline::setArithmetic()),
+//  the model transformation, clipping, the viewport mapping and the
+//  edge setup for scan conversion are all done with these types and
+//  functions.  Nothing between addPoly() and the pixels depends on
+//  floating-point rounding, FMA contraction or the math library, so
+//  the output is the same on every platform and with every compiler
+//  and optimization setting.
+//
+//  Values are signed 16.16:  coordinates must stay within +/-32767.
+//  Products are formed in 64 bits and rounded once, to nearest.  Right
+//  shifts of negative values are assumed to be arithmetic, as they are
+//  with every compiler we use.
+//
+
+#ifndef FIXED_H_
+#define FIXED_H_
+
+#include <stdint.h>
+#include <math.h>
+
+#include "Types.h"
+
+// a 16.16 fixed-point number
+typedef int32_t Fixed;
+
+#define FIX_SHIFT   16
+#define FIX_ONE     (1 << FIX_SHIFT)
+#define FIX_HALF    (1 << (FIX_SHIFT - 1))
+
+// the largest coordinate, in either direction, that fits in a Fixed
+#define FIX_MAX_COORD   32767
+
+//
+// A 2D point in fixed point
+//
+
+typedef struct st_fixvertex {
+    Fixed x;
+    Fixed y;
+} FixedVertex;
+
+//
+// A 2D affine transformation in fixed point:
+//
+//     | a  c  tx |
+//     | b  d  ty |
+//     | 0  0  1  |
+//
+
+typedef struct st_fixmatrix {
+    Fixed a, b;
+    Fixed c, d;
+    Fixed tx, ty;
+} FixedMatrix;
+
+///
+/// Convert a float to fixed point, rounding to nearest; f must lie
+/// within +/-FIX_MAX_COORD (see fixFits())
+///
+inline Fixed toFixed( float f )
+{
+    // scaling by a power of two is exact, so this is deterministic
+    return (Fixed) floor( (double) f * FIX_ONE + 0.5 );
+}
+
+///
+/// Can a value be converted with toFixed()?
+///
+inline bool fixFits( double f )
+{
+    return( f >= -FIX_MAX_COORD && f <= FIX_MAX_COORD );
+}
+
+///
+/// Convert an integer to fixed point
+///
+inline Fixed intToFixed( int i )
+{
+    return (Fixed) (i * FIX_ONE);
+}
+
+///
+/// Convert fixed point to float
+///
+inline float fixedToFloat( Fixed f )
+{
+    return (float) f / FIX_ONE;
+}
+
+///
+/// Round to the nearest integer, halves rounding up (like floor(v+0.5))
+///
+inline int fixRound( Fixed f )
+{
+    return (f + FIX_HALF) >> FIX_SHIFT;
+}
+
+///
+/// Round to the nearest integral fixed-point value
+///
+inline Fixed fixRoundPixel( Fixed f )
+{
+    return (Fixed) ((f + FIX_HALF) & ~(FIX_ONE - 1));
+}
+
+///
+/// Multiply two fixed-point values
+///
+inline Fixed fixMul( Fixed a, Fixed b )
+{
+    return (Fixed) (((int64_t) a * b + FIX_HALF) >> FIX_SHIFT);
+}
+
+///
+/// Compute a * b / c with a 64-bit intermediate, rounding to nearest
+/// (halves away from zero); c must not be zero
+///
+inline Fixed fixMulDiv( Fixed a, Fixed b, Fixed c )
+{
+    int64_t num = (int64_t) a * b;
+    int64_t den = c;
+
+    if( den < 0 ) {
+        num = -num;
+        den = -den;
+    }
+
+    return (Fixed) (num >= 0 ? (num + den / 2) / den
+                             : -((-num + den / 2) / den));
+}
+
+///
+/// The identity transformation
+///
+FixedMatrix fixIdentity( void );
+
+///
+/// Compose two transformations:  the result applies m, then op
+///
+/// @param op   the transformation applied second
+/// @param m    the transformation applied first
+///
+FixedMatrix fixCompose( const FixedMatrix &op, const FixedMatrix &m );
+
+///
+/// Basic transformations
+///
+/// @param tx,ty     translation amounts
+/// @param sx,sy     scale factors
+/// @param degrees   counterclockwise rotation angle
+///
+FixedMatrix fixTranslate( Fixed tx, Fixed ty );
+FixedMatrix fixScale( Fixed sx, Fixed sy );
+FixedMatrix fixRotate( Fixed degrees );
+
+///
+/// Sine and cosine of an angle, computed with CORDIC (no libm)
+///
+/// @param degrees   the angle
+/// @param s         receives the sine
+/// @param c         receives the cosine
+///
+void fixSinCos( Fixed degrees, Fixed &s, Fixed &c );
+
+///
+/// Apply a transformation to a set of points, rounding each result to
+/// the nearest integer as the floating-point applyMatrix() does
+///
+/// @param n   number of points
+/// @param v   the points (modified in place)
+/// @param m   the transformation
+///
+void applyMatrix( int n, FixedVertex v[], const FixedMatrix &m );
+
+///
+/// Fixed-point version of clipPolygon():  Sutherland-Hodgman clipping
+/// against the boundaries in the same order, producing vertices in the
+/// same order.  outV must have room for 5 * num + 4 vertices.
+///
+/// @param num   the number of vertices in the polygon to be clipped
+/// @param inV   the incoming vertex list
+/// @param outV  the outgoing vertex list
+/// @param ll    the lower-left corner of the clipping rectangle
+/// @param ur    the upper-right corner of the clipping rectangle
+///
+/// @return number of vertices in the polygon resulting after clipping
+///
+int clipPolygon( int num, const FixedVertex inV[], FixedVertex outV[],
+                 FixedVertex ll, FixedVertex ur );
+
+#endif
@@ -0,0 +1,500 @@
+//
+//  Framebuffer.cpp
+//
+//  A simple CPU-side RGB framebuffer for the 2D pipeline.
+//
+//  See Framebuffer.h for a description of the module.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+#include "Framebuffer.h"
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Convert a color channel to an 8-bit value
+///
+static unsigned char toByte( float f )
+{
+    if( f <= 0.0f ) return 0;
+    if( f >= 1.0f ) return 255;
+    return (unsigned char) (f * 255.0f + 0.5f);
+}
+
+//
+// PNG support
+//
+// We only need to write PNG files, and only ones that can be read by
+// standard tools, so the image data is wrapped in "stored" (i.e.,
+// uncompressed) deflate blocks.  That avoids a dependency on zlib.
+//
+
+static unsigned int crcTable[256];
+static bool crcReady = false;
+
+static unsigned int crc32( unsigned int crc, const unsigned char *buf,
+                           size_t len )
+{
+    if( !crcReady ) {
+        for( unsigned int n = 0; n < 256; ++n ) {
+            unsigned int c = n;
+            for( int k = 0; k < 8; ++k ) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            crcTable[n] = c;
+        }
+        crcReady = true;
+    }
+
+    crc ^= 0xffffffffu;
+    for( size_t i = 0; i < len; ++i ) {
+        crc = crcTable[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+static void put32( vector<unsigned char> &v, unsigned int n )
+{
+    v.push_back( (n >> 24) & 0xff );
+    v.push_back( (n >> 16) & 0xff );
+    v.push_back( (n >>  8) & 0xff );
+    v.push_back( n & 0xff );
+}
+
+///
+/// Write one PNG chunk (length, type, data, CRC)
+///
+static void writeChunk( FILE *fp, const char *type,
+                        const vector<unsigned char> &body )
+{
+    vector<unsigned char> buf;
+    put32( buf, body.size() );
+    buf.insert( buf.end(), type, type + 4 );
+    buf.insert( buf.end(), body.begin(), body.end() );
+    put32( buf, crc32( 0, &buf[4], buf.size() - 4 ) );
+    fwrite( &buf[0], 1, buf.size(), fp );
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Constructor
+///
+/// @param w   width of the framebuffer
+/// @param h   height of the framebuffer
+///
+Framebuffer::Framebuffer( int w, int h ) : width(0), height(0)
+{
+    resize( w, h );
+}
+
+///
+/// Change the dimensions; the contents are cleared to black
+///
+/// @param w   new width
+/// @param h   new height
+///
+void Framebuffer::resize( int w, int h )
+{
+    width = w > 0 ? w : 0;
+    height = h > 0 ? h : 0;
+    data.assign( (size_t) width * height * 3, 0 );
+}
+
+///
+/// Fill the whole framebuffer with a color
+///
+/// @param c   the fill color (alpha is ignored)
+///
+void Framebuffer::clear( Color c )
+{
+    unsigned char rgb[3] = { toByte(c.r), toByte(c.g), toByte(c.b) };
+
+    for( size_t i = 0; i < data.size(); i += 3 ) {
+        data[i] = rgb[0];
+        data[i+1] = rgb[1];
+        data[i+2] = rgb[2];
+    }
+}
+
+///
+/// Set one pixel; coordinates outside the framebuffer are ignored
+///
+/// @param x   x coordinate
+/// @param y   y coordinate
+/// @param c   the color (alpha is ignored)
+///
+void Framebuffer::setPixel( int x, int y, Color c )
+{
+    if( x < 0 || y < 0 || x >= width || y >= height ) {
+        return;
+    }
+
+    unsigned char *p = &data[((size_t) y * width + x) * 3];
+    p[0] = toByte( c.r );
+    p[1] = toByte( c.g );
+    p[2] = toByte( c.b );
+}
+
+///
+/// Set a horizontal run of pixels, x0 <= x < x1, on row y;
+/// the run is clipped to the framebuffer
+///
+/// @param x0  first x coordinate
+/// @param x1  one past the last x coordinate
+/// @param y   y coordinate
+/// @param c   the color (alpha is ignored)
+///
+void Framebuffer::fillSpan( int x0, int x1, int y, Color c )
+{
+    if( y < 0 || y >= height ) {
+        return;
+    }
+    if( x0 < 0 ) x0 = 0;
+    if( x1 > width ) x1 = width;
+
+    unsigned char rgb[3] = { toByte(c.r), toByte(c.g), toByte(c.b) };
+    unsigned char *p = &data[((size_t) y * width + x0) * 3];
+    for( int x = x0; x < x1; ++x, p += 3 ) {
+        p[0] = rgb[0];
+        p[1] = rgb[1];
+        p[2] = rgb[2];
+    }
+}
+
+///
+/// Blend a color into one pixel; coordinates outside the
+/// framebuffer are ignored
+///
+/// @param x   x coordinate
+/// @param y   y coordinate
+/// @param c   the color (alpha is ignored)
+/// @param a   coverage of the pixel, 0 to 1
+///
+void Framebuffer::blendPixel( int x, int y, Color c, float a )
+{
+    if( x < 0 || y < 0 || x >= width || y >= height ) {
+        return;
+    }
+
+    unsigned char *p = &data[((size_t) y * width + x) * 3];
+    p[0] = toByte( p[0] / 255.0f + a * (c.r - p[0] / 255.0f) );
+    p[1] = toByte( p[1] / 255.0f + a * (c.g - p[1] / 255.0f) );
+    p[2] = toByte( p[2] / 255.0f + a * (c.b - p[2] / 255.0f) );
+}
+
+///
+/// Retrieve one pixel as packed 0xRRGGBB
+///
+/// @param x   x coordinate
+/// @param y   y coordinate
+///
+/// @return the pixel value, or 0 if (x,y) is outside the framebuffer
+///
+unsigned int Framebuffer::getPixel( int x, int y ) const
+{
+    if( x < 0 || y < 0 || x >= width || y >= height ) {
+        return 0;
+    }
+
+    const unsigned char *p = &data[((size_t) y * width + x) * 3];
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+///
+/// Splat a Canvas pixel stream into the framebuffer
+///
+/// @param n        number of pixels in the stream
+/// @param points   XYZW locations
+/// @param colors   RGBA colors
+///
+/// @return the number of pixels that fell outside the framebuffer
+///
+long Framebuffer::drawPixels( int n, const float *points,
+                              const float *colors )
+{
+    long outside = 0;
+
+    if( points == NULL || colors == NULL ) {
+        return 0;
+    }
+
+    for( int i = 0; i < n; ++i ) {
+        // the pipeline produces integral locations, but be safe
+        int x = (int) (points[4*i] + (points[4*i] < 0.0f ? -0.5f : 0.5f));
+        int y = (int) (points[4*i+1] + (points[4*i+1] < 0.0f ? -0.5f : 0.5f));
+        if( x < 0 || y < 0 || x >= width || y >= height ) {
+            ++outside;
+            continue;
+        }
+        Color c = { colors[4*i], colors[4*i+1], colors[4*i+2], 1.0f };
+        setPixel( x, y, c );
+    }
+
+    return outside;
+}
+
+///
+/// Write the image as a binary PPM (P6) file
+///
+/// @param fname   name of the output file
+///
+/// @return true on success
+///
+bool Framebuffer::writePPM( const char *fname ) const
+{
+    FILE *fp = fopen( fname, "wb" );
+    if( fp == NULL ) {
+        perror( fname );
+        return( false );
+    }
+
+    fprintf( fp, "P6\n%d %d\n255\n", width, height );
+
+    // PPM rows run from top to bottom
+    for( int y = height - 1; y >= 0; --y ) {
+        fwrite( &data[(size_t) y * width * 3], 1, width * 3, fp );
+    }
+
+    bool ok = !ferror( fp );
+    fclose( fp );
+    return( ok );
+}
+
+///
+/// Write the image as an (uncompressed) PNG file
+///
+/// @param fname   name of the output file
+///
+/// @return true on success
+///
+bool Framebuffer::writePNG( const char *fname ) const
+{
+    FILE *fp = fopen( fname, "wb" );
+    if( fp == NULL ) {
+        perror( fname );
+        return( false );
+    }
+
+    static const unsigned char sig[8] =
+        { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    fwrite( sig, 1, 8, fp );
+
+    // IHDR:  8-bit RGB, no interlacing
+    vector<unsigned char> ihdr;
+    put32( ihdr, width );
+    put32( ihdr, height );
+    ihdr.push_back( 8 );    // bit depth
+    ihdr.push_back( 2 );    // color type:  RGB
+    ihdr.push_back( 0 );    // compression
+    ihdr.push_back( 0 );    // filter
+    ihdr.push_back( 0 );    // interlace
+    writeChunk( fp, "IHDR", ihdr );
+
+    // raw scanlines, top to bottom, each preceded by filter type 0
+    vector<unsigned char> raw;
+    raw.reserve( (size_t) height * (width * 3 + 1) );
+    for( int y = height - 1; y >= 0; --y ) {
+        raw.push_back( 0 );
+        const unsigned char *row = &data[(size_t) y * width * 3];
+        raw.insert( raw.end(), row, row + width * 3 );
+    }
+
+    // zlib stream made of stored deflate blocks
+    vector<unsigned char> z;
+    z.push_back( 0x78 );
+    z.push_back( 0x01 );
+    size_t pos = 0;
+    do {
+        size_t len = raw.size() - pos;
+        if( len > 65535 ) len = 65535;
+        bool last = pos + len == raw.size();
+        z.push_back( last ? 1 : 0 );
+        z.push_back( len & 0xff );
+        z.push_back( (len >> 8) & 0xff );
+        z.push_back( ~len & 0xff );
+        z.push_back( (~len >> 8) & 0xff );
+        z.insert( z.end(), raw.begin() + pos, raw.begin() + pos + len );
+        pos += len;
+    } while( pos < raw.size() );
+
+    // Adler-32 of the uncompressed data
+    unsigned int a = 1, b = 0;
+    for( size_t i = 0; i < raw.size(); ++i ) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32( z, (b << 16) | a );
+
+    writeChunk( fp, "IDAT", z );
+    writeChunk( fp, "IEND", vector<unsigned char>() );
+
+    bool ok = !ferror( fp );
+    fclose( fp );
+    return( ok );
+}
+
+///
+/// Read the next header token from a PPM file, skipping comments
+///
+static bool ppmToken( FILE *fp, int &value )
+{
+    int c = fgetc( fp );
+    for( ;; ) {
+        while( c == ' ' || c == '\t' || c == '\r' || c == '\n' ) {
+            c = fgetc( fp );
+        }
+        if( c != '#' ) {
+            break;
+        }
+        while( c != '\n' && c != EOF ) {
+            c = fgetc( fp );
+        }
+    }
+
+    if( c < '0' || c > '9' ) {
+        return( false );
+    }
+
+    value = 0;
+    while( c >= '0' && c <= '9' ) {
+        value = value * 10 + (c - '0');
+        c = fgetc( fp );
+    }
+    // 'c' is the single whitespace character ending the token
+    return( true );
+}
+
+///
+/// Read a binary PPM (P6, maxval 255) file, replacing our contents
+///
+/// @param fname   name of the input file
+///
+/// @return true on success
+///
+bool Framebuffer::readPPM( const char *fname )
+{
+    FILE *fp = fopen( fname, "rb" );
+    if( fp == NULL ) {
+        perror( fname );
+        return( false );
+    }
+
+    int w, h, maxval;
+    if( fgetc(fp) != 'P' || fgetc(fp) != '6' ||
+        !ppmToken( fp, w ) || !ppmToken( fp, h ) ||
+        !ppmToken( fp, maxval ) || maxval != 255 ) {
+        cerr << fname << ": not a binary 8-bit PPM file" << endl;
+        fclose( fp );
+        return( false );
+    }
+
+    resize( w, h );
+    bool ok = true;
+    for( int y = height - 1; y >= 0 && ok; --y ) {
+        size_t len = (size_t) width * 3;
+        ok = fread( &data[(size_t) y * len], 1, len, fp ) == len;
+    }
+    fclose( fp );
+
+    if( !ok ) {
+        cerr << fname << ": short read" << endl;
+    }
+    return( ok );
+}
+
+///
+/// Compare against another framebuffer
+///
+/// @param other   the framebuffer to compare with
+/// @param diff    where to put the results
+/// @param mask    if not NULL, receives an image with differing
+///                pixels in red over a darkened copy of this one
+///
+void Framebuffer::compare( const Framebuffer &other, ImageDiff &diff,
+                           Framebuffer *mask ) const
+{
+    diff.count = 0;
+    diff.edgeCount = 0;
+    diff.maxDelta = 0;
+    diff.xmin = diff.ymin = diff.xmax = diff.ymax = 0;
+    diff.sizeMismatch = width != other.width || height != other.height;
+
+    if( diff.sizeMismatch ) {
+        return;
+    }
+
+    if( mask ) {
+        mask->resize( width, height );
+    }
+
+    for( int y = 0; y < height; ++y ) {
+        for( int x = 0; x < width; ++x ) {
+            size_t i = ((size_t) y * width + x) * 3;
+            int delta = 0;
+            for( int k = 0; k < 3; ++k ) {
+                int d = abs( (int) data[i+k] - (int) other.data[i+k] );
+                if( d > delta ) delta = d;
+            }
+
+            if( mask ) {
+                for( int k = 0; k < 3; ++k ) {
+                    mask->data[i+k] = delta ? (k == 0 ? 255 : 0)
+                                            : data[i+k] / 4;
+                }
+            }
+
+            if( delta == 0 ) {
+                continue;
+            }
+
+            if( diff.count == 0 ) {
+                diff.xmin = diff.xmax = x;
+                diff.ymin = diff.ymax = y;
+            } else {
+                if( x < diff.xmin ) diff.xmin = x;
+                if( x > diff.xmax ) diff.xmax = x;
+                if( y < diff.ymin ) diff.ymin = y;
+                if( y > diff.ymax ) diff.ymax = y;
+            }
+            if( delta > diff.maxDelta ) diff.maxDelta = delta;
+            ++diff.count;
+            if( onEdge( x, y ) || other.onEdge( x, y ) ) {
+                ++diff.edgeCount;
+            }
+        }
+    }
+}
+
+///
+/// Does any of a pixel's eight neighbors have a different color?
+///
+/// @param x   column of the pixel
+/// @param y   row of the pixel
+///
+bool Framebuffer::onEdge( int x, int y ) const
+{
+    unsigned int c = getPixel( x, y );
+
+    for( int dy = -1; dy <= 1; ++dy ) {
+        for( int dx = -1; dx <= 1; ++dx ) {
+            int nx = x + dx, ny = y + dy;
+            if( nx < 0 || ny < 0 || nx >= width || ny >= height ) {
+                continue;
+            }
+            if( getPixel( nx, ny ) != c ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,193 @@
+//
+//  Framebuffer.h
+//
+//  A simple CPU-side RGB framebuffer for the 2D pipeline.
+//
+//  The Canvas only records a stream of pixels (positions plus colors)
+//  that the application later uploads to OpenGL as points.  This module
+//  turns that stream into an actual raster, so that Pipeline output can
+//  be inspected, saved, and compared without a window or a GL context.
+//
+//  Images are written as binary PPM (P6) or as uncompressed PNG, and
+//  PPM files can be read back for comparison.  Pixel coordinates follow
+//  the Canvas convention:  (0,0) is the lower-left corner of the image.
+//
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <vector>
+
+#include "Types.h"
+#include "PixelSink.h"
+
+using namespace std;
+
+///
+/// Result of comparing two framebuffers
+///
+struct ImageDiff {
+    long count;        // number of differing pixels
+    long edgeCount;    // how many of them lie on an edge in either image
+    int maxDelta;      // largest per-channel difference
+    int xmin, ymin;    // bounding box of the differing pixels
+    int xmax, ymax;    //   (only valid if count > 0)
+    bool sizeMismatch; // the images have different dimensions
+};
+
+///
+/// Dense 8-bit RGB framebuffer
+///
+
+class Framebuffer : public PixelSink {
+
+    // image dimensions
+    int width;
+    int height;
+
+    // pixel data, RGB, rows stored bottom to top
+    vector<unsigned char> data;
+
+    // does any of the pixel's eight neighbors have a different color?
+    bool onEdge( int x, int y ) const;
+
+public:
+
+    ///
+    /// Constructor
+    ///
+    /// @param w   width of the framebuffer
+    /// @param h   height of the framebuffer
+    ///
+    Framebuffer( int w = 0, int h = 0 );
+
+    ///
+    /// Change the dimensions; the contents are cleared to black
+    ///
+    /// @param w   new width
+    /// @param h   new height
+    ///
+    void resize( int w, int h );
+
+    int getWidth( void ) const { return width; }
+    int getHeight( void ) const { return height; }
+
+    ///
+    /// The whole framebuffer
+    ///
+    Rect bounds( void ) const
+    {
+        Rect r = { 0, 0, width - 1, height - 1 };
+        return r;
+    }
+
+    ///
+    /// Fill the whole framebuffer with a color
+    ///
+    /// @param c   the fill color (alpha is ignored)
+    ///
+    void clear( Color c );
+
+    ///
+    /// Set one pixel; coordinates outside the framebuffer are ignored
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color (alpha is ignored)
+    ///
+    void setPixel( int x, int y, Color c );
+
+    ///
+    /// Set a horizontal run of pixels, x0 <= x < x1, on row y;
+    /// the run is clipped to the framebuffer
+    ///
+    /// @param x0  first x coordinate
+    /// @param x1  one past the last x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color (alpha is ignored)
+    ///
+    void fillSpan( int x0, int x1, int y, Color c );
+
+    ///
+    /// Blend a color into one pixel; coordinates outside the
+    /// framebuffer are ignored
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color (alpha is ignored)
+    /// @param a   coverage of the pixel, 0 to 1
+    ///
+    void blendPixel( int x, int y, Color c, float a );
+
+    ///
+    /// Retrieve one pixel as packed 0xRRGGBB
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    ///
+    /// @return the pixel value, or 0 if (x,y) is outside the framebuffer
+    ///
+    unsigned int getPixel( int x, int y ) const;
+
+    ///
+    /// Splat a Canvas pixel stream into the framebuffer
+    ///
+    /// The arrays are in the layout returned by Canvas::getVertices()
+    /// and Canvas::getColors() (four floats per entry).  Later pixels
+    /// overwrite earlier ones, just as they do when the stream is drawn
+    /// as GL points with a LEQUAL depth test.
+    ///
+    /// @param n        number of pixels in the stream
+    /// @param points   XYZW locations
+    /// @param colors   RGBA colors
+    ///
+    /// @return the number of pixels that fell outside the framebuffer
+    ///
+    long drawPixels( int n, const float *points, const float *colors );
+
+    ///
+    /// Write the image as a binary PPM (P6) file
+    ///
+    /// @param fname   name of the output file
+    ///
+    /// @return true on success
+    ///
+    bool writePPM( const char *fname ) const;
+
+    ///
+    /// Write the image as an (uncompressed) PNG file
+    ///
+    /// @param fname   name of the output file
+    ///
+    /// @return true on success
+    ///
+    bool writePNG( const char *fname ) const;
+
+    ///
+    /// Read a binary PPM (P6, maxval 255) file, replacing our contents
+    ///
+    /// @param fname   name of the input file
+    ///
+    /// @return true on success
+    ///
+    bool readPPM( const char *fname );
+
+    ///
+    /// Compare against another framebuffer
+    ///
+    /// A differing pixel lies on an edge if, in either image, one of
+    /// its eight neighbors has a different color from it.  Two
+    /// renderers that disagree only about which pixels an edge covers
+    /// differ only on edges.
+    ///
+    /// @param other   the framebuffer to compare with
+    /// @param diff    where to put the results
+    /// @param mask    if not NULL, receives an image with differing
+    ///                pixels in red over a darkened copy of this one
+    ///
+    void compare( const Framebuffer &other, ImageDiff &diff,
+                  Framebuffer *mask = 0 ) const;
+
+};
+
+#endif
@@ -0,0 +1,283 @@
+//
+//  Path.cpp
+//
+//  Closed contours made of lines, Bezier curves and circular arcs.
+//
+//  See Path.h for a description of the module.
+//
+
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+
+#include "Path.h"
+
+using namespace std;
+
+//
+// PRIVATE DATA
+//
+
+// never split one segment into more steps than this
+#define MAX_STEPS   4096
+
+// a handy definition of PI
+#define PATH_PI     3.14159265358979323846
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Append a vertex unless it repeats the previous one
+///
+static void emit( vector<Vertex> &out, float x, float y )
+{
+    if( !out.empty() && out.back().x == x && out.back().y == y ) {
+        return;
+    }
+    Vertex v = { x, y, 0.0f, 1.0f };
+    out.push_back( v );
+}
+
+///
+/// Number of equal parameter steps that keeps a curve within tol of
+/// its chords, given a bound on the length of its second derivative
+///
+/// Linear interpolation over a step h is off by at most h^2 M / 8,
+/// so n = ceil( sqrt( M / (8 tol) ) ) steps are enough.
+///
+static int steps( double m, double tol )
+{
+    double n = ceil( sqrt( m / (8.0 * tol) ) );
+    if( n < 1.0 ) return 1;
+    if( n > MAX_STEPS ) return MAX_STEPS;
+    return (int) n;
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Constructor
+///
+Path::Path( void )
+{
+    clear();
+}
+
+///
+/// Start the contour at (x,y)
+///
+void Path::moveTo( float x, float y )
+{
+    if( !ops.empty() ) {
+        cerr << "Path: moveTo() after the contour was started, "
+             << "treating it as lineTo()" << endl;
+        lineTo( x, y );
+        return;
+    }
+
+    ops.push_back( PathMove );
+    args.push_back( x );
+    args.push_back( y );
+    curX = x;
+    curY = y;
+}
+
+///
+/// A straight line from the current point to (x,y)
+///
+void Path::lineTo( float x, float y )
+{
+    if( ops.empty() ) {
+        moveTo( x, y );
+        return;
+    }
+
+    ops.push_back( PathLine );
+    args.push_back( x );
+    args.push_back( y );
+    curX = x;
+    curY = y;
+}
+
+///
+/// A quadratic Bezier from the current point to (x,y)
+///
+void Path::quadTo( float cx, float cy, float x, float y )
+{
+    if( ops.empty() ) {
+        moveTo( curX, curY );
+    }
+
+    ops.push_back( PathQuad );
+    args.push_back( cx );
+    args.push_back( cy );
+    args.push_back( x );
+    args.push_back( y );
+    curX = x;
+    curY = y;
+}
+
+///
+/// A cubic Bezier from the current point to (x,y)
+///
+void Path::cubicTo( float c1x, float c1y, float c2x, float c2y,
+                    float x, float y )
+{
+    if( ops.empty() ) {
+        moveTo( curX, curY );
+    }
+
+    ops.push_back( PathCubic );
+    args.push_back( c1x );
+    args.push_back( c1y );
+    args.push_back( c2x );
+    args.push_back( c2y );
+    args.push_back( x );
+    args.push_back( y );
+    curX = x;
+    curY = y;
+}
+
+///
+/// A circular arc around (cx,cy) from angle start to angle end
+///
+void Path::arc( float cx, float cy, float r, float start, float end )
+{
+    double a0 = start * PATH_PI / 180.0;
+    double a1 = end * PATH_PI / 180.0;
+    float x0 = (float) (cx + r * cos( a0 ));
+    float y0 = (float) (cy + r * sin( a0 ));
+
+    if( ops.empty() ) {
+        moveTo( x0, y0 );
+    }
+
+    ops.push_back( PathArc );
+    args.push_back( cx );
+    args.push_back( cy );
+    args.push_back( r );
+    args.push_back( start );
+    args.push_back( end );
+    curX = (float) (cx + r * cos( a1 ));
+    curY = (float) (cy + r * sin( a1 ));
+}
+
+///
+/// Forget all segments
+///
+void Path::clear( void )
+{
+    ops.clear();
+    args.clear();
+    curX = curY = 0.0f;
+}
+
+///
+/// Convert the contour to a polygon
+///
+/// @param tol   largest allowed distance between the polygon and
+///              the curve, in the path's own units
+/// @param out   receives the vertices (the closing edge is implied)
+///
+void Path::flatten( float tol, vector<Vertex> &out ) const
+{
+    out.clear();
+    if( tol <= 0.0f ) {
+        tol = 1.0e-3f;
+    }
+
+    size_t k = 0;
+    double px = 0.0, py = 0.0;   // current point
+
+    for( size_t i = 0; i < ops.size(); ++i ) {
+        const float *a = &args[k];
+
+        switch( ops[i] ) {
+        case PathMove:
+        case PathLine:
+            emit( out, a[0], a[1] );
+            px = a[0];
+            py = a[1];
+            k += 2;
+            break;
+
+        case PathQuad: {
+            // B'' = 2 (p0 - 2 p1 + p2), constant
+            double dx = px - 2.0 * a[0] + a[2];
+            double dy = py - 2.0 * a[1] + a[3];
+            int n = steps( 2.0 * sqrt( dx * dx + dy * dy ), tol );
+            for( int s = 1; s <= n; ++s ) {
+                double t = (double) s / n, u = 1.0 - t;
+                emit( out,
+                      (float) (u * u * px + 2.0 * u * t * a[0] + t * t * a[2]),
+                      (float) (u * u * py + 2.0 * u * t * a[1] + t * t * a[3]) );
+            }
+            px = a[2];
+            py = a[3];
+            k += 4;
+            break;
+        }
+
+        case PathCubic: {
+            // B'' = 6 ((1-t) (p0 - 2 p1 + p2) + t (p1 - 2 p2 + p3)),
+            // so it is largest at one end
+            double d0x = px - 2.0 * a[0] + a[2];
+            double d0y = py - 2.0 * a[1] + a[3];
+            double d1x = a[0] - 2.0 * a[2] + a[4];
+            double d1y = a[1] - 2.0 * a[3] + a[5];
+            double m = sqrt( max( d0x * d0x + d0y * d0y,
+                                  d1x * d1x + d1y * d1y ) );
+            int n = steps( 6.0 * m, tol );
+            for( int s = 1; s <= n; ++s ) {
+                double t = (double) s / n, u = 1.0 - t;
+                double b0 = u * u * u, b1 = 3.0 * u * u * t;
+                double b2 = 3.0 * u * t * t, b3 = t * t * t;
+                emit( out,
+                      (float) (b0 * px + b1 * a[0] + b2 * a[2] + b3 * a[4]),
+                      (float) (b0 * py + b1 * a[1] + b2 * a[3] + b3 * a[5]) );
+            }
+            px = a[4];
+            py = a[5];
+            k += 6;
+            break;
+        }
+
+        case PathArc: {
+            double cx = a[0], cy = a[1], r = fabs( a[2] );
+            double a0 = a[3] * PATH_PI / 180.0;
+            double a1 = a[4] * PATH_PI / 180.0;
+
+            // a step of angle theta bulges r (1 - cos(theta/2)) away
+            // from its chord
+            int n = 1;
+            if( r > tol ) {
+                double theta = 2.0 * acos( 1.0 - tol / r );
+                n = (int) ceil( fabs( a1 - a0 ) / theta );
+                n = max( 1, min( n, MAX_STEPS ) );
+            }
+            for( int s = 0; s <= n; ++s ) {
+                double ang = a0 + (a1 - a0) * s / n;
+                emit( out, (float) (cx + r * cos( ang )),
+                           (float) (cy + r * sin( ang )) );
+            }
+            px = cx + r * cos( a1 );
+            py = cy + r * sin( a1 );
+            k += 5;
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    // the closing edge is implied
+    if( out.size() > 1 && out.back().x == out[0].x &&
+        out.back().y == out[0].y ) {
+        out.pop_back();
+    }
+}
@@ -0,0 +1,110 @@
+//
+//  Path.h
+//
+//  Closed contours made of lines, Bezier curves and circular arcs.
+//
+//  A Path describes one closed contour the way a drawing program
+//  would:  a starting point followed by line, quadratic and cubic
+//  Bezier, and arc segments.  flatten() turns it into a polygon whose
+//  vertices stay within a given distance of the true curve, using as
+//  few vertices as that allows; Pipeline::addPath() picks the distance
+//  from the current transformation and viewport, so that the polygon
+//  is only as detailed as it needs to be on the screen.
+//
+//  Each curve segment is split into equal parameter steps.  The number
+//  of steps comes from a bound on the curve's second derivative (for
+//  Beziers) or on the sagitta of each step (for arcs), so no vertex is
+//  wasted on flat stretches of a shape that has been scaled down, and
+//  curves do not look faceted when it is scaled up.
+//
+
+#ifndef PATH_H_
+#define PATH_H_
+
+#include <vector>
+
+#include "Types.h"
+
+using namespace std;
+
+//
+// Path segment types
+//
+typedef
+    enum pathops_e {
+        PathMove = 0, PathLine, PathQuad, PathCubic, PathArc
+        // Sentinel gives us the number of segment types
+        , N_PATHOPS
+    } PathOp;
+
+///
+/// One closed contour
+///
+
+class Path {
+
+    // segment types, and their arguments in order
+    vector<PathOp> ops;
+    vector<float> args;
+
+    // the current point
+    float curX, curY;
+
+public:
+
+    Path( void );
+
+    ///
+    /// Start the contour at (x,y).  This must come first; the contour
+    /// is closed back to this point automatically.
+    ///
+    void moveTo( float x, float y );
+
+    ///
+    /// A straight line from the current point to (x,y)
+    ///
+    void lineTo( float x, float y );
+
+    ///
+    /// A quadratic Bezier from the current point to (x,y), with
+    /// control point (cx,cy)
+    ///
+    void quadTo( float cx, float cy, float x, float y );
+
+    ///
+    /// A cubic Bezier from the current point to (x,y), with control
+    /// points (c1x,c1y) and (c2x,c2y)
+    ///
+    void cubicTo( float c1x, float c1y, float c2x, float c2y,
+                  float x, float y );
+
+    ///
+    /// A circular arc around (cx,cy), counterclockwise from angle
+    /// 'start' to angle 'end' (in degrees; make end < start to go
+    /// clockwise).  If the contour has been started, a line joins the
+    /// current point to the start of the arc; otherwise the arc
+    /// starts the contour.
+    ///
+    void arc( float cx, float cy, float r, float start, float end );
+
+    ///
+    /// Forget all segments
+    ///
+    void clear( void );
+
+    ///
+    /// Does the path have any segments?
+    ///
+    bool empty( void ) const { return ops.empty(); }
+
+    ///
+    /// Convert the contour to a polygon
+    ///
+    /// @param tol   largest allowed distance between the polygon and
+    ///              the curve, in the path's own units
+    /// @param out   receives the vertices (the closing edge is implied)
+    ///
+    void flatten( float tol, vector<Vertex> &out ) const;
+};
+
+#endif
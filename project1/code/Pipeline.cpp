@@ -14,8 +14,27 @@
 #include <iostream>
 #include <list>
 #include <algorithm>
+#include <cstring>
+#include <climits>
 #include <math.h>       /* cos sin */
 
+#if defined(PIPELINE_STATS)
+///
+/// Does a polygon have a vertex outside the clip window?  (Used only
+/// for counting; clipPolygon() decides for itself.)
+///
+template <class V>
+static bool crossesWindow( int n, const V v[], const V &ll, const V &ur )
+{
+    for (int i = 0; i < n; i++) {
+        if (v[i].x < ll.x || v[i].x > ur.x || v[i].y < ll.y || v[i].y > ur.y) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
 ///
 /// Simple wrapper class for midterm assignment
 ///
@@ -47,6 +66,20 @@ Pipeline::Pipeline( int w, int h ) : Canvas(w,h)
     upperRightView.y = h;
 
     tMatrix = glm::mat3(1.0f);
+    tKind = XIdentity;
+    fMatrix = fixIdentity();
+    arith = ArithFloat;
+    lineMode = LineAliased;
+    curveTol = 0.25f;
+
+    backend = FillCPU;
+
+    // pixels go to the Canvas until a sink is supplied
+    sink = NULL;
+    Rect all = { -(1 << 30), -(1 << 30), 1 << 30, 1 << 30 };
+    sinkClip = all;
+
+    resetStats();
 }
 
 ///
@@ -73,12 +106,129 @@ int Pipeline::addPoly( int n, const Vertex p[] )
 
     // Add to repository
     this->polys.push_back(newPoly);
+    this->polyCurve.push_back(-1);
     npolys++;
 
     // Index as ID
     return this->polys.size() - 1;
 }
 
+///
+/// addPath - Add a curved polygon to the canvas.  It is flattened each
+///           time it is drawn, to suit the current transformation and
+///           viewport.
+///
+/// @param p - the contour
+///
+/// @return a unique integer identifier for the polygon
+///
+int Pipeline::addPath( const Path &p )
+{
+    CurvedPoly c;
+    c.path = p;
+    this->curved.push_back(c);
+
+    // the unscaled flattening stands in for the curve anywhere the
+    // vertices are used directly
+    Polygon newPoly;
+    p.flatten(this->curveTol, newPoly.vertices);
+
+    this->polys.push_back(newPoly);
+    this->polyCurve.push_back(this->curved.size() - 1);
+    npolys++;
+
+    return this->polys.size() - 1;
+}
+
+///
+/// setCurveTolerance - Set how far, in pixels, a flattened curve may
+///                     stray from the true one.
+///
+/// @param pixels - the tolerance
+///
+/// @return the previous tolerance
+///
+float Pipeline::setCurveTolerance( float pixels )
+{
+    float old = this->curveTol;
+    if (pixels > 0.0f && pixels != old) {
+        this->curveTol = pixels;
+        for (size_t i = 0; i < this->curved.size(); i++) {
+            this->curved[i].flat.clear();
+        }
+    }
+    return old;
+}
+
+///
+/// screenScale - How much the current transformation followed by the
+///               viewport mapping can stretch a length:  the largest
+///               singular value of their combined 2x2 linear part.
+///
+float Pipeline::screenScale( void ) const
+{
+    float cw = this->upperRightClip.x - this->lowerLeftClip.x;
+    float ch = this->upperRightClip.y - this->lowerLeftClip.y;
+    double sx = cw == 0.0f ? 1.0 :
+        (this->upperRightView.x - this->lowerLeftView.x) / cw;
+    double sy = ch == 0.0f ? 1.0 :
+        (this->upperRightView.y - this->lowerLeftView.y) / ch;
+
+    double p = sx * this->tMatrix[0][0], q = sx * this->tMatrix[1][0];
+    double r = sy * this->tMatrix[0][1], s = sy * this->tMatrix[1][1];
+    double t = p * p + q * q + r * r + s * s;
+    double d = p * s - q * r;
+
+    return (float) sqrt((t + sqrt(max(t * t - 4.0 * d * d, 0.0))) / 2.0);
+}
+
+///
+/// polyVertices - The vertices of a stored polygon.  A curved polygon
+///                is flattened for the current scale, rounded up to a
+///                quarter octave, and the result is cached.
+///
+/// @param polyID - the polygon (must be valid)
+///
+const vector<Vertex> &Pipeline::polyVertices( int polyID )
+{
+    int c = this->polyCurve[polyID];
+    if (c < 0) {
+        return this->polys[polyID].vertices;
+    }
+
+    double scale = screenScale();
+    if (!(scale > 1.0e-6)) {
+        scale = 1.0e-6;
+    }
+    int bucket = (int) ceil(log2(scale) * 4.0);
+
+    map<int, vector<Vertex> > &flat = this->curved[c].flat;
+    map<int, vector<Vertex> >::iterator it = flat.find(bucket);
+    if (it == flat.end()) {
+        it = flat.insert(make_pair(bucket, vector<Vertex>())).first;
+        float tol = (float) (this->curveTol / pow(2.0, bucket / 4.0));
+        this->curved[c].path.flatten(tol, it->second);
+    }
+
+    return it->second;
+}
+
+///
+/// polyVertexCount - Number of vertices the polygon with the given id
+///                   would be drawn with right now.
+///
+/// @param polyID - the polygon
+///
+int Pipeline::polyVertexCount( int polyID )
+{
+    if( polyID < 0 || polyID >= npolys ) {
+        cerr << "error: polyVertexCount(" << polyID << "), invalid ID" << endl;
+        return 0;
+    }
+
+    return polyVertices(polyID).size();
+}
+
 ///
 /// drawPoly - Draw the polygon with the given id.  The polygon should
 ///            be drawn after applying the current transformation to
@@ -94,29 +244,682 @@ void Pipeline::drawPoly( int polyID )
         return;
     }
 
-    // Get the polygons starting vertices
-    vector<Vertex> currentV = this->polys[polyID].vertices;
+    // The GPU backend clips with the scissor test instead
+    if (this->backend == FillGPU) {
+        vector<Vertex> v = polyVertices(polyID);
+        if (v.empty()) {
+            return;
+        }
+        applyTransform(v.size(), &v[0], this->tMatrix, this->tKind);
+        applyViewport(v.size(), &v[0]);
+        recordGpuPoly(v.size(), &v[0]);
+        return;
+    }
+
+    // Fixed point all the way from the stored vertices to the pixels
+    if (this->arith == ArithFixed) {
+        vector<FixedVertex> out;
+        int outSize = screenPolyFixed(polyID, out);
+        if (outSize > 0) {
+            drawPolygon(outSize, &out[0]);
+        }
+        return;
+    }
+
+    // Transform, clip and map to the viewport
+    vector<Vertex> out;
+    int outSize = screenPoly(polyID, out);
+
+    // Draw final points
+    if (outSize > 0) {
+        drawPolygon(outSize, &out[0]);
+    }
+}
+
+///
+/// screenPoly - Run a stored polygon through the current transformation,
+///              the clip window and the viewport.
+///
+/// @param polyID - the ID of the polygon (must be valid)
+/// @param out - receives the clipped vertices in screen coordinates
+///
+/// @return the number of vertices in 'out'
+///
+int Pipeline::screenPoly( int polyID, vector<Vertex> &out )
+{
+    if (this->arith == ArithFixed) {
+        vector<FixedVertex> f;
+        int outSize = screenPolyFixed(polyID, f);
+        out.resize(outSize);
+        for (int i = 0; i < outSize; i++) {
+            out[i].x = fixRound(f[i].x);
+            out[i].y = fixRound(f[i].y);
+            out[i].z = 0.0f;
+            out[i].w = 1.0f;
+        }
+        return outSize;
+    }
+
+    return screenPolyFloat(polyID, out);
+}
+
+///
+/// screenPolyFloat - Floating-point version of screenPoly(), whatever
+///                   the current arithmetic.
+///
+/// @param polyID - the ID of the polygon (must be valid)
+/// @param out - receives the clipped vertices in screen coordinates
+///
+/// @return the number of vertices in 'out'
+///
+int Pipeline::screenPolyFloat( int polyID, vector<Vertex> &out )
+{
+    vector<Vertex> v = polyVertices(polyID);
+    int n = v.size();
 
-    // Init arrays
-    Vertex v[currentV.size()]; 
-    Vertex out[currentV.size()]; 
-    // set arrays for manipulating
-    for (int i = 0; i < currentV.size(); i++) {
-        v[i] = currentV[i];
-        out[i] = currentV[i];
+    out.clear();
+    if (n == 0) {
+        return 0;
     }
 
     // Apply the transformation matrix to each point
-    applyMatrix(currentV.size(), v, this->tMatrix);
+    {
+        PSTAT_TIME(StageTransform);
+        applyTransform(n, &v[0], this->tMatrix, this->tKind);
+    }
 
-    // Clip the polygon into new array
-    int outSize = clipPolygon(currentV.size(), v, out, this->lowerLeftClip, this->upperRightClip);
+    // Clip the polygon; every edge can cross each of the four
+    // clip boundaries once, so 5n vertices is a safe upper bound
+    int outSize;
+    {
+        PSTAT_TIME(StageClip);
+        out.resize(5 * n + 4);
+        outSize = clipPolygon(n, &v[0], &out[0], this->lowerLeftClip, this->upperRightClip);
+        out.resize(outSize);
+    }
+
+    PSTAT_ADD(polysSubmitted, 1);
+    PSTAT_ADD(clipVertsIn, n);
+    PSTAT_ADD(clipVertsOut, outSize);
+    PSTAT_ADD(polysRejected, outSize == 0);
+    PSTAT_ADD(polysClipped, outSize > 0 &&
+              crossesWindow(n, &v[0], this->lowerLeftClip, this->upperRightClip));
+    PSTAT_ADD(polysEmitted, outSize > 0);
 
     // Apply viewport to clipped points
-    applyViewport(outSize, out);
+    if (outSize > 0) {
+        PSTAT_TIME(StageViewport);
+        applyViewport(outSize, &out[0]);
+    }
 
-    // Draw final points
-    drawPolygon(outSize, out);
+    return outSize;
+}
+
+///
+/// screenPolyFixed - Fixed-point version of screenPoly().
+///
+/// @param polyID - the ID of the polygon (must be valid)
+/// @param out - receives the clipped vertices in screen coordinates
+///
+/// @return the number of vertices in 'out'
+///
+int Pipeline::screenPolyFixed( int polyID, vector<FixedVertex> &out )
+{
+    const vector<Vertex> &p = polyVertices(polyID);
+    int n = p.size();
+
+    out.clear();
+    if (n == 0) {
+        return 0;
+    }
+
+    // A polygon that doesn't fit in 16.16 would be drawn wrongly, or
+    // not at all; take it through the float path instead.  What comes
+    // out of that lies in the viewport, so it converts exactly.
+    if (!fixedFits(p)) {
+        vector<Vertex> f;
+        int outSize = screenPolyFloat(polyID, f);
+        out.resize(outSize);
+        for (int i = 0; i < outSize; i++) {
+            out[i].x = toFixed(f[i].x);
+            out[i].y = toFixed(f[i].y);
+        }
+        return outSize;
+    }
+
+    // addPoly() rounded the stored vertices to integers; flattened
+    // curves are not rounded, but 16 fraction bits are plenty
+    vector<FixedVertex> v(n);
+    for (int i = 0; i < n; i++) {
+        v[i].x = toFixed(p[i].x);
+        v[i].y = toFixed(p[i].y);
+    }
+
+    {
+        PSTAT_TIME(StageTransform);
+        applyMatrix(n, &v[0], this->fMatrix);
+    }
+
+    FixedVertex ll = { toFixed(this->lowerLeftClip.x),
+                       toFixed(this->lowerLeftClip.y) };
+    FixedVertex ur = { toFixed(this->upperRightClip.x),
+                       toFixed(this->upperRightClip.y) };
+    int outSize;
+    {
+        PSTAT_TIME(StageClip);
+        out.resize(5 * n + 4);
+        outSize = clipPolygon(n, &v[0], &out[0], ll, ur);
+        out.resize(outSize);
+    }
+
+    PSTAT_ADD(polysSubmitted, 1);
+    PSTAT_ADD(clipVertsIn, n);
+    PSTAT_ADD(clipVertsOut, outSize);
+    PSTAT_ADD(polysRejected, outSize == 0);
+    PSTAT_ADD(polysClipped, outSize > 0 && crossesWindow(n, &v[0], ll, ur));
+    PSTAT_ADD(polysEmitted, outSize > 0);
+
+    if (outSize > 0) {
+        PSTAT_TIME(StageViewport);
+        applyViewport(outSize, &out[0]);
+    }
+
+    return outSize;
+}
+
+///
+/// fixedFits - Check that a polygon, the clip window, the current
+///             transformation and the polygon after it all stay within
+///             +/-FIX_MAX_COORD.  The transformation is affine, so the
+///             corners of the polygon's bounding box bound its image.
+///
+/// @param p - the polygon's vertices (at least one)
+///
+/// @return true if screenPolyFixed() can handle the polygon
+///
+bool Pipeline::fixedFits( const vector<Vertex> &p ) const
+{
+    if (!fixFits(this->lowerLeftClip.x) || !fixFits(this->lowerLeftClip.y) ||
+        !fixFits(this->upperRightClip.x) || !fixFits(this->upperRightClip.y)) {
+        return false;
+    }
+
+    float xmin = p[0].x, xmax = p[0].x, ymin = p[0].y, ymax = p[0].y;
+    for (size_t i = 1; i < p.size(); i++) {
+        xmin = min(xmin, p[i].x);
+        xmax = max(xmax, p[i].x);
+        ymin = min(ymin, p[i].y);
+        ymax = max(ymax, p[i].y);
+    }
+    if (!fixFits(xmin) || !fixFits(xmax) || !fixFits(ymin) || !fixFits(ymax)) {
+        return false;
+    }
+
+    // fMatrix holds the same transformation as tMatrix, unless one of
+    // its entries overflowed
+    const glm::mat3 &m = this->tMatrix;
+    double a = m[0][0], b = m[0][1], c = m[1][0], d = m[1][1];
+    double tx = m[2][0], ty = m[2][1];
+    if (!fixFits(a) || !fixFits(b) || !fixFits(c) || !fixFits(d) ||
+        !fixFits(tx) || !fixFits(ty)) {
+        return false;
+    }
+
+    double xs[2] = { xmin, xmax }, ys[2] = { ymin, ymax };
+    for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < 2; k++) {
+            if (!fixFits(a * xs[i] + c * ys[k] + tx) ||
+                !fixFits(b * xs[i] + d * ys[k] + ty)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+///
+/// setArithmetic - Select floating-point or fixed-point arithmetic.
+///
+/// @param a - the arithmetic to use
+///
+/// @return the previous setting
+///
+Arithmetic Pipeline::setArithmetic( Arithmetic a )
+{
+    Arithmetic old = this->arith;
+    this->arith = a;
+    return old;
+}
+
+///
+/// recordGpuPoly - Save a polygon, already in screen coordinates, for
+///                 the GPU backend.  The scissor rectangle is the
+///                 current viewport, which is where the clip window
+///                 lands after the viewport transformation.
+///
+/// @param n - number of vertices
+/// @param v - array of vertices
+///
+void Pipeline::recordGpuPoly( int n, const Vertex v[] )
+{
+    if (n < 3) {
+        return;
+    }
+
+    GpuPoly p;
+    p.first = this->gpuVerts.size() / 2;
+    p.count = n;
+    p.color = getColor();
+    p.xmin = p.xmax = v[0].x;
+    p.ymin = p.ymax = v[0].y;
+
+    for (int i = 0; i < n; i++) {
+        this->gpuVerts.push_back(v[i].x);
+        this->gpuVerts.push_back(v[i].y);
+        p.xmin = min(p.xmin, v[i].x);
+        p.xmax = max(p.xmax, v[i].x);
+        p.ymin = min(p.ymin, v[i].y);
+        p.ymax = max(p.ymax, v[i].y);
+    }
+
+    // the clip window includes its upper and right edges
+    p.scissor[0] = (int) this->lowerLeftView.x;
+    p.scissor[1] = (int) this->lowerLeftView.y;
+    p.scissor[2] = (int) (this->upperRightView.x - this->lowerLeftView.x) + 1;
+    p.scissor[3] = (int) (this->upperRightView.y - this->lowerLeftView.y) + 1;
+
+    this->gpuPolys.push_back(p);
+}
+
+///
+/// clear - Clear the canvas, along with any polygons that have
+///         been recorded for the GPU backend.
+///
+void Pipeline::clear( void )
+{
+    Canvas::clear();
+    this->gpuVerts.clear();
+    this->gpuPolys.clear();
+}
+
+///
+/// setBackend - Select the fill backend used by drawPoly().
+///
+/// @param b - the backend to use
+///
+/// @return the previous backend
+///
+Backend Pipeline::setBackend( Backend b )
+{
+    Backend old = this->backend;
+    this->backend = b;
+    return old;
+}
+
+///
+/// plot - Send one pixel to the sink, or to the Canvas if we have no sink.
+///
+/// @param x - x coordinate
+/// @param y - y coordinate
+///
+void Pipeline::plot( int x, int y )
+{
+    if (this->sink == NULL) {
+        PSTAT_ADD(pixels, 1);
+        addPixel(x, y);
+        return;
+    }
+
+    if (x >= this->sinkClip.xmin && x <= this->sinkClip.xmax &&
+        y >= this->sinkClip.ymin && y <= this->sinkClip.ymax) {
+        PSTAT_ADD(pixels, 1);
+        this->sink->setPixel(x, y, getColor());
+    }
+}
+
+///
+/// plotSpan - Send the pixels x0 <= x < x1 on row y to the sink, or to
+///            the Canvas if we have no sink.
+///
+/// @param x0 - first x coordinate
+/// @param x1 - one past the last x coordinate
+/// @param y - y coordinate
+///
+void Pipeline::plotSpan( int x0, int x1, int y )
+{
+    if (this->sink == NULL) {
+        PSTAT_ADD(pixels, max(x1 - x0, 0));
+        for (int x = x0; x < x1; x++) {
+            addPixel(x, y);
+        }
+        return;
+    }
+
+    if (y < this->sinkClip.ymin || y > this->sinkClip.ymax) {
+        return;
+    }
+    x0 = max(x0, this->sinkClip.xmin);
+    x1 = min(x1, this->sinkClip.xmax + 1);
+    if (x0 < x1) {
+        PSTAT_ADD(pixels, x1 - x0);
+        this->sink->fillSpan(x0, x1, y, getColor());
+    }
+}
+
+///
+/// setSink - Send the pixels produced by drawPolygon() to a pixel
+///           sink instead of the Canvas.
+///
+/// @param s - the sink to use, or NULL to go back to the Canvas
+///
+void Pipeline::setSink( PixelSink *s )
+{
+    this->sink = s;
+
+    // no point in generating pixels the sink would throw away
+    if (s != NULL) {
+        this->sinkClip = s->bounds();
+    } else {
+        Rect all = { -(1 << 30), -(1 << 30), 1 << 30, 1 << 30 };
+        this->sinkClip = all;
+    }
+}
+
+///
+/// saveState - Remember the current transformation, clip window,
+///             viewport and color in a DrawRecord.
+///
+/// @param r - where to save the state
+///
+void Pipeline::saveState( DrawRecord &r )
+{
+    r.matrix = this->tMatrix;
+    r.kind = this->tKind;
+    r.fmatrix = this->fMatrix;
+    r.color = getColor();
+    r.llClip = this->lowerLeftClip;
+    r.urClip = this->upperRightClip;
+    r.llView = this->lowerLeftView;
+    r.urView = this->upperRightView;
+}
+
+///
+/// restoreState - Make the state saved in a DrawRecord current again.
+///
+/// @param r - the saved state
+///
+void Pipeline::restoreState( const DrawRecord &r )
+{
+    this->tMatrix = r.matrix;
+    this->tKind = r.kind;
+    this->fMatrix = r.fmatrix;
+    setColor(r.color);
+    this->lowerLeftClip = r.llClip;
+    this->upperRightClip = r.urClip;
+    this->lowerLeftView = r.llView;
+    this->upperRightView = r.urView;
+}
+
+/**
+ * Bounding rectangle of a polygon in screen coordinates.  drawPolygon()
+ * never goes outside the bounding box of its (integral) vertices.
+ */
+static Rect screenBounds( int n, const Vertex v[] )
+{
+    if (n < 1) {
+        return emptyRect();
+    }
+
+    Rect r = { (int) v[0].x, (int) v[0].y, (int) v[0].x, (int) v[0].y };
+    for (int i = 1; i < n; i++) {
+        r.xmin = min(r.xmin, (int) v[i].x);
+        r.xmax = max(r.xmax, (int) v[i].x);
+        r.ymin = min(r.ymin, (int) v[i].y);
+        r.ymax = max(r.ymax, (int) v[i].y);
+    }
+    return r;
+}
+
+// Size, in pixels, of the cells of the grid redrawDirty() uses to find
+// the drawings near a dirty rectangle
+static const int GRID_CELL = 64;
+
+/**
+ * Grid cell holding a pixel coordinate (rounding down, also below 0)
+ */
+static inline int gridCell( int c )
+{
+    return c >= 0 ? c / GRID_CELL : -((-c - 1) / GRID_CELL) - 1;
+}
+
+/**
+ * Key of grid cell (cx, cy) in the Pipeline's drawGrid
+ */
+static inline long long gridKey( int cx, int cy )
+{
+    return ((long long) cy << 32) | (unsigned int) cx;
+}
+
+///
+/// gridInsert - Add a drawing to the grid cells its bounds touch.
+///
+/// @param drawID - the drawing
+///
+void Pipeline::gridInsert( int drawID )
+{
+    const Rect &b = this->draws[drawID].bounds;
+    if (isEmpty(b)) {
+        return;
+    }
+
+    for (int cy = gridCell(b.ymin); cy <= gridCell(b.ymax); cy++) {
+        for (int cx = gridCell(b.xmin); cx <= gridCell(b.xmax); cx++) {
+            this->drawGrid[gridKey(cx, cy)].push_back(drawID);
+        }
+    }
+}
+
+///
+/// gridRemove - Remove a drawing from the grid cells its bounds touch.
+///
+/// @param drawID - the drawing
+///
+void Pipeline::gridRemove( int drawID )
+{
+    const Rect &b = this->draws[drawID].bounds;
+    if (isEmpty(b)) {
+        return;
+    }
+
+    for (int cy = gridCell(b.ymin); cy <= gridCell(b.ymax); cy++) {
+        for (int cx = gridCell(b.xmin); cx <= gridCell(b.xmax); cx++) {
+            map<long long, vector<int> >::iterator it =
+                this->drawGrid.find(gridKey(cx, cy));
+            if (it == this->drawGrid.end()) {
+                continue;
+            }
+            vector<int> &ids = it->second;
+            ids.erase(remove(ids.begin(), ids.end(), drawID), ids.end());
+            if (ids.empty()) {
+                this->drawGrid.erase(it);
+            }
+        }
+    }
+}
+
+///
+/// addDraw - Draw a polygon like drawPoly() does, and also remember
+///           the current transformation, clip window, viewport and
+///           color so that it can be redrawn incrementally later.
+///
+/// @param polyID - the ID of the polygon to be drawn.
+/// @param draw - draw it now, or only remember it
+///
+/// @return a unique integer identifier for the drawing, or -1
+///
+int Pipeline::addDraw( int polyID, bool draw )
+{
+    if( polyID < 0 || polyID >= npolys ) {
+        cerr << "error: addDraw(" << polyID << "), invalid ID" << endl;
+        return -1;
+    }
+
+    DrawRecord r;
+    r.polyID = polyID;
+    saveState(r);
+
+    vector<Vertex> out;
+    int outSize = screenPoly(polyID, out);
+    r.bounds = screenBounds(outSize, out.empty() ? NULL : &out[0]);
+    if (draw && outSize > 0) {
+        drawPolygon(outSize, &out[0]);
+    }
+
+    this->draws.push_back(r);
+    gridInsert(this->draws.size() - 1);
+    return this->draws.size() - 1;
+}
+
+///
+/// updateDraw - Replace the state remembered for a drawing with the
+///              current state, and mark the old and new screen areas
+///              of the drawing dirty.
+///
+/// @param drawID - the drawing to update
+///
+void Pipeline::updateDraw( int drawID )
+{
+    if( drawID < 0 || drawID >= (int) this->draws.size() ) {
+        cerr << "error: updateDraw(" << drawID << "), invalid ID" << endl;
+        return;
+    }
+
+    DrawRecord &r = this->draws[drawID];
+    this->dirty.push_back(r.bounds);
+    gridRemove(drawID);
+
+    saveState(r);
+    vector<Vertex> out;
+    int outSize = screenPoly(r.polyID, out);
+    r.bounds = screenBounds(outSize, out.empty() ? NULL : &out[0]);
+
+    gridInsert(drawID);
+    this->dirty.push_back(r.bounds);
+}
+
+///
+/// redrawDirty - Repaint the dirty areas of the sink.
+///
+/// @param background - the color behind all drawings
+///
+void Pipeline::redrawDirty( Color background )
+{
+    if (this->sink == NULL) {
+        cerr << "error: redrawDirty() needs a pixel sink" << endl;
+        return;
+    }
+
+    // Merge overlapping dirty rectangles until none overlap, so
+    // that no pixel is repainted twice
+    vector<Rect> rects;
+    for (int i = 0; i < (int) this->dirty.size(); i++) {
+        Rect r = this->dirty[i];
+        if (isEmpty(r)) {
+            continue;
+        }
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (int k = 0; k < (int) rects.size(); k++) {
+                if (overlaps(r, rects[k])) {
+                    r = unite(r, rects[k]);
+                    rects.erase(rects.begin() + k);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        rects.push_back(r);
+    }
+    this->dirty.clear();
+
+    // Repaint each rectangle, keeping the caller's state intact
+    DrawRecord saved;
+    saveState(saved);
+    Rect oldClip = this->sinkClip;
+
+    // Clear the rectangles, and collect the drawings in the grid
+    // cells they touch
+    vector<Rect> clips;
+    vector<int> nearby;
+    for (int i = 0; i < (int) rects.size(); i++) {
+        Rect c = intersect(rects[i], oldClip);
+        if (isEmpty(c)) {
+            continue;
+        }
+        this->sink->fillRect(c, background);
+        clips.push_back(c);
+
+        for (int cy = gridCell(c.ymin); cy <= gridCell(c.ymax); cy++) {
+            for (int cx = gridCell(c.xmin); cx <= gridCell(c.xmax); cx++) {
+                map<long long, vector<int> >::const_iterator it =
+                    this->drawGrid.find(gridKey(cx, cy));
+                if (it != this->drawGrid.end()) {
+                    nearby.insert(nearby.end(), it->second.begin(),
+                                it->second.end());
+                }
+            }
+        }
+    }
+    sort(nearby.begin(), nearby.end());
+    nearby.erase(unique(nearby.begin(), nearby.end()), nearby.end());
+
+    // The rectangles don't overlap, so drawing each drawing into all
+    // of its rectangles before going on to the next one keeps the
+    // drawing order within every rectangle
+    for (int k = 0; k < (int) nearby.size(); k++) {
+        redrawOne(this->draws[nearby[k]], clips);
+    }
+
+    this->sinkClip = oldClip;
+    restoreState(saved);
+}
+
+///
+/// clearDraws - Forget all retained drawings and dirty areas.
+///
+void Pipeline::clearDraws( void )
+{
+    this->draws.clear();
+    this->dirty.clear();
+    this->drawGrid.clear();
+}
+
+///
+/// drawBounds - Screen area covered by a drawing the last time it
+///              was drawn or updated.
+///
+/// @param drawID - the drawing
+///
+/// @return its bounds, or an empty rectangle if the ID is invalid
+///
+Rect Pipeline::drawBounds( int drawID ) const
+{
+    if( drawID < 0 || drawID >= (int) this->draws.size() ) {
+        cerr << "error: drawBounds(" << drawID << "), invalid ID" << endl;
+        return emptyRect();
+    }
+
+    return this->draws[drawID].bounds;
+}
+
+///
+/// resetStats - Set all counters and stage times to zero.
+///
+void Pipeline::resetStats( void )
+{
+    memset(&this->pstats, 0, sizeof(this->pstats));
 }
 
 ///
@@ -126,6 +929,8 @@ void Pipeline::clearTransform( void )
 {
     // set matrix to identity
     this->tMatrix = glm::mat3(1.0f);
+    this->tKind = XIdentity;
+    this->fMatrix = fixIdentity();
 }
 
 ///
@@ -143,6 +948,9 @@ void Pipeline::translate( float tx, float ty )
     op[2] = glm::vec3(tx, ty, 1.0);
     // Apply to existing transformation matrix
     this->tMatrix = op * this->tMatrix;
+    this->tKind = composeKind(XTranslate, this->tKind);
+    this->fMatrix = fixCompose(fixTranslate(toFixed(tx), toFixed(ty)),
+                               this->fMatrix);
 }
 
 ///
@@ -161,6 +969,8 @@ void Pipeline::rotate( float degrees )
     op[1] = glm::vec3(-1 * sin(degrees * PI / 180.0 ), cos(degrees * PI / 180.0 ), 0.0);
     // Apply to existing transformation matrix
     this->tMatrix = op * this->tMatrix;
+    this->tKind = composeKind(XRigid, this->tKind);
+    this->fMatrix = fixCompose(fixRotate(toFixed(degrees)), this->fMatrix);
 }
 
 ///
@@ -179,6 +989,9 @@ void Pipeline::scale( float sx, float sy )
     op[1] = glm::vec3(0.0, sy, 0.0);
     // Apply to existing transformation matrix
     this->tMatrix = op * this->tMatrix;
+    this->tKind = composeKind(XScaleTranslate, this->tKind);
+    this->fMatrix = fixCompose(fixScale(toFixed(sx), toFixed(sy)),
+                               this->fMatrix);
 }
 
 ///
@@ -240,14 +1053,32 @@ void Pipeline::applyViewport(int n, Vertex v[]) {
     float ty = ((this->upperRightClip.y * this->lowerLeftView.y) - (this->lowerLeftClip.y * this->upperRightView.y)) 
         / (this->upperRightClip.y - this->lowerLeftClip.y);
 
-    glm::mat3 viewTransform = glm::mat3(1.0f);
-    viewTransform[0] = glm::vec3( sx, 0.0, 0.0 );
-    viewTransform[1] = glm::vec3( 0.0, sy, 0.0 );
-    viewTransform[2] = glm::vec3( tx, ty, 1.0 );
-
-    applyMatrix(n, v, viewTransform);
+    // always a scale and a translation
+    transformPoints(scale2(sx, sy, tx, ty), n, v);
 }
 
+/**
+ * Fixed-point applyViewport: maps the clip window onto the viewport
+ * with one exact multiply and divide per coordinate, then rounds
+ */
+void Pipeline::applyViewport(int n, FixedVertex v[]) {
+    Fixed llcx = toFixed(this->lowerLeftClip.x);
+    Fixed llcy = toFixed(this->lowerLeftClip.y);
+    Fixed clipW = toFixed(this->upperRightClip.x) - llcx;
+    Fixed clipH = toFixed(this->upperRightClip.y) - llcy;
+    Fixed llvx = toFixed(this->lowerLeftView.x);
+    Fixed llvy = toFixed(this->lowerLeftView.y);
+    Fixed viewW = toFixed(this->upperRightView.x) - llvx;
+    Fixed viewH = toFixed(this->upperRightView.y) - llvy;
+
+    for (int i = 0; i < n; i++) {
+        // a degenerate clip window collapses onto the viewport corner
+        Fixed x = clipW == 0 ? 0 : fixMulDiv(v[i].x - llcx, viewW, clipW);
+        Fixed y = clipH == 0 ? 0 : fixMulDiv(v[i].y - llcy, viewH, clipH);
+        v[i].x = fixRoundPixel(llvx + x);
+        v[i].y = fixRoundPixel(llvy + y);
+    }
+}
 
 /**
  * applyMatrix takes in number of verts and the vertices and a matrix to apply
@@ -255,13 +1086,8 @@ void Pipeline::applyViewport(int n, Vertex v[]) {
  * each vertice and manipulates it in place
  */
 void applyMatrix(int n, Vertex v[], glm::mat3 matrix) {
-    for (int i = 0; i < n; i++) {
-        glm::vec3 point = glm::vec3(v[i].x, v[i].y, 1.0);
-        glm::vec3 result = matrix * point;
-        v[i].x = result[0];
-        v[i].y = result[1];
-        v[i] = round(v[i]);
-    }
+    // use the cheapest kernel that handles this matrix
+    applyTransform(n, v, matrix, classify(matrix));
 }
 
 
@@ -287,25 +1113,25 @@ struct EdgeBucket {
  * This contains information about slopes and current
  * states
  */
-EdgeBucket generateEdgeBucket(Vertex a, Vertex b) {
+EdgeBucket generateEdgeBucket(int ax, int ay, int bx, int by) {
     
     EdgeBucket current;
-    current.dX = abs(b.x - a.x);
-    current.dY = abs(b.y - a.y);
-    current.yMax = max(b.y, a.y);
-    current.yMin = min(b.y, a.y);
+    current.dX = abs(bx - ax);
+    current.dY = abs(by - ay);
+    current.yMax = max(by, ay);
+    current.yMin = min(by, ay);
 
     // Set the sign of the slope
-    if (current.yMin == b.y) {
-        current.x = b.x;
-        if (b.x < a.x) {
+    if (current.yMin == by) {
+        current.x = bx;
+        if (bx < ax) {
             current.sign = 1;
         } else {
             current.sign = -1;
         }
     } else {
-        current.x = a.x;
-        if (b.x < a.x) {
+        current.x = ax;
+        if (bx < ax) {
             current.sign = -1;
         } else {
             current.sign = 1;
@@ -316,29 +1142,38 @@ EdgeBucket generateEdgeBucket(Vertex a, Vertex b) {
     return current;
 }
 
+/**
+ * Integer pixel coordinates of a (rounded) vertex
+ */
+static inline int pixelX(const Vertex &v) { return (int) v.x; }
+static inline int pixelY(const Vertex &v) { return (int) v.y; }
+static inline int pixelX(const FixedVertex &v) { return v.x >> FIX_SHIFT; }
+static inline int pixelY(const FixedVertex &v) { return v.y >> FIX_SHIFT; }
+
 /**
  * Init the entire edgetable based on the vertexes in v
  */
-vector<EdgeBucket> initEdgeTable(int n, const Vertex v[]) {
+template <class V>
+vector<EdgeBucket> initEdgeTable(int n, const V v[]) {
     // The edge table to populate
     vector<EdgeBucket> edgeTable;
-    Vertex a = v[n - 1];
-    Vertex b = v[0];
+    int ax = pixelX(v[n - 1]), ay = pixelY(v[n - 1]);
+    int bx = pixelX(v[0]), by = pixelY(v[0]);
 
     // If the first and last points are not horizontal
-    if (a.y != b.y) {
-        edgeTable.push_back(generateEdgeBucket(a, b));
+    if (ay != by) {
+        edgeTable.push_back(generateEdgeBucket(ax, ay, bx, by));
     }
 
     // Generate the edgebuckets for each pair of a and b
-    int id = 1;
     for (int i = 1; i < n; i++) {
-        a = v[i - 1];
-        b = v[i];
-        if (a.y != b.y) {
-            edgeTable.push_back(generateEdgeBucket(a, b));
+        ax = bx;
+        ay = by;
+        bx = pixelX(v[i]);
+        by = pixelY(v[i]);
+        if (ay != by) {
+            edgeTable.push_back(generateEdgeBucket(ax, ay, bx, by));
         }
-        id++;
     }
 
     return edgeTable;
@@ -377,18 +1212,147 @@ bool sortByX(EdgeBucket a, EdgeBucket b) {
 void Pipeline::drawPolygon( int n, const Vertex v[] )
 {
     // Generate the edge table
-    vector<EdgeBucket> edgeTable = initEdgeTable(n, v);
-    sort(edgeTable.begin(), edgeTable.end(), sortByMinY);
+    vector<EdgeBucket> edgeTable;
+    {
+        PSTAT_TIME(StageEdges);
+        edgeTable = initEdgeTable(n, v);
+        sort(edgeTable.begin(), edgeTable.end(), sortByMinY);
+    }
+    PSTAT_ADD(polysFilled, 1);
+    PSTAT_ADD(edges, edgeTable.size());
 
     // Keep plotting each pixel. Good for debugging and completion
+    // (the vertices have already been rounded to integers)
+    for( int i = 0; i < n; ++i ) {
+        plot( (int) v[i].x, (int) v[i].y );
+    }
+
+    scanEdges(edgeTable);
+}
+
+///
+/// redrawOne - Rasterize a retained drawing again into each of the
+///             given rectangles it overlaps.  The polygon is
+///             transformed, clipped and its edge table built only
+///             once; each rectangle scans a copy of the edge table.
+///
+/// @param r - the drawing
+/// @param rects - non-overlapping rectangles of the sink
+///
+void Pipeline::redrawOne( const DrawRecord &r, const vector<Rect> &rects )
+{
+    vector<Rect> hit;
+    for (int i = 0; i < (int) rects.size(); i++) {
+        if (overlaps(r.bounds, rects[i])) {
+            hit.push_back(rects[i]);
+        }
+    }
+    if (hit.empty()) {
+        return;
+    }
+
+    restoreState(r);
+    vector<Vertex> out;
+    int n = screenPoly(r.polyID, out);
+    if (n <= 0) {
+        return;
+    }
+
+    vector<EdgeBucket> sorted;
+    {
+        PSTAT_TIME(StageEdges);
+        sorted = initEdgeTable(n, &out[0]);
+        sort(sorted.begin(), sorted.end(), sortByMinY);
+    }
+    PSTAT_ADD(polysFilled, 1);
+    PSTAT_ADD(edges, sorted.size());
+
+    for (int i = 0; i < (int) hit.size(); i++) {
+        this->sinkClip = hit[i];
+        for( int k = 0; k < n; ++k ) {
+            plot( (int) out[k].x, (int) out[k].y );
+        }
+        vector<EdgeBucket> edgeTable = sorted;
+        scanEdges(edgeTable);
+    }
+}
+
+///
+/// drawPolygon - Fixed-point version; the vertices must lie on
+///               integer coordinates.  Edge setup uses only integers.
+///
+/// @param n - number of vertices
+/// @param v - array of vertices
+///
+void Pipeline::drawPolygon( int n, const FixedVertex v[] )
+{
+    vector<EdgeBucket> edgeTable;
+    {
+        PSTAT_TIME(StageEdges);
+        edgeTable = initEdgeTable(n, v);
+        sort(edgeTable.begin(), edgeTable.end(), sortByMinY);
+    }
+    PSTAT_ADD(polysFilled, 1);
+    PSTAT_ADD(edges, edgeTable.size());
+
     for( int i = 0; i < n; ++i ) {
-        addPixel( v[i] );
+        plot( pixelX(v[i]), pixelY(v[i]) );
     }
 
+    scanEdges(edgeTable);
+}
+
+///
+/// scanEdges - Scan-convert a polygon, given its edge table sorted by
+///             decreasing minimum y.
+///
+/// @param edgeTable - the edge table (emptied as it is used)
+///
+void Pipeline::scanEdges( vector<EdgeBucket> &edgeTable )
+{
+    PSTAT_TIME(StageScan);
+
+    // Nothing happens below the lowest edge, so start there
     int currentY = 0; 
+    if (!edgeTable.empty() && edgeTable.back().yMin > 0) {
+        currentY = edgeTable.back().yMin;
+    }
+
+    // The Canvas pixel stream only covers the window, so it stops at
+    // row 900 as it always has; a sink can be much taller, and only
+    // keeps the rows inside its clip rectangle
+    int lastY = 900;
+    if (this->sink != NULL) {
+        lastY = this->sinkClip.ymax + 1;
+    }
+
     vector<EdgeBucket> activeList;
+
+    // Rows above the sink's clip rectangle would be thrown away, so
+    // start on its first row:  activate every edge that begins before
+    // it and is still live there, with its x and sum moved, in closed
+    // form, to where the row-by-row loop would have left them
+    if (this->sink != NULL && this->sinkClip.ymin > currentY) {
+        int firstY = this->sinkClip.ymin;
+        while (!edgeTable.empty() && edgeTable.back().yMin < firstY) {
+            EdgeBucket e = edgeTable.back();
+            edgeTable.pop_back();
+            if (e.yMax <= firstY) {
+                continue;
+            }
+            long long rows = firstY - max(e.yMin, currentY);
+            long long sum = e.sum + rows * e.dX;
+            long long steps = sum / e.dY;
+            e.x += (int) (e.sign * steps);
+            e.sum = (int) (sum - steps * e.dY);
+            activeList.push_back(e);
+        }
+        currentY = firstY;
+    }
+
     // Main loop, check if we still have edges
-    while ((!edgeTable.empty() || !activeList.empty()) && currentY < 900) {
+    while ((!edgeTable.empty() || !activeList.empty()) && currentY < lastY) {
+        PSTAT_ADD(scanlines, 1);
         vector<EdgeBucket> tempList;
         
         // Remove edges that are now out of scope of the active list
@@ -426,9 +1390,7 @@ void Pipeline::drawPolygon( int n, const Vertex v[] )
             // If we are now entering the outside, draw a line from the 
             // last edge to our current point
             if (!isInside) {
-                for (int tempX = lastX; tempX < activeList[o].x; tempX++) {
-                    addPixel(tempX, currentY);
-                }
+                plotSpan(lastX, activeList[o].x, currentY);
             }
             lastX = activeList[o].x;
 
@@ -446,6 +1408,534 @@ void Pipeline::drawPolygon( int n, const Vertex v[] )
 
 
 
+/*********************************************
+ * Whole-scene rendering
+ * 
+ ********************************************/
+
+// An edge in the scene-wide edge table, tagged with the drawing it
+// belongs to; drawings later in the list are in front
+struct SceneEdge {
+    EdgeBucket e;
+    int draw;
+};
+
+// A vertex pixel of a drawing (drawPolygon() plots every vertex)
+struct ScenePixel {
+    int x, y;
+    int draw;
+};
+
+// One end of the single-pixel run a vertex covers on the current row
+struct SpanEvent {
+    int x;
+    int draw;
+    bool start;
+};
+
+/*
+ * Descending minimum y, so the next edge to start is at the back
+ */
+static bool sceneByMinY(const SceneEdge &a, const SceneEdge &b) {
+    return a.e.yMin > b.e.yMin;
+}
+
+static bool sceneByX(const SceneEdge &a, const SceneEdge &b) {
+    return a.e.x < b.e.x;
+}
+
+static bool pixelByY(const ScenePixel &a, const ScenePixel &b) {
+    return a.y < b.y;
+}
+
+static bool eventByX(const SpanEvent &a, const SpanEvent &b) {
+    return a.x < b.x;
+}
+
+/*
+ * Re-sort the active edges by x.  They move little from one row to
+ * the next, so insertion sort is close to linear here.
+ */
+static void resortActive(vector<SceneEdge> &list) {
+    for (size_t i = 1; i < list.size(); i++) {
+        if (!sceneByX(list[i], list[i - 1])) {
+            continue;
+        }
+        SceneEdge e = list[i];
+        size_t j = i;
+        for (; j > 0 && sceneByX(e, list[j - 1]); j--) {
+            list[j] = list[j - 1];
+        }
+        list[j] = e;
+    }
+}
+
+///
+/// renderScene - Draw all retained drawings in a single scan-line sweep.
+///
+void Pipeline::renderScene( void )
+{
+    DrawRecord saved;
+    saveState(saved);
+
+    // Build one edge table for the whole scene
+    int ndraws = this->draws.size();
+    vector<SceneEdge> edgeTable;
+    vector<ScenePixel> corners;
+    vector<Color> colors(ndraws);
+    vector<Vertex> out;
+    for (int d = 0; d < ndraws; d++) {
+        const DrawRecord &r = this->draws[d];
+        restoreState(r);
+        colors[d] = r.color;
+
+        // screenPoly() times its own stages
+        int outSize = screenPoly(r.polyID, out);
+        if (outSize <= 0) {
+            continue;
+        }
+
+        PSTAT_TIME(StageEdges);
+        vector<EdgeBucket> edges = initEdgeTable(outSize, &out[0]);
+        for (int k = 0; k < (int) edges.size(); k++) {
+            SceneEdge se = { edges[k], d };
+            edgeTable.push_back(se);
+        }
+        for (int k = 0; k < outSize; k++) {
+            ScenePixel p = { pixelX(out[k]), pixelY(out[k]), d };
+            corners.push_back(p);
+        }
+        PSTAT_ADD(polysFilled, 1);
+        PSTAT_ADD(edges, edges.size());
+    }
+    {
+        PSTAT_TIME(StageEdges);
+        sort(edgeTable.begin(), edgeTable.end(), sceneByMinY);
+        sort(corners.begin(), corners.end(), pixelByY);
+    }
+
+    PSTAT_TIME(StageScan);
+
+    // Same row limits as scanEdges()
+    int lastY = 900;
+    if (this->sink != NULL) {
+        lastY = this->sinkClip.ymax + 1;
+    }
+
+    vector<SceneEdge> activeList;
+    vector<SpanEvent> events;
+    size_t c = 0;
+
+    // For each drawing, whether the walk along the row is inside it,
+    // and how many of its runs (its inside, or a vertex pixel) cover
+    // the current x.  The drawings with runs open are kept in a
+    // max-heap of their indices, i.e., by depth; closed ones are only
+    // dropped when they reach the top.
+    vector<char> inside(ndraws, 0);
+    vector<int> covering(ndraws, 0);
+    vector<int> depths;
+
+    // First row with anything on it
+    int currentY = INT_MAX;
+    if (!edgeTable.empty()) {
+        currentY = max(edgeTable.back().e.yMin, 0);
+    }
+    if (!corners.empty()) {
+        currentY = min(currentY, corners[0].y);
+    }
+
+    while (currentY != INT_MAX) {
+        bool scanning = currentY >= 0 && currentY < lastY &&
+                        (!edgeTable.empty() || !activeList.empty());
+
+        if (scanning) {
+            PSTAT_ADD(scanlines, 1);
+
+            // Retire finished edges and start new ones, exactly as
+            // scanEdges() does for a single polygon
+            size_t keep = 0;
+            for (size_t o = 0; o < activeList.size(); o++) {
+                if (currentY < activeList[o].e.yMax) {
+                    activeList[keep++] = activeList[o];
+                }
+            }
+            activeList.resize(keep);
+
+            while (!edgeTable.empty() &&
+                   currentY >= edgeTable.back().e.yMin) {
+                activeList.push_back(edgeTable.back());
+                edgeTable.pop_back();
+            }
+
+            resortActive(activeList);
+        }
+
+        // Vertex pixels on this row
+        events.clear();
+        for (; c < corners.size() && corners[c].y == currentY; c++) {
+            SpanEvent s = { corners[c].x, corners[c].draw, true };
+            SpanEvent t = { corners[c].x + 1, corners[c].draw, false };
+            events.push_back(s);
+            events.push_back(t);
+        }
+        sort(events.begin(), events.end(), eventByX);
+
+        // Walk the edge crossings and vertex pixels left to right.
+        // Crossing an edge of a drawing toggles whether we are inside
+        // it, which pairs up its crossings just as scanEdges() does.
+        // Each run between stops is plotted once, in the color of the
+        // front-most drawing covering it.
+        size_t a = 0, k = 0;
+        size_t na = scanning ? activeList.size() : 0;
+        int runDraw = -1;
+        int runX = 0;
+        depths.clear();
+
+        while (a < na || k < events.size()) {
+            int x = INT_MAX;
+            if (a < na) {
+                x = activeList[a].e.x;
+            }
+            if (k < events.size()) {
+                x = min(x, events[k].x);
+            }
+
+            for (; a < na && activeList[a].e.x == x; a++) {
+                int d = activeList[a].draw;
+                inside[d] = !inside[d];
+                if (!inside[d]) {
+                    covering[d]--;
+                } else if (covering[d]++ == 0) {
+                    depths.push_back(d);
+                    push_heap(depths.begin(), depths.end());
+                }
+            }
+            for (; k < events.size() && events[k].x == x; k++) {
+                int d = events[k].draw;
+                if (!events[k].start) {
+                    covering[d]--;
+                } else if (covering[d]++ == 0) {
+                    depths.push_back(d);
+                    push_heap(depths.begin(), depths.end());
+                }
+            }
+            while (!depths.empty() && covering[depths.front()] <= 0) {
+                pop_heap(depths.begin(), depths.end());
+                depths.pop_back();
+            }
+
+            int front = depths.empty() ? -1 : depths.front();
+            if (front != runDraw) {
+                if (runDraw >= 0) {
+                    setColor(colors[runDraw]);
+                    plotSpan(runX, x, currentY);
+                }
+                runDraw = front;
+                runX = x;
+            }
+        }
+
+        if (scanning) {
+            // Step the edges to the next row
+            for (size_t o = 0; o < activeList.size(); o++) {
+                EdgeBucket &e = activeList[o].e;
+                inside[activeList[o].draw] = 0;
+                covering[activeList[o].draw] = 0;
+                e.sum += e.dX;
+                while (e.sum >= e.dY) {
+                    e.x += e.sign;
+                    e.sum -= e.dY;
+                }
+            }
+        }
+
+        // Next row with anything on it
+        int nextY = INT_MAX;
+        if (c < corners.size()) {
+            nextY = corners[c].y;
+        }
+        if (scanning) {
+            nextY = min(nextY, currentY + 1);
+        } else if (!edgeTable.empty() && currentY < lastY) {
+            nextY = min(nextY, max(edgeTable.back().e.yMin, 0));
+        }
+        currentY = nextY;
+    }
+
+    restoreState(saved);
+}
+
+
+
+
+/*********************************************
+ * Line drawing
+ * 
+ ********************************************/
+
+///
+/// setLineMode - Select aliased or antialiased lines.
+///
+/// @param m - the mode to use
+///
+/// @return the previous mode
+///
+LineMode Pipeline::setLineMode( LineMode m )
+{
+    LineMode old = this->lineMode;
+    this->lineMode = m;
+    return old;
+}
+
+///
+/// drawLines - Draw a batch of line segments in screen coordinates.
+///
+/// @param n - number of segments
+/// @param v - array of 2n endpoints
+///
+void Pipeline::drawLines( int n, const Vertex v[] )
+{
+    for (int i = 0; i < n; i++) {
+        const Vertex &a = v[2 * i];
+        const Vertex &b = v[2 * i + 1];
+        if (this->lineMode == LineSmooth) {
+            smoothLine(a.x, a.y, b.x, b.y);
+        } else {
+            rasterLine((int) floor(a.x + 0.5), (int) floor(a.y + 0.5),
+                       (int) floor(b.x + 0.5), (int) floor(b.y + 0.5));
+        }
+    }
+}
+
+///
+/// drawLoop - Draw the closed outline of a polygon in screen coordinates.
+///
+/// @param n - number of vertices
+/// @param v - array of vertices
+///
+void Pipeline::drawLoop( int n, const Vertex v[] )
+{
+    if (n < 1) {
+        return;
+    }
+
+    // pair each vertex with the next one, and the last with the first
+    vector<Vertex> seg(2 * n);
+    for (int i = 0; i < n; i++) {
+        seg[2 * i] = v[i];
+        seg[2 * i + 1] = v[(i + 1) % n];
+    }
+    drawLines(n, &seg[0]);
+}
+
+///
+/// drawPolyEdges - Draw the outline of a stored polygon through the
+///                 current transformation, clip window and viewport.
+///
+/// @param polyID - the ID of the polygon to be drawn.
+///
+void Pipeline::drawPolyEdges( int polyID )
+{
+    if( polyID < 0 || polyID >= npolys ) {
+        cerr << "error: drawPolyEdges(" << polyID << "), invalid ID" << endl;
+        return;
+    }
+
+    vector<Vertex> out;
+    int outSize = screenPoly(polyID, out);
+    if (outSize > 0) {
+        drawLoop(outSize, &out[0]);
+    }
+}
+
+///
+/// rasterLine - Draw an aliased line between two pixels.
+///
+/// The pixels are the ones Bresenham's algorithm picks (the one
+/// nearest the line in each column or row), but they are found a run
+/// at a time:  a line that is closer to horizontal covers a horizontal
+/// run of pixels on each row, and the run-slice stepping below finds
+/// where each run ends with one add and compare per row, so each run
+/// goes out as a single span.
+///
+/// @param x0,y0 - first endpoint
+/// @param x1,y1 - second endpoint
+///
+void Pipeline::rasterLine( int x0, int y0, int x1, int y1 )
+{
+    // always walk upward
+    if (y1 < y0) {
+        swap(x0, x1);
+        swap(y0, y1);
+    }
+
+    int dx = abs(x1 - x0);
+    int dy = y1 - y0;
+    int sx = x1 < x0 ? -1 : 1;
+
+    // skip lines entirely outside the sink
+    if (this->sink != NULL &&
+        (y1 < this->sinkClip.ymin || y0 > this->sinkClip.ymax ||
+         max(x0, x1) < this->sinkClip.xmin ||
+         min(x0, x1) > this->sinkClip.xmax)) {
+        return;
+    }
+
+    if (dy == 0) {
+        plotSpan(min(x0, x1), max(x0, x1) + 1, y0);
+        return;
+    }
+
+    long long den = 2LL * dy;
+
+    if (dx <= dy) {
+        // one pixel per row; on row k the pixel is
+        // floor((2k dx + dy) / 2dy) columns from x0
+        long long r = dy;
+        int q = 0;
+        for (int k = 0; k <= dy; k++) {
+            plot(x0 + sx * q, y0 + k);
+            r += 2LL * dx;
+            if (r >= den) {
+                r -= den;
+                q++;
+            }
+        }
+        return;
+    }
+
+    // one run per row; the run on row k ends
+    // floor((dx (2k + 1) - 1) / 2dy) columns from x0
+    long long whole = (2LL * dx) / den;
+    long long rem = (2LL * dx) % den;
+    long long q = (dx - 1) / den;
+    long long r = (dx - 1) % den;
+    int start = 0;
+
+    for (int k = 0; k <= dy; k++) {
+        int end = (k == dy) ? dx : (int) q;
+        if (sx > 0) {
+            plotSpan(x0 + start, x0 + end + 1, y0 + k);
+        } else {
+            plotSpan(x0 - end, x0 - start + 1, y0 + k);
+        }
+        start = end + 1;
+
+        q += whole;
+        r += rem;
+        if (r >= den) {
+            r -= den;
+            q++;
+        }
+    }
+}
+
+///
+/// blend - Blend the current color into one pixel of the sink; without
+///         a sink, pixels that are at least half covered are added to
+///         the Canvas.
+///
+/// @param x - x coordinate
+/// @param y - y coordinate
+/// @param a - coverage, 0 to 1
+///
+void Pipeline::blend( int x, int y, float a )
+{
+    if (a <= 0.0f) {
+        return;
+    }
+
+    if (this->sink == NULL) {
+        if (a >= 0.5f) {
+            PSTAT_ADD(pixels, 1);
+            addPixel(x, y);
+        }
+        return;
+    }
+
+    if (x >= this->sinkClip.xmin && x <= this->sinkClip.xmax &&
+        y >= this->sinkClip.ymin && y <= this->sinkClip.ymax) {
+        PSTAT_ADD(pixels, 1);
+        this->sink->blendPixel(x, y, getColor(), a);
+    }
+}
+
+/**
+ * Integer and fractional parts for Wu's algorithm
+ */
+static inline float fpart(float v) { return v - floorf(v); }
+static inline float rfpart(float v) { return 1.0f - fpart(v); }
+
+///
+/// smoothLine - Draw an antialiased line with Xiaolin Wu's algorithm.
+///              Each column (or row, for steep lines) gets the two
+///              pixels nearest the line, weighted by their distance
+///              from it; the endpoints are weighted by how much of
+///              their pixel the line covers.
+///
+/// @param x0,y0 - first endpoint
+/// @param x1,y1 - second endpoint
+///
+void Pipeline::smoothLine( float x0, float y0, float x1, float y1 )
+{
+    bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+    if (steep) {
+        swap(x0, y0);
+        swap(x1, y1);
+    }
+    if (x0 > x1) {
+        swap(x0, x1);
+        swap(y0, y1);
+    }
+
+    float dx = x1 - x0;
+    float gradient = (dx == 0.0f) ? 1.0f : (y1 - y0) / dx;
+
+    // first endpoint
+    float xend = floorf(x0 + 0.5f);
+    float yend = y0 + gradient * (xend - x0);
+    float xgap = rfpart(x0 + 0.5f);
+    int xpx1 = (int) xend;
+    int ypx1 = (int) floorf(yend);
+    if (steep) {
+        blend(ypx1, xpx1, rfpart(yend) * xgap);
+        blend(ypx1 + 1, xpx1, fpart(yend) * xgap);
+    } else {
+        blend(xpx1, ypx1, rfpart(yend) * xgap);
+        blend(xpx1, ypx1 + 1, fpart(yend) * xgap);
+    }
+    float intery = yend + gradient;
+
+    // second endpoint
+    xend = floorf(x1 + 0.5f);
+    yend = y1 + gradient * (xend - x1);
+    xgap = fpart(x1 + 0.5f);
+    int xpx2 = (int) xend;
+    int ypx2 = (int) floorf(yend);
+    if (steep) {
+        blend(ypx2, xpx2, rfpart(yend) * xgap);
+        blend(ypx2 + 1, xpx2, fpart(yend) * xgap);
+    } else {
+        blend(xpx2, ypx2, rfpart(yend) * xgap);
+        blend(xpx2, ypx2 + 1, fpart(yend) * xgap);
+    }
+
+    // everything in between
+    for (int x = xpx1 + 1; x < xpx2; x++) {
+        int y = (int) floorf(intery);
+        if (steep) {
+            blend(y, x, rfpart(intery));
+            blend(y + 1, x, fpart(intery));
+        } else {
+            blend(x, y, rfpart(intery));
+            blend(x, y + 1, fpart(intery));
+        }
+        intery += gradient;
+    }
+}
+
+
+
 
 /*********************************************
  * clipPolygon from Clipper.cpp Lab3
@@ -13,8 +13,15 @@
 #define PIPELINE_H_
 
 #include "Canvas.h"
+#include "PixelSink.h"
+#include "Fixed.h"
+#include "Transform.h"
+#include "PipelineStats.h"
+#include "Path.h"
 #include "Types.h"
 
+#include <map>
+
 #include <glm/vec3.hpp>
 #include <glm/mat3x3.hpp>
 #include <glm/geometric.hpp>
@@ -28,11 +35,97 @@
 
 using namespace std;
 
+// Scan-conversion edge state (defined in Pipeline.cpp)
+struct EdgeBucket;
+
 // A struct that represents a polygon aka the vertices 
 struct Polygon {
     vector<Vertex> vertices;
 };
 
+//
+// A polygon added with addPath():  the contour, and its flattened
+// vertices for each scale at which it has been drawn
+//
+struct CurvedPoly {
+    Path path;
+    map<int, vector<Vertex> > flat;   // keyed by scale bucket
+};
+
+//
+// Polygon fill backends
+//
+// FillCPU scan-converts each polygon in drawPolygon() and hands the
+// resulting pixels to the Canvas.  FillGPU skips scan conversion and
+// instead records each transformed polygon so that it can be filled
+// by the GPU (see StencilFill.h).
+//
+typedef
+    enum backends_e {
+        FillCPU = 0, FillGPU
+        // Sentinel gives us the number of backends
+        , N_BACKENDS
+    } Backend;
+
+//
+// Arithmetic used between addPoly() and scan conversion
+//
+// ArithFloat is the original floating-point path.  ArithFixed does the
+// transformation, clipping, viewport mapping and edge setup in 16.16
+// fixed point (see Fixed.h), which gives bit-identical results on
+// every platform.
+//
+typedef
+    enum arith_e {
+        ArithFloat = 0, ArithFixed
+        // Sentinel gives us the number of modes
+        , N_ARITH
+    } Arithmetic;
+
+//
+// Line rasterization
+//
+// LineAliased draws one-pixel-wide lines with Bresenham's rule, as
+// runs of pixels.  LineSmooth draws Xiaolin Wu antialiased lines,
+// blending along their edges; without a sink (or with one that cannot
+// blend) pixels that are at least half covered are set.
+//
+typedef
+    enum linemodes_e {
+        LineAliased = 0, LineSmooth
+        // Sentinel gives us the number of modes
+        , N_LINEMODES
+    } LineMode;
+
+//
+// A polygon recorded for the GPU backend.  Its vertices are in screen
+// coordinates and occupy 'count' consecutive (x,y) pairs, starting with
+// pair number 'first', in the Pipeline's GPU vertex list.
+//
+struct GpuPoly {
+    int first;
+    int count;
+    Color color;
+    float xmin, ymin, xmax, ymax;   // screen-space bounding box
+    int scissor[4];                 // x, y, width, height
+};
+
+//
+// A retained drawing of a polygon, used for incremental redraw:  the
+// pipeline state drawPoly() would have used, and the screen area the
+// polygon covered the last time it was drawn.
+//
+struct DrawRecord {
+    int polyID;
+    glm::mat3 matrix;
+    XformKind kind;
+    FixedMatrix fmatrix;
+    Color color;
+    Vertex llClip, urClip;
+    Vertex llView, urView;
+    Rect bounds;
+};
+
 ///
 /// Simple wrapper class for midterm assignment
 ///
@@ -50,8 +143,29 @@ private:
 
     vector<Polygon> polys; // Polygon repository
 
+    // for each polygon, its index in 'curved', or -1 if it has fixed
+    // vertices
+    vector<int> polyCurve;
+    vector<CurvedPoly> curved;
+
+    // largest distance, in pixels, between a flattened curve and the
+    // true curve
+    float curveTol;
+
     glm::mat3 tMatrix; // Transformation Matrix
 
+    // the simplest kind of transformation that describes tMatrix
+    XformKind tKind;
+
+    // the same transformation, built up in fixed point
+    FixedMatrix fMatrix;
+
+    // arithmetic used by drawPoly()
+    Arithmetic arith;
+
+    // how drawLines() draws
+    LineMode lineMode;
+
     // Vertices on outer edge of clip rectangle
     Vertex lowerLeftClip;
     Vertex upperRightClip;
@@ -59,6 +173,78 @@ private:
     Vertex lowerLeftView;
     Vertex upperRightView;
 
+    // which fill backend drawPoly() uses
+    Backend backend;
+
+    // polygons recorded for the GPU backend
+    vector<float> gpuVerts;
+    vector<GpuPoly> gpuPolys;
+
+    // where drawPolygon() sends its pixels (NULL means the Canvas)
+    PixelSink *sink;
+
+    // pixels outside this rectangle are not sent to the sink
+    Rect sinkClip;
+
+    // retained drawings, and the screen areas needing a redraw
+    vector<DrawRecord> draws;
+    vector<Rect> dirty;
+
+    // the retained drawings whose bounds touch each cell of a coarse
+    // grid over the screen, keyed by gridKey(); lets redrawDirty()
+    // visit only the drawings near a dirty rectangle
+    map<long long, vector<int> > drawGrid;
+
+    // counters and stage times (see PipelineStats.h)
+    PipelineStats pstats;
+
+    // send one pixel, or a run of pixels x0 <= x < x1, to the
+    // sink (if we have one) or to the Canvas
+    void plot( int x, int y );
+    void plotSpan( int x0, int x1, int y );
+
+    // save the drawing state in, or restore it from, a DrawRecord
+    void saveState( DrawRecord &r );
+    void restoreState( const DrawRecord &r );
+
+    // the vertices of a stored polygon, flattened for the current
+    // transformation and viewport if it is curved
+    const vector<Vertex> &polyVertices( int polyID );
+
+    // how much the current transformation and viewport magnify
+    float screenScale( void ) const;
+
+    // transform, clip and map a stored polygon to the screen
+    int screenPoly( int polyID, vector<Vertex> &out );
+    int screenPolyFloat( int polyID, vector<Vertex> &out );
+    int screenPolyFixed( int polyID, vector<FixedVertex> &out );
+
+    // can a polygon go through screenPolyFixed() without leaving the
+    // range of a Fixed?
+    bool fixedFits( const vector<Vertex> &p ) const;
+
+    // scan-convert a polygon from its (sorted) edge table
+    void scanEdges( vector<EdgeBucket> &edgeTable );
+
+    // add a drawing to, or remove it from, the cells of drawGrid
+    // its bounds touch
+    void gridInsert( int drawID );
+    void gridRemove( int drawID );
+
+    // rasterize a retained drawing again, once for each of the
+    // (non-overlapping) rectangles given that it overlaps
+    void redrawOne( const DrawRecord &r, const vector<Rect> &rects );
+
+    // rasterize one line segment, aliased or antialiased
+    void rasterLine( int x0, int y0, int x1, int y1 );
+    void smoothLine( float x0, float y0, float x1, float y1 );
+
+    // blend the current color into one pixel with coverage a
+    void blend( int x, int y, float a );
+
+    // save a screen-space polygon for the GPU backend
+    void recordGpuPoly( int n, const Vertex v[] );
+
 public:
 
     ///
@@ -81,6 +267,40 @@ public:
     ///
     int addPoly( int n, const Vertex p[] );
 
+    ///
+    /// addPath - Add a curved polygon to the canvas.  Like addPoly(), it
+    ///           is only stored; each time it is drawn it is flattened
+    ///           into a polygon just detailed enough for the current
+    ///           transformation and viewport (see setCurveTolerance()).
+    ///           Flattened versions are cached by scale, in steps of a
+    ///           quarter octave.  Unlike addPoly(), the vertices are
+    ///           not rounded to integers.
+    ///
+    /// @param p - the contour
+    ///
+    /// @return a unique integer identifier for the polygon
+    ///
+    int addPath( const Path &p );
+
+    ///
+    /// setCurveTolerance - Set how far, in pixels, a flattened curve
+    ///                     may stray from the true one.  Changing it
+    ///                     empties the flattening caches.
+    ///
+    /// @param pixels - the tolerance (default 0.25)
+    ///
+    /// @return the previous tolerance
+    ///
+    float setCurveTolerance( float pixels );
+
+    ///
+    /// polyVertexCount - Number of vertices the polygon with the given
+    ///                   id would be drawn with right now.
+    ///
+    /// @param polyID - the polygon
+    ///
+    int polyVertexCount( int polyID );
+
     ///
     /// drawPoly - Draw the polygon with the given id.  The polygon should
     ///            be drawn after applying the current transformation to
@@ -108,6 +328,192 @@ public:
     ///
     void drawPolygon( int n, const Vertex p[] );
 
+    ///
+    /// drawPolygon - Fixed-point version; the vertices must lie on
+    ///               integer coordinates, as they do after applyViewport().
+    ///
+    /// @param n - number of vertices
+    /// @param v - array of vertices
+    ///
+    void drawPolygon( int n, const FixedVertex v[] );
+
+    ///
+    /// drawLines - Draw a batch of line segments, in screen coordinates,
+    ///             into the sink (or the Canvas).  Segment i runs from
+    ///             v[2i] to v[2i+1]; both endpoints are drawn.
+    ///
+    /// @param n - number of segments
+    /// @param v - array of 2n endpoints
+    ///
+    void drawLines( int n, const Vertex v[] );
+
+    ///
+    /// drawLoop - Draw the closed outline of a polygon given in screen
+    ///            coordinates.
+    ///
+    /// @param n - number of vertices
+    /// @param v - array of vertices
+    ///
+    void drawLoop( int n, const Vertex v[] );
+
+    ///
+    /// drawPolyEdges - Draw the outline of the polygon with the given id
+    ///                 after transforming, clipping and mapping it to
+    ///                 the viewport as drawPoly() does.  Where the
+    ///                 polygon was clipped, the clip window boundary is
+    ///                 part of the outline.
+    ///
+    /// @param polyID - the ID of the polygon to be drawn.
+    ///
+    void drawPolyEdges( int polyID );
+
+    ///
+    /// setLineMode - Select aliased or antialiased lines.
+    ///
+    /// @param m - the mode to use
+    ///
+    /// @return the previous mode
+    ///
+    LineMode setLineMode( LineMode m );
+
+    ///
+    /// getLineMode - Return the current line mode.
+    ///
+    LineMode getLineMode( void ) const { return lineMode; }
+
+    ///
+    /// setArithmetic - Select floating-point or fixed-point arithmetic
+    ///                 for drawPoly() and the retained drawings.
+    ///
+    /// @param a - the arithmetic to use
+    ///
+    /// @return the previous setting
+    ///
+    Arithmetic setArithmetic( Arithmetic a );
+
+    ///
+    /// getArithmetic - Return the current arithmetic setting.
+    ///
+    Arithmetic getArithmetic( void ) const { return arith; }
+
+    ///
+    /// clear - Clear the canvas, along with any polygons that have
+    ///         been recorded for the GPU backend.
+    ///
+    void clear( void );
+
+    ///
+    /// setBackend - Select the fill backend used by drawPoly().
+    ///
+    /// @param b - the backend to use
+    ///
+    /// @return the previous backend
+    ///
+    Backend setBackend( Backend b );
+
+    ///
+    /// getBackend - Return the current fill backend.
+    ///
+    Backend getBackend( void ) const { return backend; }
+
+    ///
+    /// gpuVertices - Screen-space (x,y) pairs for the polygons recorded
+    ///               by the GPU backend since the last clear().
+    ///
+    const vector<float> &gpuVertices( void ) const { return gpuVerts; }
+
+    ///
+    /// gpuPolygons - The polygons recorded by the GPU backend since the
+    ///               last clear(), in drawing order.
+    ///
+    const vector<GpuPoly> &gpuPolygons( void ) const { return gpuPolys; }
+
+    ///
+    /// setSink - Send the pixels produced by drawPolygon() to a pixel
+    ///           sink instead of the Canvas.
+    ///
+    /// @param s - the sink to use, or NULL to go back to the Canvas
+    ///
+    void setSink( PixelSink *s );
+
+    ///
+    /// addDraw - Draw a polygon like drawPoly() does, and also remember
+    ///           the current transformation, clip window, viewport and
+    ///           color so that it can be redrawn incrementally later.
+    ///
+    /// @param polyID - the ID of the polygon to be drawn.
+    /// @param draw - draw it now; if false, it is only remembered,
+    ///               e.g. to be drawn later by renderScene()
+    ///
+    /// @return a unique integer identifier for the drawing, or -1
+    ///
+    int addDraw( int polyID, bool draw = true );
+
+    ///
+    /// updateDraw - Replace the state remembered for a drawing with the
+    ///              current transformation, clip window, viewport and
+    ///              color.  Nothing is drawn; the screen areas covered
+    ///              by the old and the new version are marked dirty,
+    ///              to be repainted by redrawDirty().
+    ///
+    /// @param drawID - the drawing to update
+    ///
+    void updateDraw( int drawID );
+
+    ///
+    /// redrawDirty - Repaint the dirty areas of the sink.  Each dirty
+    ///               rectangle is filled with the background color, and
+    ///               every drawing that overlaps it is rasterized again
+    ///               (in drawing order), with its output limited to the
+    ///               rectangle.  Requires a sink.
+    ///
+    ///               Only the drawings in the grid cells the dirty
+    ///               rectangles touch are visited, and each of those is
+    ///               transformed, clipped and set up once, however many
+    ///               of the rectangles it overlaps.
+    ///
+    /// @param background - the color behind all drawings
+    ///
+    void redrawDirty( Color background );
+
+    ///
+    /// renderScene - Draw all retained drawings, in one scan-line sweep
+    ///               over a single edge table holding the edges of all
+    ///               of them.  On each row, the drawings covering each
+    ///               run of pixels are kept in drawing order and only
+    ///               the front-most one (the latest drawn) is plotted,
+    ///               so every covered pixel is sent exactly once.  The
+    ///               result is the same as drawing them one after the
+    ///               other, but hidden pixels cost nothing.
+    ///
+    void renderScene( void );
+
+    ///
+    /// clearDraws - Forget all retained drawings and dirty areas.
+    ///
+    void clearDraws( void );
+
+    ///
+    /// drawBounds - Screen area covered by a drawing the last time it
+    ///              was drawn or updated.
+    ///
+    /// @param drawID - the drawing
+    ///
+    /// @return its bounds, or an empty rectangle if the ID is invalid
+    ///
+    Rect drawBounds( int drawID ) const;
+
+    ///
+    /// stats - Counters and stage times since the last resetStats().
+    ///         All zero unless compiled with PIPELINE_STATS.
+    ///
+    const PipelineStats &stats( void ) const { return pstats; }
+
+    ///
+    /// resetStats - Set all counters and stage times to zero.
+    ///
+    void resetStats( void );
+
     ///
     /// clearTransform - Set the current transformation to the identity matrix.
     ///
@@ -172,6 +578,15 @@ public:
      */
     void applyViewport(int n, Vertex v[]);
 
+    ///
+    /// applyViewport - Fixed-point version; results are rounded to the
+    ///                 nearest integer.
+    ///
+    /// @param n - num of verts
+    /// @param v - vertices to apply to
+    ///
+    void applyViewport(int n, FixedVertex v[]);
+
 };
 
 /**
@@ -0,0 +1,97 @@
+//
+//  PipelineStats.cpp
+//
+//  Counters and stage timers for the 2D Pipeline.
+//
+//  See PipelineStats.h for a description of the module.
+//
+
+#include <string>
+
+#include "PipelineStats.h"
+
+using namespace std;
+
+//
+// PRIVATE DATA
+//
+
+static const char *stageNames[N_STAGES] = {
+    "transform", "clip", "viewport", "edges", "scan"
+};
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Ratio of two counters, or 0 if the divisor is zero
+///
+static double ratio( uint64_t a, uint64_t b )
+{
+    return b == 0 ? 0.0 : (double) a / b;
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Name of a stage, as used in the JSON output
+///
+const char *stageName( int stage )
+{
+    return (stage >= 0 && stage < N_STAGES) ? stageNames[stage] : "unknown";
+}
+
+///
+/// Unit of the stage times:  "cycles" or "ns"
+///
+const char *statsClock( void )
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+///
+/// Write a set of statistics as a JSON object
+///
+/// @param out     where to write
+/// @param s       the statistics
+/// @param indent  number of spaces in front of each line
+///
+void writeStatsJSON( ostream &out, const PipelineStats &s, int indent )
+{
+    string pad( indent, ' ' );
+
+    out << "{" << endl;
+#if defined(PIPELINE_STATS)
+    out << pad << "  \"enabled\": true," << endl;
+#else
+    out << pad << "  \"enabled\": false," << endl;
+#endif
+    out << pad << "  \"polygons\": { \"submitted\": " << s.polysSubmitted
+        << ", \"rejected\": " << s.polysRejected
+        << ", \"clipped\": " << s.polysClipped
+        << ", \"emitted\": " << s.polysEmitted << " }," << endl;
+    out << pad << "  \"clip_vertices\": { \"in\": " << s.clipVertsIn
+        << ", \"out\": " << s.clipVertsOut << " }," << endl;
+    out << pad << "  \"fill\": { \"polygons\": " << s.polysFilled
+        << ", \"edges\": " << s.edges
+        << ", \"scanlines\": " << s.scanlines
+        << ", \"pixels\": " << s.pixels << "," << endl;
+    out << pad << "    \"per_polygon\": { \"edges\": "
+        << ratio( s.edges, s.polysFilled )
+        << ", \"scanlines\": " << ratio( s.scanlines, s.polysFilled )
+        << ", \"pixels\": " << ratio( s.pixels, s.polysFilled )
+        << " } }," << endl;
+    out << pad << "  \"time\": { \"unit\": \"" << statsClock() << "\"";
+    for( int i = 0; i < N_STAGES; ++i ) {
+        out << ", \"" << stageNames[i] << "\": " << s.ticks[i];
+    }
+    out << " }" << endl;
+    out << pad << "}";
+}
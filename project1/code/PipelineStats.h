@@ -0,0 +1,125 @@
+//
+//  PipelineStats.h
+//
+//  Counters and stage timers for the 2D Pipeline.
+//
+//  The instrumentation is only compiled in when PIPELINE_STATS is
+//  defined (e.g., "make STATS=-DPIPELINE_STATS" in ../tools).  Without
+//  it, the PSTAT_ macros expand to nothing, so there is no cost at all;
+//  Pipeline::stats() still exists, but every counter stays zero.
+//
+//  Stage times are read from the processor's time-stamp counter where
+//  there is one (x86), so they are in cycles; elsewhere they are in
+//  nanoseconds from the steady clock.  statsClock() says which.
+//
+
+#ifndef PIPELINESTATS_H_
+#define PIPELINESTATS_H_
+
+#include <stdint.h>
+#include <ostream>
+
+#if defined(PIPELINE_STATS)
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+//
+// Timed stages of drawPoly()
+//
+typedef
+    enum stages_e {
+        StageTransform = 0, StageClip, StageViewport, StageEdges, StageScan
+        // Sentinel gives us the number of stages
+        , N_STAGES
+    } Stage;
+
+//
+// Everything the Pipeline counts
+//
+struct PipelineStats {
+    // polygons through the transformation and clipping stages
+    // (drawPoly() and the retained drawings)
+    uint64_t polysSubmitted;
+    uint64_t polysRejected;     // clipped away entirely
+    uint64_t polysClipped;      // crossed the clip window boundary
+    uint64_t polysEmitted;      // handed to drawPolygon()
+
+    // clipPolygon()
+    uint64_t clipVertsIn;
+    uint64_t clipVertsOut;
+
+    // drawPolygon()
+    uint64_t polysFilled;       // drawPolygon() calls
+    uint64_t edges;             // non-horizontal edges built
+    uint64_t scanlines;         // rows walked by the scan loop
+    uint64_t pixels;            // pixels sent to the Canvas or sink
+
+    // time spent in each stage
+    uint64_t ticks[N_STAGES];
+};
+
+///
+/// Name of a stage, as used in the JSON output
+///
+const char *stageName( int stage );
+
+///
+/// Unit of the stage times:  "cycles" or "ns"
+///
+const char *statsClock( void );
+
+///
+/// Write a set of statistics as a JSON object
+///
+/// @param out     where to write
+/// @param s       the statistics
+/// @param indent  number of spaces in front of each line
+///
+void writeStatsJSON( std::ostream &out, const PipelineStats &s,
+                     int indent = 0 );
+
+#if defined(PIPELINE_STATS)
+
+///
+/// Current value of the stage clock
+///
+inline uint64_t statsTicks( void )
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+///
+/// Adds the time from its construction to its destruction to a counter
+///
+class StageTimer {
+    uint64_t &total;
+    uint64_t start;
+
+public:
+    StageTimer( uint64_t &t ) : total( t ), start( statsTicks() ) { }
+    ~StageTimer( void ) { total += statsTicks() - start; }
+};
+
+// count something
+#define PSTAT_ADD(field,n)      (this->pstats.field += (n))
+
+// time the rest of the enclosing block as the given stage
+#define PSTAT_TIME(stage)       StageTimer pstat_timer_( this->pstats.ticks[stage] )
+
+#else
+
+#define PSTAT_ADD(field,n)      ((void) 0)
+#define PSTAT_TIME(stage)       ((void) 0)
+
+#endif
+
+#endif
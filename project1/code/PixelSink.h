@@ -0,0 +1,158 @@
+//
+//  PixelSink.h
+//
+//  Destination for the pixels produced by the 2D pipeline.
+//
+//  By default, Pipeline hands every pixel it generates to the Canvas,
+//  which records it for upload to OpenGL.  A PixelSink lets the pixels
+//  go straight into a raster instead (e.g., a Framebuffer), which is
+//  what headless rendering and incremental redraw need.
+//
+
+#ifndef PIXELSINK_H_
+#define PIXELSINK_H_
+
+#include "Types.h"
+
+//
+// An axis-aligned pixel rectangle.  All four bounds are inclusive;
+// a rectangle with xmin > xmax or ymin > ymax is empty.
+//
+
+struct Rect {
+    int xmin, ymin;
+    int xmax, ymax;
+};
+
+///
+/// An empty rectangle
+///
+inline Rect emptyRect( void )
+{
+    Rect r = { 1, 1, 0, 0 };
+    return r;
+}
+
+///
+/// Is a rectangle empty?
+///
+inline bool isEmpty( const Rect &r )
+{
+    return r.xmin > r.xmax || r.ymin > r.ymax;
+}
+
+///
+/// Do two rectangles overlap?
+///
+inline bool overlaps( const Rect &a, const Rect &b )
+{
+    return !isEmpty(a) && !isEmpty(b) &&
+           a.xmin <= b.xmax && b.xmin <= a.xmax &&
+           a.ymin <= b.ymax && b.ymin <= a.ymax;
+}
+
+///
+/// Smallest rectangle containing both a and b
+///
+inline Rect unite( const Rect &a, const Rect &b )
+{
+    if( isEmpty(a) ) return b;
+    if( isEmpty(b) ) return a;
+    Rect r = { a.xmin < b.xmin ? a.xmin : b.xmin,
+               a.ymin < b.ymin ? a.ymin : b.ymin,
+               a.xmax > b.xmax ? a.xmax : b.xmax,
+               a.ymax > b.ymax ? a.ymax : b.ymax };
+    return r;
+}
+
+///
+/// Overlap of a and b (possibly empty)
+///
+inline Rect intersect( const Rect &a, const Rect &b )
+{
+    Rect r = { a.xmin > b.xmin ? a.xmin : b.xmin,
+               a.ymin > b.ymin ? a.ymin : b.ymin,
+               a.xmax < b.xmax ? a.xmax : b.xmax,
+               a.ymax < b.ymax ? a.ymax : b.ymax };
+    return r;
+}
+
+///
+/// Abstract pixel destination
+///
+
+class PixelSink {
+
+public:
+
+    virtual ~PixelSink( void ) { }
+
+    ///
+    /// The pixels that can actually be stored; the Pipeline does not
+    /// generate pixels outside this rectangle
+    ///
+    /// @return the bounds (inclusive); by default, unbounded
+    ///
+    virtual Rect bounds( void ) const
+    {
+        Rect r = { -(1 << 30), -(1 << 30), 1 << 30, 1 << 30 };
+        return r;
+    }
+
+    ///
+    /// Set one pixel; coordinates outside the sink are ignored
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color
+    ///
+    virtual void setPixel( int x, int y, Color c ) = 0;
+
+    ///
+    /// Set a horizontal run of pixels, x0 <= x < x1, on row y
+    ///
+    /// @param x0  first x coordinate
+    /// @param x1  one past the last x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color
+    ///
+    virtual void fillSpan( int x0, int x1, int y, Color c )
+    {
+        for( int x = x0; x < x1; ++x ) {
+            setPixel( x, y, c );
+        }
+    }
+
+    ///
+    /// Blend a color into one pixel, as an antialiased line does along
+    /// its edges.  Sinks that cannot read their pixels back just set
+    /// the pixels that are at least half covered.
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color
+    /// @param a   coverage of the pixel, 0 to 1
+    ///
+    virtual void blendPixel( int x, int y, Color c, float a )
+    {
+        if( a >= 0.5f ) {
+            setPixel( x, y, c );
+        }
+    }
+
+    ///
+    /// Fill a rectangle
+    ///
+    /// @param r   the rectangle (inclusive bounds)
+    /// @param c   the color
+    ///
+    virtual void fillRect( const Rect &r, Color c )
+    {
+        for( int y = r.ymin; y <= r.ymax; ++y ) {
+            fillSpan( r.xmin, r.xmax + 1, y, c );
+        }
+    }
+
+};
+
+#endif
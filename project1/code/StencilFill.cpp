@@ -0,0 +1,122 @@
+//
+//  StencilFill.cpp
+//
+//  GPU polygon fill backend for the 2D Pipeline.
+//
+//  See StencilFill.h for a description of the technique.
+//
+
+#include <cstdlib>
+#include <iostream>
+
+#include "StencilFill.h"
+#include "Buffers.h"
+#include "Utils.h"
+
+///
+/// Constructor
+///
+StencilFill::StencilFill( void ) : vbuffer(0)
+{
+}
+
+///
+/// Release the GL buffer (requires a current GL context)
+///
+void StencilFill::release( void )
+{
+    if( vbuffer ) {
+        glDeleteBuffers( 1, &vbuffer );
+        vbuffer = 0;
+    }
+}
+
+///
+/// Fill every polygon recorded by the Pipeline, in drawing order
+///
+/// @param P         the Pipeline holding the recorded polygons
+/// @param program   GLSL program object
+/// @param vp        name of the position attribute variable
+/// @param vc        name of the color attribute variable
+///
+void StencilFill::draw( const Pipeline &P, GLuint program,
+                        const char *vp, const char *vc )
+{
+    const vector<float> &verts = P.gpuVertices();
+    const vector<GpuPoly> &polys = P.gpuPolygons();
+
+    if( polys.empty() ) {
+        return;
+    }
+
+    //
+    // vertex buffer structure (all entries are (x,y) pairs)
+    //
+    //     [ fan vertices of every polygon ]   verts.size() / 2 entries
+    //     [ covering quad of polygon 0    ]   4 entries
+    //     [ covering quad of polygon 1    ]   4 entries
+    //     ...
+    //
+    staging.assign( verts.begin(), verts.end() );
+    int quadBase = verts.size() / 2;
+    for( size_t i = 0; i < polys.size(); ++i ) {
+        const GpuPoly &p = polys[i];
+        float quad[8] = { p.xmin, p.ymin,  p.xmax, p.ymin,
+                          p.xmax, p.ymax,  p.xmin, p.ymax };
+        staging.insert( staging.end(), quad, quad + 8 );
+    }
+
+    if( vbuffer == 0 ) {
+        glGenBuffers( 1, &vbuffer );
+    }
+    glBindBuffer( GL_ARRAY_BUFFER, vbuffer );
+    glBufferData( GL_ARRAY_BUFFER, staging.size() * sizeof(float),
+                  &staging[0], GL_STREAM_DRAW );
+
+    GLint ploc = getAttribLoc( program, vp );
+    if( ploc < 0 ) {
+        return;
+    }
+    glEnableVertexAttribArray( ploc );
+    glVertexAttribPointer( ploc, 2, GL_FLOAT, GL_FALSE, 0,
+                           BUFFER_OFFSET(0) );
+
+    // color comes from a constant attribute value, set per polygon
+    GLint cloc = getAttribLoc( program, vc );
+    if( cloc >= 0 ) {
+        glDisableVertexAttribArray( cloc );
+    }
+
+    glEnable( GL_STENCIL_TEST );
+    glEnable( GL_SCISSOR_TEST );
+    glStencilMask( 0x01 );
+
+    for( size_t i = 0; i < polys.size(); ++i ) {
+        const GpuPoly &p = polys[i];
+
+        glScissor( p.scissor[0], p.scissor[1], p.scissor[2], p.scissor[3] );
+
+        // pass 1:  fan into the stencil buffer only
+        glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+        glDepthMask( GL_FALSE );
+        glStencilFunc( GL_ALWAYS, 0, 0x01 );
+        glStencilOp( GL_KEEP, GL_KEEP, GL_INVERT );
+        glDrawArrays( GL_TRIANGLE_FAN, p.first, p.count );
+
+        // pass 2:  cover the bounding box where the stencil is set,
+        //          clearing the stencil behind us
+        glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+        glDepthMask( GL_TRUE );
+        glStencilFunc( GL_NOTEQUAL, 0, 0x01 );
+        glStencilOp( GL_ZERO, GL_ZERO, GL_ZERO );
+        if( cloc >= 0 ) {
+            glVertexAttrib4f( cloc, p.color.r, p.color.g, p.color.b, 1.0f );
+        }
+        glDrawArrays( GL_TRIANGLE_FAN, quadBase + 4 * i, 4 );
+    }
+
+    glDisable( GL_SCISSOR_TEST );
+    glDisable( GL_STENCIL_TEST );
+
+    checkErrors( "StencilFill::draw" );
+}
@@ -0,0 +1,81 @@
+//
+//  StencilFill.h
+//
+//  GPU polygon fill backend for the 2D Pipeline.
+//
+//  Polygons recorded by a Pipeline using the FillGPU backend are filled
+//  with the "stencil, then cover" technique:
+//
+//    1. All recorded vertices, plus a covering quad for each polygon,
+//       are uploaded to a single vertex buffer with one call.
+//    2. For each polygon, a triangle fan over its vertices is drawn
+//       into the stencil buffer only, inverting the stencil value for
+//       every fragment.  Pixels covered an odd number of times end up
+//       with a non-zero stencil, which is exactly the even-odd interior
+//       of the polygon - concave and self-intersecting polygons work.
+//    3. The polygon's bounding box is drawn as a quad with the stencil
+//       test passing only where the stencil is non-zero, writing the
+//       polygon color and resetting the stencil to zero as it goes.
+//
+//  Clipping is done by the scissor test, using the rectangle the
+//  Pipeline recorded from its viewport at the time of drawPoly().
+//
+//  The window must have a stencil buffer (GLFW provides 8 bits by
+//  default).  This uses only OpenGL 2.1/3.2 core functionality, so it
+//  runs under Mesa's llvmpipe software renderer as well; set
+//  LIBGL_ALWAYS_SOFTWARE=1 to force that.
+//
+
+#ifndef STENCILFILL_H_
+#define STENCILFILL_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "Pipeline.h"
+
+using namespace std;
+
+class StencilFill {
+
+    // vertex buffer holding the fans and the covering quads
+    GLuint vbuffer;
+
+    // staging area for the vertex data
+    vector<float> staging;
+
+public:
+
+    ///
+    /// Constructor
+    ///
+    StencilFill( void );
+
+    ///
+    /// Release the GL buffer (requires a current GL context)
+    ///
+    void release( void );
+
+    ///
+    /// Fill every polygon recorded by the Pipeline, in drawing order
+    ///
+    /// The shader program is assumed to be in use and to already have
+    /// any uniforms it needs (e.g., the normalization scale factors).
+    ///
+    /// @param P         the Pipeline holding the recorded polygons
+    /// @param program   GLSL program object
+    /// @param vp        name of the position attribute variable
+    /// @param vc        name of the color attribute variable
+    ///
+    void draw( const Pipeline &P, GLuint program,
+               const char *vp, const char *vc );
+
+};
+
+#endif
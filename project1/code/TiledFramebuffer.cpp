@@ -0,0 +1,809 @@
+//
+//  TiledFramebuffer.cpp
+//
+//  A sparse, tiled RGB framebuffer for very large 2D canvases.
+//
+//  See TiledFramebuffer.h for a description of the module.
+//
+//  Tile file format:  a text header
+//
+//      TILES
+//      <width> <height> <tile size>
+//      <background color as six hex digits>
+//
+//  followed by any number of binary tile records, each a sequence of
+//  32-bit little-endian words:
+//
+//      tile x, tile y, number of runs, then (length, 0xRRGGBB) per run
+//
+//  Tiles without a record are entirely background.  If a tile appears
+//  more than once, the last record wins.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include "TiledFramebuffer.h"
+
+//
+// PRIVATE FUNCTIONS
+//
+
+// number of pixels in a tile
+static const int tilePixelCount =
+    TiledFramebuffer::TILE_SIZE * TiledFramebuffer::TILE_SIZE;
+
+///
+/// Convert a color channel to an 8-bit value
+///
+static unsigned char toByte( float f )
+{
+    if( f <= 0.0f ) return 0;
+    if( f >= 1.0f ) return 255;
+    return (unsigned char) (f * 255.0f + 0.5f);
+}
+
+///
+/// Convert a color to packed 0xRRGGBB
+///
+static unsigned int pack( Color c )
+{
+    return (toByte( c.r ) << 16) | (toByte( c.g ) << 8) | toByte( c.b );
+}
+
+///
+/// Fill n RGB triples with a packed color
+///
+static void fillRGB( unsigned char *p, int n, unsigned int rgb )
+{
+    unsigned char r = (rgb >> 16) & 0xff;
+    unsigned char g = (rgb >> 8) & 0xff;
+    unsigned char b = rgb & 0xff;
+
+    for( int i = 0; i < n; ++i ) {
+        *p++ = r;
+        *p++ = g;
+        *p++ = b;
+    }
+}
+
+///
+/// Tile-file word I/O (little-endian regardless of the host)
+///
+static void putWord( FILE *fp, unsigned int w )
+{
+    unsigned char b[4] = { (unsigned char) (w & 0xff),
+                           (unsigned char) ((w >> 8) & 0xff),
+                           (unsigned char) ((w >> 16) & 0xff),
+                           (unsigned char) ((w >> 24) & 0xff) };
+    fwrite( b, 1, 4, fp );
+}
+
+static bool getWord( FILE *fp, unsigned int &w )
+{
+    unsigned char b[4];
+    if( fread( b, 1, 4, fp ) != 4 ) {
+        return( false );
+    }
+    w = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int) b[3] << 24);
+    return( true );
+}
+
+///
+/// Write one band of tile rows to a PPM file, top row first
+///
+/// @param fp      the output file
+/// @param band    RGB pixels, width * TILE_SIZE of them, bottom row first
+/// @param width   image width
+/// @param nrows   number of valid rows in the band
+///
+static void writeBand( FILE *fp, const vector<unsigned char> &band,
+                       int width, int nrows )
+{
+    for( int y = nrows - 1; y >= 0; --y ) {
+        fwrite( &band[(size_t) y * width * 3], 1, width * 3, fp );
+    }
+}
+
+///
+/// Copy one expanded tile into a band buffer
+///
+/// @param band    the band buffer (width * TILE_SIZE RGB triples)
+/// @param width   image width
+/// @param tx      tile column
+/// @param rgb     the tile pixels
+///
+static void copyToBand( vector<unsigned char> &band, int width, int tx,
+                        const unsigned char *rgb )
+{
+    const int ts = TiledFramebuffer::TILE_SIZE;
+    int x0 = tx * ts;
+    int n = min( ts, width - x0 );
+
+    for( int y = 0; y < ts; ++y ) {
+        memcpy( &band[((size_t) y * width + x0) * 3], rgb + y * ts * 3,
+                n * 3 );
+    }
+}
+
+//
+// CLASS METHODS
+//
+
+///
+/// Constructor
+///
+/// @param w   width of the framebuffer
+/// @param h   height of the framebuffer
+///
+TiledFramebuffer::TiledFramebuffer( int w, int h ) :
+    width(0), height(0), cols(0), rows(0), background(0),
+    stream(NULL), warned(false)
+{
+    resize( w, h );
+}
+
+///
+/// Destructor
+///
+TiledFramebuffer::~TiledFramebuffer( void )
+{
+    if( stream ) {
+        closeStream();
+    }
+    freeTiles();
+}
+
+///
+/// Release every tile
+///
+void TiledFramebuffer::freeTiles( void )
+{
+    for( size_t i = 0; i < tiles.size(); ++i ) {
+        delete tiles[i];
+        tiles[i] = NULL;
+    }
+}
+
+///
+/// Change the dimensions; all tiles are released, the background
+/// becomes black, and any open stream is closed
+///
+/// @param w   new width
+/// @param h   new height
+///
+void TiledFramebuffer::resize( int w, int h )
+{
+    if( stream ) {
+        closeStream();
+    }
+    freeTiles();
+
+    if( w < 0 ) w = 0;
+    if( h < 0 ) h = 0;
+
+    width = w;
+    height = h;
+    cols = (w + TILE_SIZE - 1) >> TILE_SHIFT;
+    rows = (h + TILE_SIZE - 1) >> TILE_SHIFT;
+    background = 0;
+
+    tiles.assign( (size_t) cols * rows, (Tile *) NULL );
+    streamed.assign( (size_t) cols * rows, false );
+}
+
+///
+/// Set every pixel to a color by releasing all tiles
+///
+/// @param c   the new background color (alpha is ignored)
+///
+void TiledFramebuffer::clear( Color c )
+{
+    // the stream's header already holds the old background, and the
+    // tiles already streamed can't be taken back
+    if( stream ) {
+        cerr << "TiledFramebuffer::clear: a stream is open" << endl;
+        return;
+    }
+
+    freeTiles();
+    background = pack( c );
+
+    // every tile can be drawn again
+    streamed.assign( tiles.size(), false );
+    warned = false;
+}
+
+///
+/// Find a tile for writing, allocating or expanding it as needed
+///
+/// @param tx   tile column
+/// @param ty   tile row
+///
+/// @return the tile, or NULL if it has already been streamed
+///
+TiledFramebuffer::Tile *TiledFramebuffer::writableTile( int tx, int ty )
+{
+    size_t index = (size_t) ty * cols + tx;
+
+    if( streamed[index] ) {
+        if( !warned ) {
+            cerr << "TiledFramebuffer: ignoring writes to tiles that "
+                 << "have already been streamed" << endl;
+            warned = true;
+        }
+        return( NULL );
+    }
+
+    Tile *t = tiles[index];
+    if( t == NULL ) {
+        t = tiles[index] = new Tile;
+        t->pixels.resize( tilePixelCount * 3 );
+        fillRGB( &t->pixels[0], tilePixelCount, background );
+    } else if( !t->runs.empty() ) {
+        t->pixels.resize( tilePixelCount * 3 );
+        expand( t->runs, &t->pixels[0] );
+        vector<unsigned int>().swap( t->runs );
+    }
+
+    return( t );
+}
+
+///
+/// Set one pixel; coordinates outside the framebuffer are ignored
+///
+/// @param x   x coordinate
+/// @param y   y coordinate
+/// @param c   the color (alpha is ignored)
+///
+void TiledFramebuffer::setPixel( int x, int y, Color c )
+{
+    if( x < 0 || y < 0 || x >= width || y >= height ) {
+        return;
+    }
+
+    Tile *t = writableTile( x >> TILE_SHIFT, y >> TILE_SHIFT );
+    if( t == NULL ) {
+        return;
+    }
+
+    int offset = ((y & (TILE_SIZE - 1)) * TILE_SIZE + (x & (TILE_SIZE - 1)));
+    fillRGB( &t->pixels[offset * 3], 1, pack( c ) );
+}
+
+///
+/// Blend a color into one pixel; coordinates outside the
+/// framebuffer are ignored
+///
+/// @param x   x coordinate
+/// @param y   y coordinate
+/// @param c   the color (alpha is ignored)
+/// @param a   coverage of the pixel, 0 to 1
+///
+void TiledFramebuffer::blendPixel( int x, int y, Color c, float a )
+{
+    if( x < 0 || y < 0 || x >= width || y >= height ) {
+        return;
+    }
+
+    Tile *t = writableTile( x >> TILE_SHIFT, y >> TILE_SHIFT );
+    if( t == NULL ) {
+        return;
+    }
+
+    int offset = ((y & (TILE_SIZE - 1)) * TILE_SIZE + (x & (TILE_SIZE - 1)));
+    unsigned char *p = &t->pixels[offset * 3];
+    p[0] = toByte( p[0] / 255.0f + a * (c.r - p[0] / 255.0f) );
+    p[1] = toByte( p[1] / 255.0f + a * (c.g - p[1] / 255.0f) );
+    p[2] = toByte( p[2] / 255.0f + a * (c.b - p[2] / 255.0f) );
+}
+
+///
+/// Set a horizontal run of pixels, x0 <= x < x1, on row y;
+/// the run is clipped to the framebuffer
+///
+/// @param x0  first x coordinate
+/// @param x1  one past the last x coordinate
+/// @param y   y coordinate
+/// @param c   the color (alpha is ignored)
+///
+void TiledFramebuffer::fillSpan( int x0, int x1, int y, Color c )
+{
+    if( y < 0 || y >= height ) {
+        return;
+    }
+    if( x0 < 0 ) x0 = 0;
+    if( x1 > width ) x1 = width;
+
+    unsigned int rgb = pack( c );
+    int ty = y >> TILE_SHIFT;
+    int row = (y & (TILE_SIZE - 1)) * TILE_SIZE;
+
+    while( x0 < x1 ) {
+        int tx = x0 >> TILE_SHIFT;
+        int end = min( x1, (tx + 1) << TILE_SHIFT );
+
+        Tile *t = writableTile( tx, ty );
+        if( t != NULL ) {
+            int offset = row + (x0 & (TILE_SIZE - 1));
+            fillRGB( &t->pixels[offset * 3], end - x0, rgb );
+        }
+
+        x0 = end;
+    }
+}
+
+///
+/// Fill a rectangle; tiles that are completely covered are replaced
+/// by single-run tiles rather than being filled pixel by pixel
+///
+/// @param r   the rectangle (inclusive bounds)
+/// @param c   the color (alpha is ignored)
+///
+void TiledFramebuffer::fillRect( const Rect &r, Color c )
+{
+    Rect area = intersect( r, bounds() );
+    if( isEmpty( area ) ) {
+        return;
+    }
+
+    unsigned int rgb = pack( c );
+
+    for( int ty = area.ymin >> TILE_SHIFT; ty <= area.ymax >> TILE_SHIFT;
+         ++ty ) {
+        for( int tx = area.xmin >> TILE_SHIFT; tx <= area.xmax >> TILE_SHIFT;
+             ++tx ) {
+
+            // the part of the tile inside the image, and the part of
+            // that inside the rectangle
+            Rect tile = { tx << TILE_SHIFT, ty << TILE_SHIFT,
+                          ((tx + 1) << TILE_SHIFT) - 1,
+                          ((ty + 1) << TILE_SHIFT) - 1 };
+            tile = intersect( tile, bounds() );
+            Rect part = intersect( tile, area );
+
+            size_t index = (size_t) ty * cols + tx;
+            bool whole = part.xmin == tile.xmin && part.xmax == tile.xmax &&
+                         part.ymin == tile.ymin && part.ymax == tile.ymax;
+
+            if( whole && !streamed[index] ) {
+                delete tiles[index];
+                tiles[index] = NULL;
+                if( rgb != background ) {
+                    Tile *t = tiles[index] = new Tile;
+                    t->runs.push_back( tilePixelCount );
+                    t->runs.push_back( rgb );
+                }
+                continue;
+            }
+
+            Tile *t = writableTile( tx, ty );
+            if( t == NULL ) {
+                continue;
+            }
+            for( int y = part.ymin; y <= part.ymax; ++y ) {
+                int offset = (y & (TILE_SIZE - 1)) * TILE_SIZE +
+                             (part.xmin & (TILE_SIZE - 1));
+                fillRGB( &t->pixels[offset * 3], part.xmax - part.xmin + 1,
+                         rgb );
+            }
+        }
+    }
+}
+
+///
+/// Retrieve one pixel as packed 0xRRGGBB
+///
+/// @param x   x coordinate
+/// @param y   y coordinate
+///
+/// @return the pixel value, or 0 if (x,y) is outside the framebuffer
+///
+unsigned int TiledFramebuffer::getPixel( int x, int y ) const
+{
+    if( x < 0 || y < 0 || x >= width || y >= height ) {
+        return( 0 );
+    }
+
+    const Tile *t = tiles[(size_t) (y >> TILE_SHIFT) * cols +
+                          (x >> TILE_SHIFT)];
+    if( t == NULL ) {
+        return( background );
+    }
+
+    int offset = ((y & (TILE_SIZE - 1)) * TILE_SIZE + (x & (TILE_SIZE - 1)));
+
+    if( t->runs.empty() ) {
+        const unsigned char *p = &t->pixels[offset * 3];
+        return( (p[0] << 16) | (p[1] << 8) | p[2] );
+    }
+
+    for( size_t i = 0; i < t->runs.size(); i += 2 ) {
+        if( offset < (int) t->runs[i] ) {
+            return( t->runs[i + 1] );
+        }
+        offset -= t->runs[i];
+    }
+
+    return( background );
+}
+
+///
+/// Run-length encode the pixels of one tile
+///
+/// @param rgb    the tile pixels
+/// @param runs   receives the (length, 0xRRGGBB) pairs
+///
+void TiledFramebuffer::encode( const unsigned char *rgb,
+                               vector<unsigned int> &runs )
+{
+    runs.clear();
+
+    unsigned int current = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+    unsigned int length = 0;
+
+    for( int i = 0; i < tilePixelCount; ++i, rgb += 3 ) {
+        unsigned int p = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+        if( p != current ) {
+            runs.push_back( length );
+            runs.push_back( current );
+            current = p;
+            length = 0;
+        }
+        ++length;
+    }
+
+    runs.push_back( length );
+    runs.push_back( current );
+}
+
+///
+/// Expand run-length encoded pixels
+///
+/// @param runs   the (length, 0xRRGGBB) pairs
+/// @param rgb    receives the tile pixels
+///
+void TiledFramebuffer::expand( const vector<unsigned int> &runs,
+                               unsigned char *rgb )
+{
+    int left = tilePixelCount;
+
+    for( size_t i = 0; i + 1 < runs.size() && left > 0; i += 2 ) {
+        int n = (int) min( runs[i], (unsigned int) left );
+        fillRGB( rgb, n, runs[i + 1] );
+        rgb += n * 3;
+        left -= n;
+    }
+
+    // a short (corrupt) run list leaves the rest black
+    if( left > 0 ) {
+        memset( rgb, 0, left * 3 );
+    }
+}
+
+///
+/// The pixels of one tile, expanded into RGB triples
+///
+/// @param index   tile index
+/// @param rgb     receives TILE_SIZE * TILE_SIZE RGB triples
+///
+void TiledFramebuffer::tilePixels( int index, unsigned char *rgb ) const
+{
+    const Tile *t = tiles[index];
+
+    if( t == NULL ) {
+        fillRGB( rgb, tilePixelCount, background );
+    } else if( t->runs.empty() ) {
+        memcpy( rgb, &t->pixels[0], tilePixelCount * 3 );
+    } else {
+        expand( t->runs, rgb );
+    }
+}
+
+///
+/// Run-length encode every allocated tile for which that saves memory
+///
+void TiledFramebuffer::compressTiles( void )
+{
+    vector<unsigned int> runs;
+
+    for( size_t i = 0; i < tiles.size(); ++i ) {
+        Tile *t = tiles[i];
+        if( t == NULL || !t->runs.empty() ) {
+            continue;
+        }
+
+        encode( &t->pixels[0], runs );
+        if( runs.size() * sizeof(unsigned int) < t->pixels.size() ) {
+            t->runs = runs;
+            vector<unsigned char>().swap( t->pixels );
+        }
+    }
+}
+
+///
+/// Number of tiles currently allocated
+///
+int TiledFramebuffer::tilesAllocated( void ) const
+{
+    int n = 0;
+
+    for( size_t i = 0; i < tiles.size(); ++i ) {
+        if( tiles[i] != NULL ) {
+            ++n;
+        }
+    }
+
+    return( n );
+}
+
+///
+/// Bytes of memory held by the framebuffer (tiles and tile table)
+///
+size_t TiledFramebuffer::memoryUsed( void ) const
+{
+    size_t bytes = sizeof(*this) + tiles.capacity() * sizeof(Tile *) +
+                   streamed.capacity() / 8;
+
+    for( size_t i = 0; i < tiles.size(); ++i ) {
+        const Tile *t = tiles[i];
+        if( t != NULL ) {
+            bytes += sizeof(Tile) + t->pixels.capacity() +
+                     t->runs.capacity() * sizeof(unsigned int);
+        }
+    }
+
+    return( bytes );
+}
+
+///
+/// Start streaming tiles to a file
+///
+/// @param fname   name of the tile file
+///
+/// @return true on success
+///
+bool TiledFramebuffer::openStream( const char *fname )
+{
+    if( stream ) {
+        closeStream();
+    }
+
+    stream = fopen( fname, "wb" );
+    if( stream == NULL ) {
+        perror( fname );
+        return( false );
+    }
+
+    fprintf( stream, "TILES\n%d %d %d\n%06x\n", width, height,
+             (int) TILE_SIZE, background );
+    streamed.assign( tiles.size(), false );
+    warned = false;
+
+    return( true );
+}
+
+///
+/// Write one tile to the stream (always run-length encoded) and
+/// release it
+///
+/// @param index   tile index
+///
+void TiledFramebuffer::writeTile( int index )
+{
+    Tile *t = tiles[index];
+
+    if( t != NULL ) {
+        vector<unsigned int> runs;
+        if( t->runs.empty() ) {
+            encode( &t->pixels[0], runs );
+        } else {
+            runs = t->runs;
+        }
+
+        putWord( stream, index % cols );
+        putWord( stream, index / cols );
+        putWord( stream, runs.size() / 2 );
+        for( size_t i = 0; i < runs.size(); ++i ) {
+            putWord( stream, runs[i] );
+        }
+
+        delete t;
+        tiles[index] = NULL;
+    }
+
+    streamed[index] = true;
+}
+
+///
+/// Write every tile lying completely inside a rectangle to the
+/// stream and release it
+///
+/// @param r   the finished area (inclusive bounds)
+///
+void TiledFramebuffer::streamTiles( const Rect &r )
+{
+    if( stream == NULL ) {
+        cerr << "TiledFramebuffer::streamTiles: no stream is open" << endl;
+        return;
+    }
+
+    Rect area = intersect( r, bounds() );
+    if( isEmpty( area ) ) {
+        return;
+    }
+
+    for( int ty = area.ymin >> TILE_SHIFT; ty <= area.ymax >> TILE_SHIFT;
+         ++ty ) {
+        for( int tx = area.xmin >> TILE_SHIFT; tx <= area.xmax >> TILE_SHIFT;
+             ++tx ) {
+            Rect tile = { tx << TILE_SHIFT, ty << TILE_SHIFT,
+                          ((tx + 1) << TILE_SHIFT) - 1,
+                          ((ty + 1) << TILE_SHIFT) - 1 };
+            tile = intersect( tile, bounds() );
+            Rect part = intersect( tile, area );
+
+            if( part.xmin == tile.xmin && part.xmax == tile.xmax &&
+                part.ymin == tile.ymin && part.ymax == tile.ymax ) {
+                int index = ty * cols + tx;
+                if( !streamed[index] ) {
+                    writeTile( index );
+                }
+            }
+        }
+    }
+}
+
+///
+/// Write all remaining tiles to the stream and close it
+///
+/// @return true if everything was written successfully
+///
+bool TiledFramebuffer::closeStream( void )
+{
+    if( stream == NULL ) {
+        return( false );
+    }
+
+    for( size_t i = 0; i < tiles.size(); ++i ) {
+        if( !streamed[i] ) {
+            writeTile( i );
+        }
+    }
+
+    bool ok = !ferror( stream );
+    fclose( stream );
+    stream = NULL;
+
+    return( ok );
+}
+
+///
+/// Write the image as a binary PPM (P6) file
+///
+/// @param fname   name of the output file
+///
+/// @return true on success
+///
+bool TiledFramebuffer::writePPM( const char *fname ) const
+{
+    FILE *fp = fopen( fname, "wb" );
+    if( fp == NULL ) {
+        perror( fname );
+        return( false );
+    }
+
+    fprintf( fp, "P6\n%d %d\n255\n", width, height );
+
+    // PPM rows run from top to bottom, so go through the tile rows
+    // from the top, expanding one row of tiles at a time
+    vector<unsigned char> band( (size_t) width * TILE_SIZE * 3 );
+    vector<unsigned char> rgb( tilePixelCount * 3 );
+
+    for( int ty = rows - 1; ty >= 0; --ty ) {
+        for( int tx = 0; tx < cols; ++tx ) {
+            tilePixels( ty * cols + tx, &rgb[0] );
+            copyToBand( band, width, tx, &rgb[0] );
+        }
+        writeBand( fp, band, width, min( (int) TILE_SIZE,
+                                         height - ty * TILE_SIZE ) );
+    }
+
+    bool ok = !ferror( fp );
+    fclose( fp );
+    return( ok );
+}
+
+///
+/// Convert a tile file written by the streaming functions into a
+/// binary PPM (P6) file, one row of tiles at a time
+///
+/// @param tname   name of the tile file
+/// @param pname   name of the output PPM file
+///
+/// @return true on success
+///
+bool TiledFramebuffer::streamToPPM( const char *tname, const char *pname )
+{
+    FILE *in = fopen( tname, "rb" );
+    if( in == NULL ) {
+        perror( tname );
+        return( false );
+    }
+
+    int w, h, ts;
+    unsigned int bg;
+    char magic[8];
+    if( fscanf( in, "%7s %d %d %d %x", magic, &w, &h, &ts, &bg ) != 5 ||
+        strcmp( magic, "TILES" ) != 0 || ts != TILE_SIZE ||
+        w < 0 || h < 0 || fgetc( in ) != '\n' ) {
+        cerr << tname << ": not a tile file" << endl;
+        fclose( in );
+        return( false );
+    }
+
+    int nc = (w + TILE_SIZE - 1) >> TILE_SHIFT;
+    int nr = (h + TILE_SIZE - 1) >> TILE_SHIFT;
+
+    // find the (last) record for each tile; a tile never has more
+    // runs than pixels
+    vector<long> where( (size_t) nc * nr, -1L );
+    unsigned int tx, ty, n;
+    while( getWord( in, tx ) ) {
+        if( !getWord( in, ty ) || !getWord( in, n ) ||
+            tx >= (unsigned int) nc || ty >= (unsigned int) nr ||
+            n > (unsigned int) tilePixelCount ) {
+            cerr << tname << ": bad tile record" << endl;
+            fclose( in );
+            return( false );
+        }
+        where[(size_t) ty * nc + tx] = ftell( in ) - 4;
+        fseek( in, 8L * n, SEEK_CUR );
+    }
+
+    FILE *out = fopen( pname, "wb" );
+    if( out == NULL ) {
+        perror( pname );
+        fclose( in );
+        return( false );
+    }
+
+    fprintf( out, "P6\n%d %d\n255\n", w, h );
+
+    vector<unsigned char> band( (size_t) w * TILE_SIZE * 3 );
+    vector<unsigned char> rgb( tilePixelCount * 3 );
+    vector<unsigned int> runs;
+    bool ok = true;
+
+    for( int y = nr - 1; y >= 0; --y ) {
+        for( int x = 0; x < nc; ++x ) {
+            long pos = where[(size_t) y * nc + x];
+            runs.clear();
+            if( pos >= 0 ) {
+                fseek( in, pos, SEEK_SET );
+                ok = getWord( in, n ) && ok;
+                runs.resize( 2 * n );
+                for( size_t i = 0; i < runs.size(); ++i ) {
+                    ok = getWord( in, runs[i] ) && ok;
+                }
+                expand( runs, &rgb[0] );
+            } else {
+                fillRGB( &rgb[0], tilePixelCount, bg );
+            }
+            copyToBand( band, w, x, &rgb[0] );
+        }
+        writeBand( out, band, w, min( (int) TILE_SIZE, h - y * TILE_SIZE ) );
+    }
+
+    if( !ok ) {
+        cerr << tname << ": truncated tile record" << endl;
+    }
+
+    ok = ok && !ferror( out );
+    fclose( out );
+    fclose( in );
+    return( ok );
+}
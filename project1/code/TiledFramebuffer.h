@@ -0,0 +1,263 @@
+//
+//  TiledFramebuffer.h
+//
+//  A sparse, tiled RGB framebuffer for very large 2D canvases.
+//
+//  A dense framebuffer for a 32768 x 32768 plot needs several gigabytes,
+//  even though most plots only touch a small part of that area.  This
+//  framebuffer splits the image into 64 x 64 pixel tiles, and only
+//  allocates a tile when a pixel in it is first written; tiles that
+//  were never written read back as the background color.  Memory use
+//  therefore follows the area actually covered by drawing, not the
+//  dimensions of the canvas.
+//
+//  In addition:
+//
+//    - clear() and fillRect() work a tile at a time, releasing tiles
+//      (or replacing them with single-run tiles) instead of touching
+//      every pixel.
+//    - compressTiles() run-length encodes the allocated tiles; a
+//      compressed tile is expanded again the next time it is written.
+//    - Finished tiles can be streamed to a file with openStream(),
+//      streamTiles() and closeStream(), releasing their memory; the
+//      resulting tile file can be turned into a PPM image with
+//      streamToPPM() without ever holding the whole image in memory.
+//
+//  Pixel coordinates follow the Canvas convention:  (0,0) is the
+//  lower-left corner of the image.
+//
+
+#ifndef TILEDFRAMEBUFFER_H_
+#define TILEDFRAMEBUFFER_H_
+
+#include <cstdio>
+#include <vector>
+
+#include "Types.h"
+#include "PixelSink.h"
+
+using namespace std;
+
+///
+/// Sparse tiled 8-bit RGB framebuffer
+///
+
+class TiledFramebuffer : public PixelSink {
+
+public:
+
+    // tile dimensions (tiles are square)
+    enum { TILE_SHIFT = 6, TILE_SIZE = 1 << TILE_SHIFT };
+
+private:
+
+    //
+    // One tile.  Exactly one of these holds the pixels:
+    //
+    //   pixels   TILE_SIZE * TILE_SIZE RGB triples, rows bottom to top
+    //   runs     (length, 0xRRGGBB) pairs covering the tile in the
+    //            same order
+    //
+    struct Tile {
+        vector<unsigned char> pixels;
+        vector<unsigned int> runs;
+    };
+
+    // image dimensions
+    int width;
+    int height;
+
+    // image dimensions in tiles
+    int cols;
+    int rows;
+
+    // color of every pixel in a tile that has not been allocated
+    unsigned int background;
+
+    // the tiles, row by row from the bottom; NULL if not allocated
+    vector<Tile *> tiles;
+
+    // tiles that have been written to the stream
+    vector<bool> streamed;
+
+    // the tile stream, if one is open
+    FILE *stream;
+
+    // have we already complained about writes to streamed tiles?
+    bool warned;
+
+    // tile management
+    void freeTiles( void );
+    Tile *writableTile( int tx, int ty );
+    void writeTile( int index );
+
+    // run-length encoding of one tile
+    static void encode( const unsigned char *rgb, vector<unsigned int> &runs );
+    static void expand( const vector<unsigned int> &runs, unsigned char *rgb );
+
+    // the pixels of one tile, expanded into RGB triples
+    void tilePixels( int index, unsigned char *rgb ) const;
+
+    // not copyable (we own the tiles and the stream)
+    TiledFramebuffer( const TiledFramebuffer & );
+    TiledFramebuffer &operator=( const TiledFramebuffer & );
+
+public:
+
+    ///
+    /// Constructor
+    ///
+    /// @param w   width of the framebuffer
+    /// @param h   height of the framebuffer
+    ///
+    TiledFramebuffer( int w = 0, int h = 0 );
+
+    ///
+    /// Destructor
+    ///
+    ~TiledFramebuffer( void );
+
+    ///
+    /// Change the dimensions; all tiles are released, the background
+    /// becomes black, and any open stream is closed
+    ///
+    /// @param w   new width
+    /// @param h   new height
+    ///
+    void resize( int w, int h );
+
+    int getWidth( void ) const { return width; }
+    int getHeight( void ) const { return height; }
+
+    ///
+    /// The whole framebuffer
+    ///
+    Rect bounds( void ) const
+    {
+        Rect r = { 0, 0, width - 1, height - 1 };
+        return r;
+    }
+
+    ///
+    /// Set every pixel to a color by releasing all tiles.  Refused
+    /// while a stream is open, since the stream already holds the old
+    /// background; once it is closed, the tiles it took can be drawn
+    /// again.
+    ///
+    /// @param c   the new background color (alpha is ignored)
+    ///
+    void clear( Color c );
+
+    ///
+    /// Set one pixel; coordinates outside the framebuffer are ignored
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color (alpha is ignored)
+    ///
+    void setPixel( int x, int y, Color c );
+
+    ///
+    /// Set a horizontal run of pixels, x0 <= x < x1, on row y;
+    /// the run is clipped to the framebuffer
+    ///
+    /// @param x0  first x coordinate
+    /// @param x1  one past the last x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color (alpha is ignored)
+    ///
+    void fillSpan( int x0, int x1, int y, Color c );
+
+    ///
+    /// Blend a color into one pixel; coordinates outside the
+    /// framebuffer are ignored
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    /// @param c   the color (alpha is ignored)
+    /// @param a   coverage of the pixel, 0 to 1
+    ///
+    void blendPixel( int x, int y, Color c, float a );
+
+    ///
+    /// Fill a rectangle; tiles that are completely covered are replaced
+    /// by single-run tiles rather than being filled pixel by pixel
+    ///
+    /// @param r   the rectangle (inclusive bounds)
+    /// @param c   the color (alpha is ignored)
+    ///
+    void fillRect( const Rect &r, Color c );
+
+    ///
+    /// Retrieve one pixel as packed 0xRRGGBB
+    ///
+    /// @param x   x coordinate
+    /// @param y   y coordinate
+    ///
+    /// @return the pixel value, or 0 if (x,y) is outside the framebuffer
+    ///
+    unsigned int getPixel( int x, int y ) const;
+
+    ///
+    /// Run-length encode every allocated tile for which that saves memory
+    ///
+    void compressTiles( void );
+
+    ///
+    /// Number of tiles currently allocated
+    ///
+    int tilesAllocated( void ) const;
+
+    ///
+    /// Bytes of memory held by the framebuffer (tiles and tile table)
+    ///
+    size_t memoryUsed( void ) const;
+
+    ///
+    /// Start streaming tiles to a file
+    ///
+    /// @param fname   name of the tile file
+    ///
+    /// @return true on success
+    ///
+    bool openStream( const char *fname );
+
+    ///
+    /// Write every tile lying completely inside a rectangle to the
+    /// stream and release it.  The caller promises that those pixels
+    /// will not be drawn again; later writes to them are ignored.
+    ///
+    /// @param r   the finished area (inclusive bounds)
+    ///
+    void streamTiles( const Rect &r );
+
+    ///
+    /// Write all remaining tiles to the stream and close it
+    ///
+    /// @return true if everything was written successfully
+    ///
+    bool closeStream( void );
+
+    ///
+    /// Write the image as a binary PPM (P6) file
+    ///
+    /// @param fname   name of the output file
+    ///
+    /// @return true on success
+    ///
+    bool writePPM( const char *fname ) const;
+
+    ///
+    /// Convert a tile file written by the streaming functions into a
+    /// binary PPM (P6) file, one row of tiles at a time
+    ///
+    /// @param tname   name of the tile file
+    /// @param pname   name of the output PPM file
+    ///
+    /// @return true on success
+    ///
+    static bool streamToPPM( const char *tname, const char *pname );
+
+};
+
+#endif
@@ -0,0 +1,238 @@
+//
+//  Transform.h
+//
+//  2D transformations that carry their kind in their type.
+//
+//  Most of the transformations the pipeline applies are much simpler
+//  than a general 3x3 matrix:  the viewport mapping is a scale and a
+//  translation, and many model transformations are pure translations.
+//  A Transform2<K> stores an affine transformation
+//
+//      x' = a x + c y + tx
+//      y' = b x + d y + ty
+//
+//  together with its kind K as a template parameter, and
+//  transformPoints() is specialized for each kind, so a translation
+//  costs two adds per vertex and a scale plus translation two
+//  multiply-adds, instead of a full matrix multiply.
+//
+//  When the kind is only known at run time (e.g., for a glm::mat3),
+//  classify() finds the simplest kind that fits and applyTransform()
+//  dispatches to the matching kernel.
+//
+//  Every kernel rounds its results to the nearest integer, exactly as
+//  the original applyMatrix() did, and gives bit-identical results.
+//
+
+#ifndef TRANSFORM_H_
+#define TRANSFORM_H_
+
+#include <math.h>
+
+#include <glm/vec3.hpp>
+#include <glm/mat3x3.hpp>
+
+#include "Types.h"
+
+//
+// Transformation kinds, from the simplest to the most general.
+// Identity, Translate and ScaleTranslate have b = c = 0.
+//
+typedef
+    enum xkinds_e {
+        XIdentity = 0, XTranslate, XScaleTranslate, XRigid, XAffine
+        // Sentinel gives us the number of kinds
+        , N_XKINDS
+    } XformKind;
+
+///
+/// composeKind - the kind of the composition of a transformation of
+/// kind a with one of kind b.  The simpler kinds nest, so this is
+/// usually the larger of the two; the exception is that a rotation
+/// combined with a (possibly non-uniform) scale is a general affine
+/// transformation.  The Pipeline uses it to keep track of the kind of
+/// its current transformation as translate(), rotate() and scale()
+/// build it up.
+///
+inline constexpr XformKind composeKind( XformKind a, XformKind b )
+{
+    return ( (a == XRigid && b == XScaleTranslate) ||
+             (a == XScaleTranslate && b == XRigid) ) ? XAffine
+           : (a > b ? a : b);
+}
+
+static_assert( composeKind( XIdentity, XIdentity ) == XIdentity,
+               "identity composed with identity" );
+static_assert( composeKind( XTranslate, XIdentity ) == XTranslate &&
+               composeKind( XIdentity, XTranslate ) == XTranslate &&
+               composeKind( XTranslate, XTranslate ) == XTranslate,
+               "translations nest" );
+static_assert( composeKind( XTranslate, XScaleTranslate ) == XScaleTranslate &&
+               composeKind( XScaleTranslate, XTranslate ) == XScaleTranslate &&
+               composeKind( XScaleTranslate, XScaleTranslate ) ==
+                   XScaleTranslate,
+               "diagonal transformations stay diagonal" );
+static_assert( composeKind( XRigid, XTranslate ) == XRigid &&
+               composeKind( XTranslate, XRigid ) == XRigid &&
+               composeKind( XRigid, XRigid ) == XRigid,
+               "rotations and translations stay rigid" );
+static_assert( composeKind( XRigid, XScaleTranslate ) == XAffine &&
+               composeKind( XScaleTranslate, XRigid ) == XAffine,
+               "a rotation with a scale is affine" );
+static_assert( composeKind( XAffine, XIdentity ) == XAffine &&
+               composeKind( XIdentity, XAffine ) == XAffine &&
+               composeKind( XAffine, XRigid ) == XAffine,
+               "affine absorbs everything" );
+
+///
+/// A 2D affine transformation of kind K
+///
+template <int K>
+struct Transform2 {
+    float a, b;
+    float c, d;
+    float tx, ty;
+
+    enum { kind = K };
+
+    ///
+    /// Reinterpret a glm matrix as a transformation of this kind; the
+    /// caller is responsible for the matrix actually being of kind K
+    ///
+    static Transform2 fromMatrix( const glm::mat3 &m )
+    {
+        Transform2 t = { m[0][0], m[0][1], m[1][0], m[1][1],
+                         m[2][0], m[2][1] };
+        return t;
+    }
+};
+
+//
+// A scale plus translation, as the viewport mapping uses
+//
+
+inline Transform2<XScaleTranslate> scale2( float sx, float sy,
+                                           float tx = 0.0f,
+                                           float ty = 0.0f )
+{
+    Transform2<XScaleTranslate> t = { sx, 0.0f, 0.0f, sy, tx, ty };
+    return t;
+}
+
+//
+// Batch vertex kernels, one per kind.  Each one transforms the x and
+// y coordinates of n vertices in place and rounds them to integers.
+//
+
+template <int K>
+struct TransformKernel {
+    // rigid and general affine transformations:  full 2x2 plus
+    // translation, in the same order glm uses
+    static void apply( const Transform2<K> &t, int n, Vertex v[] )
+    {
+        for( int i = 0; i < n; ++i ) {
+            float x = t.a * v[i].x + t.c * v[i].y + t.tx;
+            float y = t.b * v[i].x + t.d * v[i].y + t.ty;
+            v[i].x = floor( x + 0.5 );
+            v[i].y = floor( y + 0.5 );
+        }
+    }
+};
+
+template <>
+struct TransformKernel<XIdentity> {
+    static void apply( const Transform2<XIdentity> &, int n, Vertex v[] )
+    {
+        for( int i = 0; i < n; ++i ) {
+            v[i].x = floor( v[i].x + 0.5 );
+            v[i].y = floor( v[i].y + 0.5 );
+        }
+    }
+};
+
+template <>
+struct TransformKernel<XTranslate> {
+    static void apply( const Transform2<XTranslate> &t, int n, Vertex v[] )
+    {
+        for( int i = 0; i < n; ++i ) {
+            v[i].x = floor( (v[i].x + t.tx) + 0.5 );
+            v[i].y = floor( (v[i].y + t.ty) + 0.5 );
+        }
+    }
+};
+
+template <>
+struct TransformKernel<XScaleTranslate> {
+    static void apply( const Transform2<XScaleTranslate> &t, int n,
+                       Vertex v[] )
+    {
+        for( int i = 0; i < n; ++i ) {
+            v[i].x = floor( (t.a * v[i].x + t.tx) + 0.5 );
+            v[i].y = floor( (t.d * v[i].y + t.ty) + 0.5 );
+        }
+    }
+};
+
+///
+/// Transform n vertices in place with the kernel for the kind of t
+///
+/// @param t   the transformation
+/// @param n   number of vertices
+/// @param v   the vertices
+///
+template <int K>
+inline void transformPoints( const Transform2<K> &t, int n, Vertex v[] )
+{
+    TransformKernel<K>::apply( t, n, v );
+}
+
+///
+/// Find the simplest kind that describes a matrix.  Matrices with
+/// off-diagonal terms are reported as XAffine (the rigid and affine
+/// kernels are the same).
+///
+/// @param m   the matrix (the last row is assumed to be 0 0 1)
+///
+inline XformKind classify( const glm::mat3 &m )
+{
+    if( m[0][1] != 0.0f || m[1][0] != 0.0f ) {
+        return XAffine;
+    }
+    if( m[0][0] != 1.0f || m[1][1] != 1.0f ) {
+        return XScaleTranslate;
+    }
+    if( m[2][0] != 0.0f || m[2][1] != 0.0f ) {
+        return XTranslate;
+    }
+    return XIdentity;
+}
+
+///
+/// Transform n vertices in place by a matrix whose kind is known
+/// (or at least bounded) at run time
+///
+/// @param n      number of vertices
+/// @param v      the vertices
+/// @param m      the matrix
+/// @param kind   a kind that describes the matrix
+///
+inline void applyTransform( int n, Vertex v[], const glm::mat3 &m,
+                            XformKind kind )
+{
+    switch( kind ) {
+    case XIdentity:
+        transformPoints( Transform2<XIdentity>::fromMatrix( m ), n, v );
+        break;
+    case XTranslate:
+        transformPoints( Transform2<XTranslate>::fromMatrix( m ), n, v );
+        break;
+    case XScaleTranslate:
+        transformPoints( Transform2<XScaleTranslate>::fromMatrix( m ), n, v );
+        break;
+    default:
+        transformPoints( Transform2<XAffine>::fromMatrix( m ), n, v );
+        break;
+    }
+}
+
+#endif
@@ -21,7 +21,8 @@ LIBDIRS =
 
 # common linker options
 # add "-lSOIL" if using that image library
-LDLIBS = -lGL -lGLEW -lglfw -lm
+# (-pthread is for the worker threads in BatchClipper)
+LDLIBS = -lGL -lGLEW -lglfw -lm -pthread
 
 # language-specific linker options
 # add "-lgsl -lgslcblas" if using GSL
@@ -35,7 +36,9 @@ FMWKS =
 # FMWKS += -framework IOKit -framework CoreVideo
 
 # common compiler flags
-CCFLAGS = -ggdb $(INCLUDE) -DGL_GLEXT_PROTOTYPES
+# add -DPIPELINE_STATS to compile in the Pipeline's counters and
+# stage timers (see PipelineStats.h)
+CCFLAGS = -ggdb -pthread $(INCLUDE) -DGL_GLEXT_PROTOTYPES
 
 # language-specific compiler flags
 CFLAGS = -std=c99 $(CCFLAGS)
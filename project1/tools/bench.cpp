@@ -0,0 +1,1145 @@
+//
+//  bench.cpp
+//
+//  Headless benchmark for the 2D Pipeline.
+//
+//  Runs a set of synthetic polygon workloads through the Pipeline
+//  without creating a window or a GL context, timing each stage of
+//  the drawPoly() sequence separately:
+//
+//      transform   applyMatrix() with the model transformation
+//      clip        clipPolygon() against the clip window
+//      fill        applyViewport() followed by drawPolygon()
+//      output      retrieving the pixel stream from the Canvas
+//                  (what BufferSet::createBuffers() would upload)
+//
+//  With -fixed, the transform, clip and fill stages use the Pipeline's
+//  16.16 fixed-point versions instead.  Either way, the transform stage
+//  includes getting the stored vertices into a working copy (and, in
+//  fixed point, converting them), as drawPoly() does.
+//
+//  A few polygons that reach beyond the +/-32767 range of fixed point,
+//  before or after their transformation, are drawn with drawPoly() in
+//  floating and in fixed point; both must give the same pixels.
+//
+//  The "stars" workload is also drawn into a 32768 x 32768 sparse
+//  tiled framebuffer, to show how much memory that actually takes,
+//  and into a smaller one whose finished tiles are streamed to a file
+//  as it goes; the PPM made from that file must match the one written
+//  from a framebuffer that kept every tile.  The stars are also
+//  clipped against a 16 x 16 grid of tile windows, once with a
+//  clipPolygon() call per (polygon, tile) pair and once with
+//  clipBatch().  Their outlines are also drawn into a framebuffer as a
+//  wireframe, with aliased and with antialiased lines.
+//
+//  A curved shape added with addPath() is drawn at a range of zoom
+//  levels, to show how its vertex count follows its size on screen.
+//
+//  The "large_concave" workload, with a color per polygon, is drawn
+//  into a framebuffer one polygon at a time and then again with a
+//  single renderScene() sweep, to compare the pixels each sends.
+//
+//  The "stars" are also retained with addDraw(), moved a few at a
+//  time with updateDraw() and repainted with redrawDirty(); the result
+//  must match drawing them all again, pixel for pixel.
+//
+//  If a check that two methods draw the same thing fails, a message
+//  goes to standard error and bench exits with status 1.
+//
+//  In a PIPELINE_STATS build, the Pipeline's own counters and stage
+//  times for the last repetition of each workload are included.
+//
+//  All workloads are generated from a fixed seed, so two runs on the
+//  same machine draw exactly the same polygons.  Results are written
+//  to standard output as JSON.
+//
+//  Usage:  bench [-fixed] [reps [seed]]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+
+#include "Pipeline.h"
+#include "TiledFramebuffer.h"
+#include "BatchClipper.h"
+#include "Framebuffer.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// canvas dimensions for every workload
+static const int c_width  = 800;
+static const int c_height = 800;
+
+// dimensions of the sparse canvas
+static const int s_size = 32768;
+
+// tile grid for the batch clipping comparison
+static const int t_grid = 16;
+
+// default number of repetitions and seed
+static const int def_reps = 5;
+static const uint32_t def_seed = 20161019u;
+
+// set when a consistency check fails; bench then exits with status 1
+static bool failed = false;
+
+// a handy clock
+typedef chrono::steady_clock Clock;
+
+//
+// Random numbers
+//
+// We use our own generator rather than <random> so that the
+// workloads are identical across compilers and libraries.
+//
+
+static uint32_t rng_state;
+
+static uint32_t rnd( void )
+{
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+///
+/// Uniform random float in [lo,hi)
+///
+static float rndf( float lo, float hi )
+{
+    return lo + (hi - lo) * ((rnd() >> 8) * (1.0f / 16777216.0f));
+}
+
+//
+// Workload description
+//
+
+struct Workload {
+    const char *name;
+    vector<Polygon> polys;   // polygons, in world coordinates
+    float clip[4];           // bottom, top, left, right
+};
+
+///
+/// Generate a star-shaped (possibly concave) polygon around (cx,cy)
+///
+/// @param cx,cy    center of the polygon
+/// @param n        number of vertices
+/// @param rmin     minimum radius of a vertex
+/// @param rmax     maximum radius of a vertex
+/// @param spikes   if true, alternate between rmax and rmin
+///
+static Polygon radialPoly( float cx, float cy, int n,
+                           float rmin, float rmax, bool spikes )
+{
+    Polygon p;
+    float phase = rndf( 0.0f, (float) (2.0 * MY_PI) );
+
+    for( int i = 0; i < n; ++i ) {
+        float a = phase + (float) (2.0 * MY_PI) * i / n;
+        float r = spikes ? ((i & 1) ? rmin : rmax) : rndf( rmin, rmax );
+        Vertex v = { cx + r * cosf(a), cy + r * sinf(a), 0.0f, 1.0f };
+        p.vertices.push_back( v );
+    }
+
+    return p;
+}
+
+///
+/// Many small triangles scattered over the whole canvas
+///
+static void makeSmallTriangles( Workload &w )
+{
+    w.name = "small_triangles";
+    for( int i = 0; i < 20000; ++i ) {
+        float x = rndf( 8.0f, c_width - 8.0f );
+        float y = rndf( 8.0f, c_height - 8.0f );
+        Polygon p;
+        for( int k = 0; k < 3; ++k ) {
+            Vertex v = { x + rndf( -6.0f, 6.0f ), y + rndf( -6.0f, 6.0f ),
+                         0.0f, 1.0f };
+            p.vertices.push_back( v );
+        }
+        w.polys.push_back( p );
+    }
+}
+
+///
+/// A few large concave polygons with many vertices
+///
+static void makeConcave( Workload &w )
+{
+    w.name = "large_concave";
+    for( int i = 0; i < 200; ++i ) {
+        float cx = rndf( 200.0f, c_width - 200.0f );
+        float cy = rndf( 200.0f, c_height - 200.0f );
+        w.polys.push_back( radialPoly( cx, cy, 64, 60.0f, 190.0f, false ) );
+    }
+}
+
+///
+/// Medium-sized stars with 5 to 12 points
+///
+static void makeStars( Workload &w )
+{
+    w.name = "stars";
+    for( int i = 0; i < 2000; ++i ) {
+        float cx = rndf( 40.0f, c_width - 40.0f );
+        float cy = rndf( 40.0f, c_height - 40.0f );
+        int points = 5 + (int) (rnd() % 8);
+        w.polys.push_back( radialPoly( cx, cy, 2 * points,
+                                       12.0f, 36.0f, true ) );
+    }
+}
+
+///
+/// Polygons centered outside the clip window that only graze it
+///
+static void makeMostlyOutside( Workload &w )
+{
+    w.name = "mostly_outside";
+    for( int i = 0; i < 2000; ++i ) {
+        float cx, cy;
+        // pick a side, then a center just beyond it
+        switch( rnd() % 4 ) {
+        case 0:  cx = rndf( -90.0f, -20.0f );
+                 cy = rndf( 0.0f, c_height ); break;
+        case 1:  cx = rndf( c_width + 20.0f, c_width + 90.0f );
+                 cy = rndf( 0.0f, c_height ); break;
+        case 2:  cx = rndf( 0.0f, c_width );
+                 cy = rndf( -90.0f, -20.0f ); break;
+        default: cx = rndf( 0.0f, c_width );
+                 cy = rndf( c_height + 20.0f, c_height + 90.0f ); break;
+        }
+        w.polys.push_back( radialPoly( cx, cy, 12, 40.0f, 100.0f, false ) );
+    }
+}
+
+//
+// Timing results for one workload
+//
+
+struct Timing {
+    double transform, clip, fill, output;   // seconds
+    long polys, emitted, pixels;
+};
+
+static double secs( Clock::time_point a, Clock::time_point b )
+{
+    return chrono::duration<double>( b - a ).count();
+}
+
+///
+/// Load a polygon's stored vertices for the transform stage:  a plain
+/// copy in floating point, a conversion in fixed point
+///
+static void loadVertices( vector<Vertex> &dst, const vector<Vertex> &src )
+{
+    dst = src;
+}
+
+static void loadVertices( vector<FixedVertex> &dst,
+                          const vector<Vertex> &src )
+{
+    dst.resize( src.size() );
+    for( size_t k = 0; k < src.size(); ++k ) {
+        dst[k].x = toFixed( src[k].x );
+        dst[k].y = toFixed( src[k].y );
+    }
+}
+
+///
+/// Run one workload through the pipeline, one stage at a time, with
+/// vertices of type V and a model transformation of type M
+///
+/// Each stage is applied to every polygon before the next stage
+/// starts, so that the clock is only read at stage boundaries.  The
+/// transform stage includes getting the stored vertices into a
+/// working copy, as drawPoly() must.
+///
+/// @param P    the pipeline
+/// @param w    the workload
+/// @param ll   lower-left corner of the clip window
+/// @param ur   upper-right corner of the clip window
+/// @param m    the model transformation
+///
+template <class V, class M>
+static Timing runStages( Pipeline &P, const Workload &w,
+                         const V &ll, const V &ur, const M &m )
+{
+    Timing t;
+    memset( &t, 0, sizeof(t) );
+
+    size_t np = w.polys.size();
+    vector<vector<V> > xformed( np );
+    vector<vector<V> > clipped( np );
+    vector<int> counts( np );
+
+    P.clear();
+    Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+    P.setColor( white );
+
+    // transform
+    Clock::time_point t0 = Clock::now();
+    for( size_t i = 0; i < np; ++i ) {
+        loadVertices( xformed[i], w.polys[i].vertices );
+        applyMatrix( xformed[i].size(), &xformed[i][0], m );
+    }
+
+    // clip; every input edge can cross each of the four clip
+    // boundaries once, so 5n vertices is a safe upper bound
+    Clock::time_point t1 = Clock::now();
+    for( size_t i = 0; i < np; ++i ) {
+        clipped[i].resize( 5 * xformed[i].size() + 4 );
+        counts[i] = clipPolygon( xformed[i].size(), &xformed[i][0],
+                                 &clipped[i][0], ll, ur );
+    }
+
+    // viewport and scan conversion
+    Clock::time_point t2 = Clock::now();
+    for( size_t i = 0; i < np; ++i ) {
+        if( counts[i] < 3 ) {
+            continue;
+        }
+        P.applyViewport( counts[i], &clipped[i][0] );
+        P.drawPolygon( counts[i], &clipped[i][0] );
+        t.emitted++;
+    }
+
+    // pixel stream retrieval
+    Clock::time_point t3 = Clock::now();
+    const float *pts = P.getVertices();
+    const float *cols = P.getColors();
+    Clock::time_point t4 = Clock::now();
+
+    // keep the compiler honest
+    if( pts != NULL && cols != NULL && pts[0] < -1.0e30f ) {
+        cerr << "impossible" << endl;
+    }
+
+    t.transform = secs( t0, t1 );
+    t.clip      = secs( t1, t2 );
+    t.fill      = secs( t2, t3 );
+    t.output    = secs( t3, t4 );
+    t.polys     = np;
+    t.pixels    = P.numVertices();
+
+    return t;
+}
+
+///
+/// Run one workload through the pipeline in floating or fixed point,
+/// with a mild model transformation so applyMatrix() does real work
+///
+/// @param P            the pipeline
+/// @param w            the workload
+/// @param fixedPoint   use the 16.16 fixed-point stages
+///
+static Timing runOnce( Pipeline &P, const Workload &w, bool fixedPoint )
+{
+    if( fixedPoint ) {
+        FixedVertex ll = { toFixed( w.clip[2] ), toFixed( w.clip[0] ) };
+        FixedVertex ur = { toFixed( w.clip[3] ), toFixed( w.clip[1] ) };
+        return runStages( P, w, ll, ur, fixTranslate( FIX_HALF, -FIX_HALF ) );
+    }
+
+    Vertex ll = { w.clip[2], w.clip[0], 0.0f, 1.0f };
+    Vertex ur = { w.clip[3], w.clip[1], 0.0f, 1.0f };
+    glm::mat3 m( 1.0f );
+    m[2] = glm::vec3( 0.5f, -0.5f, 1.0f );
+    return runStages( P, w, ll, ur, m );
+}
+
+///
+/// Draw a workload into a very large sparse framebuffer, scattering
+/// copies of the polygons along its diagonal, and report the time
+/// taken and the memory used
+///
+static void runSparse( Pipeline &P, const Workload &w )
+{
+    TiledFramebuffer fb( s_size, s_size );
+    Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
+    Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+    fb.clear( black );
+    P.setColor( white );
+    P.setSink( &fb );
+
+    vector<Vertex> v;
+    Clock::time_point t0 = Clock::now();
+    for( size_t i = 0; i < w.polys.size(); ++i ) {
+        // the polygons were rounded when they were generated
+        float offset = (float) ((i % 32) * (s_size / 32));
+        v = w.polys[i].vertices;
+        for( size_t k = 0; k < v.size(); ++k ) {
+            v[k].x += offset;
+            v[k].y += offset;
+        }
+        P.drawPolygon( v.size(), &v[0] );
+    }
+    Clock::time_point t1 = Clock::now();
+    size_t raw = fb.memoryUsed();
+    int tiles = fb.tilesAllocated();
+    fb.compressTiles();
+    Clock::time_point t2 = Clock::now();
+
+    P.setSink( NULL );
+
+    cout << "  \"sparse\": {" << endl;
+    cout << "    \"workload\": \"" << w.name << "\"," << endl;
+    cout << "    \"canvas\": [ " << s_size << ", " << s_size << " ],"
+         << endl;
+    cout << "    \"dense_bytes\": " << 3LL * s_size * s_size << "," << endl;
+    cout << "    \"tiles\": " << tiles << "," << endl;
+    cout << "    \"bytes\": " << raw << "," << endl;
+    cout << "    \"compressed_bytes\": " << fb.memoryUsed() << "," << endl;
+    cout << "    \"fill_seconds\": " << secs( t0, t1 ) << "," << endl;
+    cout << "    \"compress_seconds\": " << secs( t1, t2 ) << endl;
+    cout << "  }," << endl;
+}
+
+///
+/// Compare two files byte for byte
+///
+/// @return true if both could be read and are identical
+///
+static bool sameFile( const char *a, const char *b )
+{
+    FILE *fa = fopen( a, "rb" );
+    FILE *fb = fopen( b, "rb" );
+    bool same = fa != NULL && fb != NULL;
+
+    while( same ) {
+        int ca = fgetc( fa ), cb = fgetc( fb );
+        same = ca == cb;
+        if( ca == EOF ) {
+            break;
+        }
+    }
+
+    if( fa ) fclose( fa );
+    if( fb ) fclose( fb );
+    return( same );
+}
+
+///
+/// Draw a workload into a sparse framebuffer twice, once keeping every
+/// tile and writing it with writePPM(), and once streaming each band
+/// of tiles to a tile file as soon as nothing more will be drawn in it
+/// and converting that with streamToPPM(); the two images must be the
+/// same, byte for byte
+///
+static void runStream( Pipeline &P, const Workload &w )
+{
+    const int size = 2048, bands = 32, step = size / bands;
+    const char *kept = "bench-kept.ppm";
+    const char *tiles = "bench-stream.tiles";
+    const char *streamed = "bench-stream.ppm";
+    Color gray = { 0.25f, 0.25f, 0.25f, 1.0f };
+    Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    TiledFramebuffer whole( size, size ), part( size, size );
+    whole.clear( gray );
+    part.clear( gray );
+    P.setColor( white );
+    if( !part.openStream( tiles ) ) {
+        failed = true;
+        return;
+    }
+
+    // copies of the polygons are scattered along the diagonal, one band
+    // at a time from the bottom up; no later band reaches below its own
+    // offset, so everything below that is finished
+    vector<Vertex> v;
+    size_t peak = 0;
+    for( int b = 0; b < bands; ++b ) {
+        float offset = (float) (b * step);
+        for( size_t i = b; i < w.polys.size(); i += bands ) {
+            v = w.polys[i].vertices;
+            for( size_t k = 0; k < v.size(); ++k ) {
+                v[k].x += offset;
+                v[k].y += offset;
+            }
+            P.setSink( &whole );
+            P.drawPolygon( v.size(), &v[0] );
+            P.setSink( &part );
+            P.drawPolygon( v.size(), &v[0] );
+        }
+        peak = max( peak, part.memoryUsed() );
+        Rect done = { 0, 0, size - 1, (b + 1) * step - 1 };
+        part.streamTiles( done );
+    }
+    P.setSink( NULL );
+
+    bool ok = part.closeStream() && whole.writePPM( kept ) &&
+              TiledFramebuffer::streamToPPM( tiles, streamed ) &&
+              sameFile( kept, streamed );
+
+    cout << "  \"stream\": {" << endl;
+    cout << "    \"workload\": \"" << w.name << "\"," << endl;
+    cout << "    \"canvas\": [ " << size << ", " << size << " ]," << endl;
+    cout << "    \"kept_bytes\": " << whole.memoryUsed() << "," << endl;
+    cout << "    \"streamed_peak_bytes\": " << peak << "," << endl;
+    cout << "    \"identical\": " << (ok ? "true" : "false") << endl;
+    cout << "  }," << endl;
+
+    if( !ok ) {
+        cerr << "streamToPPM() disagrees with writePPM()" << endl;
+        failed = true;
+    }
+
+    remove( kept );
+    remove( tiles );
+    remove( streamed );
+}
+
+///
+/// Clip a workload against a grid of tile windows, first one polygon
+/// and one tile at a time with clipPolygon(), then all at once with
+/// clipBatch(), and check that both give the same polygons
+///
+static void runTiles( const Workload &w, int reps )
+{
+    // tiles overlap their neighbors by nothing; each one includes its
+    // upper and right edges, as the clip window does
+    vector<Vertex> corners( 2 * t_grid * t_grid );
+    Vertex (*tiles)[2] = (Vertex (*)[2]) &corners[0];
+    float tw = (float) c_width / t_grid;
+    float th = (float) c_height / t_grid;
+    for( int r = 0; r < t_grid; ++r ) {
+        for( int c = 0; c < t_grid; ++c ) {
+            Vertex ll = { c * tw, r * th, 0.0f, 1.0f };
+            Vertex ur = { (c + 1) * tw - 1.0f, (r + 1) * th - 1.0f,
+                          0.0f, 1.0f };
+            tiles[r * t_grid + c][0] = ll;
+            tiles[r * t_grid + c][1] = ur;
+        }
+    }
+    int nt = t_grid * t_grid;
+
+    PolygonBatch batch;
+    for( size_t i = 0; i < w.polys.size(); ++i ) {
+        const vector<Vertex> &v = w.polys[i].vertices;
+        batch.add( v.size(), &v[0] );
+    }
+
+    // one call per pair
+    vector<Vertex> out;
+    long scalarPolys = 0, scalarVerts = 0;
+    double scalar = 0.0;
+    for( int rep = 0; rep < reps; ++rep ) {
+        scalarPolys = scalarVerts = 0;
+        Clock::time_point t0 = Clock::now();
+        for( int k = 0; k < nt; ++k ) {
+            for( size_t i = 0; i < w.polys.size(); ++i ) {
+                const vector<Vertex> &v = w.polys[i].vertices;
+                out.resize( 5 * v.size() + 4 );
+                int n = clipPolygon( v.size(), &v[0], &out[0],
+                                     tiles[k][0], tiles[k][1] );
+                if( n > 0 ) {
+                    scalarPolys++;
+                    scalarVerts += n;
+                }
+            }
+        }
+        double s = secs( t0, Clock::now() );
+        scalar = (rep == 0) ? s : min( scalar, s );
+    }
+
+    // the batch clipper, single-threaded and with a thread per core
+    ClipResults res;
+    double single = 0.0, multi = 0.0;
+    for( int rep = 0; rep < reps; ++rep ) {
+        Clock::time_point t0 = Clock::now();
+        clipBatch( batch, nt, tiles, res, 1 );
+        Clock::time_point t1 = Clock::now();
+        clipBatch( batch, nt, tiles, res );
+        Clock::time_point t2 = Clock::now();
+        single = (rep == 0) ? secs( t0, t1 ) : min( single, secs( t0, t1 ) );
+        multi = (rep == 0) ? secs( t1, t2 ) : min( multi, secs( t1, t2 ) );
+    }
+
+    // compare every clipped polygon
+    long mismatches = 0;
+    vector<Vertex> mine;
+    for( int k = 0; k < nt; ++k ) {
+        int c = res.window[k];
+        for( size_t i = 0; i < w.polys.size(); ++i ) {
+            const vector<Vertex> &v = w.polys[i].vertices;
+            out.resize( 5 * v.size() + 4 );
+            int n = clipPolygon( v.size(), &v[0], &out[0],
+                                 tiles[k][0], tiles[k][1] );
+            if( n == 0 ) {
+                continue;
+            }
+            if( c >= res.window[k + 1] || res.source[c] != (int) i ) {
+                mismatches++;
+                continue;
+            }
+            mine.resize( res.first[c + 1] - res.first[c] );
+            int m = res.vertices( c, &mine[0] );
+            ++c;
+            bool same = (m == n);
+            for( int j = 0; same && j < n; ++j ) {
+                same = mine[j].x == out[j].x && mine[j].y == out[j].y;
+            }
+            if( !same ) {
+                mismatches++;
+            }
+        }
+        if( c != res.window[k + 1] ) {
+            mismatches++;
+        }
+    }
+
+    cout << "  \"tiles\": {" << endl;
+    cout << "    \"workload\": \"" << w.name << "\"," << endl;
+    cout << "    \"windows\": " << nt << "," << endl;
+    cout << "    \"clipped_polygons\": " << res.size() << "," << endl;
+    cout << "    \"clipped_vertices\": " << res.x.size() << "," << endl;
+    cout << "    \"mismatches\": " << mismatches << "," << endl;
+    cout << "    \"scalar_seconds\": " << scalar << "," << endl;
+    cout << "    \"batch_seconds\": " << single << "," << endl;
+    cout << "    \"batch_threaded_seconds\": " << multi << endl;
+    cout << "  }," << endl;
+
+    if( scalarPolys != res.size() || scalarVerts != (long) res.x.size() ) {
+        cerr << "batch clipper disagrees with clipPolygon()" << endl;
+    }
+}
+
+///
+/// Draw the outlines of a workload's polygons into a framebuffer, once
+/// with each line mode, and report the time and pixels for each
+///
+static void runLines( Pipeline &P, const Workload &w, int reps )
+{
+    Framebuffer fb( c_width, c_height );
+    Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
+    Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // every edge of every polygon, as one batch of segments
+    vector<Vertex> seg;
+    for( size_t i = 0; i < w.polys.size(); ++i ) {
+        const vector<Vertex> &v = w.polys[i].vertices;
+        for( size_t k = 0; k < v.size(); ++k ) {
+            seg.push_back( v[k] );
+            seg.push_back( v[(k + 1) % v.size()] );
+        }
+    }
+    int nseg = seg.size() / 2;
+
+    P.setSink( &fb );
+    P.setColor( white );
+
+    cout << "  \"lines\": {" << endl;
+    cout << "    \"workload\": \"" << w.name << "\"," << endl;
+    cout << "    \"segments\": " << nseg << "," << endl;
+
+    for( int m = 0; m < N_LINEMODES; ++m ) {
+        P.setLineMode( (LineMode) m );
+        double best = 0.0;
+        for( int rep = 0; rep < reps; ++rep ) {
+            fb.clear( black );
+            Clock::time_point t0 = Clock::now();
+            P.drawLines( nseg, &seg[0] );
+            double s = secs( t0, Clock::now() );
+            best = (rep == 0) ? s : min( best, s );
+        }
+
+        long lit = 0;
+        for( int y = 0; y < c_height; ++y ) {
+            for( int x = 0; x < c_width; ++x ) {
+                lit += fb.getPixel( x, y ) != 0;
+            }
+        }
+
+        cout << "    \"" << (m == LineAliased ? "aliased" : "smooth")
+             << "\": { \"seconds\": " << best
+             << ", \"segments_per_sec\": " << (best > 0.0 ? nseg / best : 0.0)
+             << ", \"pixels_lit\": " << lit << " }"
+             << (m < N_LINEMODES - 1 ? "," : "") << endl;
+    }
+    cout << "  }," << endl;
+
+    P.setLineMode( LineAliased );
+    P.setSink( NULL );
+}
+
+///
+/// Draw a curved shape at zoom levels from 1/16 to 16 and report the
+/// number of vertices it was flattened to at each, and the time taken
+///
+static void runCurves( Pipeline &P, int reps )
+{
+    // a rounded blob:  cubic petals around a center, closed by a
+    // quadratic and an arc
+    Path path;
+    path.moveTo( 40.0f, 0.0f );
+    for( int i = 0; i < 5; ++i ) {
+        float a0 = (float) (2.0 * MY_PI * i / 6);
+        float a1 = (float) (2.0 * MY_PI * (i + 1) / 6);
+        path.cubicTo( 70.0f * cosf( a0 + 0.3f ), 70.0f * sinf( a0 + 0.3f ),
+                      70.0f * cosf( a1 - 0.3f ), 70.0f * sinf( a1 - 0.3f ),
+                      40.0f * cosf( a1 ), 40.0f * sinf( a1 ) );
+    }
+    path.quadTo( 30.0f, -50.0f, 40.0f, -20.0f );
+    path.arc( 0.0f, 0.0f, 40.0f, -30.0f, 0.0f );
+    int id = P.addPath( path );
+
+    P.clear();
+    Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+    P.setColor( white );
+
+    cout << "  \"curves\": [" << endl;
+    for( int z = -4; z <= 4; ++z ) {
+        float zoom = powf( 2.0f, (float) z );
+
+        // scale about the origin, then move to the middle
+        P.clearTransform();
+        P.scale( zoom, zoom );
+        P.translate( c_width / 2.0f, c_height / 2.0f );
+
+        double best = 0.0;
+        int before = P.numVertices();
+        for( int rep = 0; rep < reps; ++rep ) {
+            Clock::time_point t0 = Clock::now();
+            P.drawPoly( id );
+            double s = secs( t0, Clock::now() );
+            best = (rep == 0) ? s : min( best, s );
+        }
+
+        cout << "    { \"zoom\": " << zoom
+             << ", \"vertices\": " << P.polyVertexCount( id )
+             << ", \"pixels\": " << (P.numVertices() - before) / reps
+             << ", \"seconds\": " << best << " }"
+             << (z < 4 ? "," : "") << endl;
+    }
+    cout << "  ]," << endl;
+
+    P.clearTransform();
+    P.clear();
+}
+
+///
+/// A pixel sink that counts the pixels it is sent before passing them
+/// on to a framebuffer
+///
+class CountingSink : public PixelSink {
+    Framebuffer &fb;
+
+public:
+    long pixels;
+
+    CountingSink( Framebuffer &f ) : fb( f ), pixels( 0 ) { }
+
+    Rect bounds( void ) const { return fb.bounds(); }
+
+    void setPixel( int x, int y, Color c ) {
+        ++pixels;
+        fb.setPixel( x, y, c );
+    }
+
+    void fillSpan( int x0, int x1, int y, Color c ) {
+        pixels += x1 - x0;
+        fb.fillSpan( x0, x1, y, c );
+    }
+};
+
+///
+/// Draw a deeply layered scene once polygon by polygon and once with
+/// renderScene(), into a framebuffer and into the Canvas, and report
+/// the time and pixels sent for each, and whether the two pictures
+/// differ
+///
+static void runScene( Pipeline &P, const Workload &w, int reps )
+{
+    Framebuffer painter( c_width, c_height ), scene( c_width, c_height );
+    CountingSink pSink( painter ), sSink( scene );
+    Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    // every polygon in its own color
+    int np = w.polys.size();
+    vector<int> ids( np );
+    vector<Color> colors( np );
+    P.clearDraws();
+    for( int i = 0; i < np; ++i ) {
+        const vector<Vertex> &v = w.polys[i].vertices;
+        ids[i] = P.addPoly( v.size(), &v[0] );
+        Color c = { rndf( 0.1f, 1.0f ), rndf( 0.1f, 1.0f ),
+                    rndf( 0.1f, 1.0f ), 1.0f };
+        colors[i] = c;
+        P.setColor( c );
+        P.addDraw( ids[i], false );
+    }
+
+    double bestP = 0.0, bestS = 0.0;
+    for( int rep = 0; rep < reps; ++rep ) {
+        painter.clear( black );
+        pSink.pixels = 0;
+        P.setSink( &pSink );
+        Clock::time_point t0 = Clock::now();
+        for( int i = 0; i < np; ++i ) {
+            P.setColor( colors[i] );
+            P.drawPoly( ids[i] );
+        }
+        double s = secs( t0, Clock::now() );
+        bestP = (rep == 0) ? s : min( bestP, s );
+
+        scene.clear( black );
+        sSink.pixels = 0;
+        P.setSink( &sSink );
+        t0 = Clock::now();
+        P.renderScene();
+        s = secs( t0, Clock::now() );
+        bestS = (rep == 0) ? s : min( bestS, s );
+    }
+    P.setSink( NULL );
+
+    // the same again into the Canvas pixel stream, where every pixel
+    // sent has a cost
+    double canvasP = 0.0, canvasS = 0.0;
+    for( int rep = 0; rep < reps; ++rep ) {
+        P.clear();
+        Clock::time_point t0 = Clock::now();
+        for( int i = 0; i < np; ++i ) {
+            P.setColor( colors[i] );
+            P.drawPoly( ids[i] );
+        }
+        double s = secs( t0, Clock::now() );
+        canvasP = (rep == 0) ? s : min( canvasP, s );
+
+        P.clear();
+        t0 = Clock::now();
+        P.renderScene();
+        s = secs( t0, Clock::now() );
+        canvasS = (rep == 0) ? s : min( canvasS, s );
+    }
+    P.clear();
+    P.clearDraws();
+
+    long differ = 0;
+    for( int y = 0; y < c_height; ++y ) {
+        for( int x = 0; x < c_width; ++x ) {
+            differ += painter.getPixel( x, y ) != scene.getPixel( x, y );
+        }
+    }
+
+    cout << "  \"scene\": {" << endl;
+    cout << "    \"workload\": \"" << w.name << "\"," << endl;
+    cout << "    \"polygons\": " << np << "," << endl;
+    cout << "    \"painter\": { \"seconds\": " << bestP
+         << ", \"canvas_seconds\": " << canvasP
+         << ", \"pixels\": " << pSink.pixels << " }," << endl;
+    cout << "    \"single_sweep\": { \"seconds\": " << bestS
+         << ", \"canvas_seconds\": " << canvasS
+         << ", \"pixels\": " << sSink.pixels << " }," << endl;
+    cout << "    \"differing_pixels\": " << differ << endl;
+    cout << "  }," << endl;
+}
+
+///
+/// Retain a workload's polygons as drawings, move a few of them at a
+/// time with updateDraw() and repaint with redrawDirty(), and compare
+/// the result with drawing everything again from scratch
+///
+static void runRedraw( Pipeline &P, const Workload &w )
+{
+    Framebuffer inc( c_width, c_height ), full( c_width, c_height );
+    Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    // every polygon in its own color, at its own offset
+    int np = w.polys.size();
+    vector<int> ids( np );
+    vector<Color> colors( np );
+    vector<float> dx( np, 0.0f ), dy( np, 0.0f );
+    inc.clear( black );
+    P.setSink( &inc );
+    P.clearDraws();
+    for( int i = 0; i < np; ++i ) {
+        const vector<Vertex> &v = w.polys[i].vertices;
+        ids[i] = P.addPoly( v.size(), &v[0] );
+        Color c = { rndf( 0.1f, 1.0f ), rndf( 0.1f, 1.0f ),
+                    rndf( 0.1f, 1.0f ), 1.0f };
+        colors[i] = c;
+        P.setColor( c );
+        P.addDraw( ids[i] );
+    }
+
+    // ten rounds, moving 20 drawings in each
+    const int rounds = 10, moves = 20;
+    double incS = 0.0;
+    for( int rep = 0; rep < rounds; ++rep ) {
+        for( int k = 0; k < moves; ++k ) {
+            int i = rnd() % np;
+            dx[i] += rndf( -40.0f, 40.0f );
+            dy[i] += rndf( -40.0f, 40.0f );
+            P.clearTransform();
+            P.translate( dx[i], dy[i] );
+            P.setColor( colors[i] );
+            P.updateDraw( i );
+        }
+        Clock::time_point t0 = Clock::now();
+        P.redrawDirty( black );
+        double s = secs( t0, Clock::now() );
+        incS = (rep == 0) ? s : min( incS, s );
+    }
+
+    // the same picture, drawn in full
+    full.clear( black );
+    P.setSink( &full );
+    Clock::time_point t0 = Clock::now();
+    for( int i = 0; i < np; ++i ) {
+        P.clearTransform();
+        P.translate( dx[i], dy[i] );
+        P.setColor( colors[i] );
+        P.drawPoly( ids[i] );
+    }
+    double fullS = secs( t0, Clock::now() );
+    P.clearTransform();
+    P.setSink( NULL );
+    P.clearDraws();
+
+    long differ = 0;
+    for( int y = 0; y < c_height; ++y ) {
+        for( int x = 0; x < c_width; ++x ) {
+            differ += inc.getPixel( x, y ) != full.getPixel( x, y );
+        }
+    }
+
+    cout << "  \"redraw\": {" << endl;
+    cout << "    \"workload\": \"" << w.name << "\"," << endl;
+    cout << "    \"drawings\": " << np << "," << endl;
+    cout << "    \"rounds\": " << rounds << "," << endl;
+    cout << "    \"moved_per_round\": " << moves << "," << endl;
+    cout << "    \"incremental_seconds\": " << incS << "," << endl;
+    cout << "    \"full_seconds\": " << fullS << "," << endl;
+    cout << "    \"differing_pixels\": " << differ << endl;
+    cout << "  }," << endl;
+
+    if( differ != 0 ) {
+        cerr << "redrawDirty() disagrees with a full redraw" << endl;
+        failed = true;
+    }
+}
+
+///
+/// Draw polygons whose coordinates, before or after the model
+/// transformation, are beyond what 16.16 fixed point can hold, once in
+/// floating point and once in fixed point, and check that both draw
+/// the same pixels
+///
+static void runWide( Pipeline &P )
+{
+    // a band from x = -100 to 40000, a triangle reaching far outside
+    // on both axes, and a small square stretched 1000 times along x
+    Vertex band[4] = { { -100.0f, 100.0f, 0.0f, 1.0f },
+                       { 40000.0f, 100.0f, 0.0f, 1.0f },
+                       { 40000.0f, 400.0f, 0.0f, 1.0f },
+                       { -100.0f, 400.0f, 0.0f, 1.0f } };
+    Vertex tri[3] = { { 50.0f, 700.0f, 0.0f, 1.0f },
+                      { 60000.0f, -50000.0f, 0.0f, 1.0f },
+                      { 600.0f, 780.0f, 0.0f, 1.0f } };
+    Vertex square[4] = { { 0.0f, 500.0f, 0.0f, 1.0f },
+                         { 40.0f, 500.0f, 0.0f, 1.0f },
+                         { 40.0f, 540.0f, 0.0f, 1.0f },
+                         { 0.0f, 540.0f, 0.0f, 1.0f } };
+    int ids[3] = { P.addPoly( 4, band ), P.addPoly( 3, tri ),
+                   P.addPoly( 4, square ) };
+    float stretch[3] = { 1.0f, 1.0f, 1000.0f };
+
+    Framebuffer fb[N_ARITH] = { Framebuffer( c_width, c_height ),
+                                Framebuffer( c_width, c_height ) };
+    Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
+    Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+    long lit[N_ARITH] = { 0, 0 };
+
+    P.setColor( white );
+    Arithmetic old = P.setArithmetic( ArithFloat );
+    for( int a = 0; a < N_ARITH; ++a ) {
+        P.setArithmetic( (Arithmetic) a );
+        fb[a].clear( black );
+        P.setSink( &fb[a] );
+        for( int i = 0; i < 3; ++i ) {
+            P.clearTransform();
+            P.scale( stretch[i], 1.0f );
+            P.drawPoly( ids[i] );
+        }
+        for( int y = 0; y < c_height; ++y ) {
+            for( int x = 0; x < c_width; ++x ) {
+                lit[a] += fb[a].getPixel( x, y ) != 0;
+            }
+        }
+    }
+    P.clearTransform();
+    P.setSink( NULL );
+    P.setArithmetic( old );
+
+    long differ = 0;
+    for( int y = 0; y < c_height; ++y ) {
+        for( int x = 0; x < c_width; ++x ) {
+            differ += fb[ArithFloat].getPixel( x, y ) !=
+                      fb[ArithFixed].getPixel( x, y );
+        }
+    }
+
+    cout << "  \"wide\": {" << endl;
+    cout << "    \"polygons\": 3," << endl;
+    cout << "    \"float_pixels\": " << lit[ArithFloat] << "," << endl;
+    cout << "    \"fixed_pixels\": " << lit[ArithFixed] << "," << endl;
+    cout << "    \"differing_pixels\": " << differ << endl;
+    cout << "  }," << endl;
+
+    if( differ != 0 ) {
+        cerr << "fixed point draws out-of-range polygons differently"
+             << endl;
+        failed = true;
+    }
+}
+
+///
+/// Print one stage's JSON object
+///
+static void stageJSON( const char *name, double s, long polys, long pixels,
+                       bool last )
+{
+    cout << "        \"" << name << "\": { \"seconds\": " << s
+         << ", \"polys_per_sec\": " << (s > 0.0 ? polys / s : 0.0)
+         << ", \"pixels_per_sec\": " << (s > 0.0 ? pixels / s : 0.0)
+         << ", \"ns_per_pixel\": " << (pixels > 0 ? s * 1.0e9 / pixels : 0.0)
+         << " }" << (last ? "" : ",") << endl;
+}
+
+///
+/// Main program
+///
+/// @param argc   command-line argument count
+/// @param argv   command-line argument strings
+///
+int main( int argc, char *argv[] )
+{
+    int reps = def_reps;
+    uint32_t seed = def_seed;
+    bool fixedPoint = false;
+
+    if( argc > 1 && strcmp( argv[1], "-fixed" ) == 0 ) {
+        fixedPoint = true;
+        --argc;
+        ++argv;
+    }
+    if( argc > 1 ) {
+        reps = atoi( argv[1] );
+        if( reps < 1 ) {
+            cerr << "Bad repetition count '" << argv[1] << "'" << endl;
+            exit( 1 );
+        }
+    }
+    if( argc > 2 ) {
+        seed = (uint32_t) strtoul( argv[2], NULL, 10 );
+    }
+
+    // xorshift must never be seeded with zero
+    rng_state = seed ? seed : def_seed;
+
+    Workload w[4];
+    makeSmallTriangles( w[0] );
+    makeConcave( w[1] );
+    makeStars( w[2] );
+    makeMostlyOutside( w[3] );
+
+    Pipeline P( c_width, c_height );
+    P.setViewport( 0, 0, c_width, c_height );
+
+    for( int i = 0; i < 4; ++i ) {
+        w[i].clip[0] = 0.0f;
+        w[i].clip[1] = (float) (c_height - 1);
+        w[i].clip[2] = 0.0f;
+        w[i].clip[3] = (float) (c_width - 1);
+
+        // store the polygons the same way an application would
+        for( size_t k = 0; k < w[i].polys.size(); ++k ) {
+            vector<Vertex> &v = w[i].polys[k].vertices;
+            P.addPoly( v.size(), &v[0] );
+            for( size_t j = 0; j < v.size(); ++j ) {
+                v[j] = round( v[j] );
+            }
+        }
+    }
+    P.setClipWindow( 0.0f, (float) (c_height - 1),
+                     0.0f, (float) (c_width - 1) );
+
+    cout << setprecision( 6 );
+    cout << "{" << endl;
+    cout << "  \"seed\": " << seed << "," << endl;
+    cout << "  \"reps\": " << reps << "," << endl;
+    cout << "  \"arithmetic\": \"" << (fixedPoint ? "fixed" : "float")
+         << "\"," << endl;
+    cout << "  \"canvas\": [ " << c_width << ", " << c_height << " ],"
+         << endl;
+    runSparse( P, w[2] );
+    runStream( P, w[2] );
+    runTiles( w[2], reps );
+    runLines( P, w[2], reps );
+    runCurves( P, reps );
+    runScene( P, w[1], reps );
+    runRedraw( P, w[2] );
+    runWide( P );
+
+    cout << "  \"workloads\": [" << endl;
+
+    for( int i = 0; i < 4; ++i ) {
+
+        // keep the fastest of the repetitions for each stage
+        P.resetStats();
+        Timing best = runOnce( P, w[i], fixedPoint );
+        for( int r = 1; r < reps; ++r ) {
+            P.resetStats();
+            Timing t = runOnce( P, w[i], fixedPoint );
+            best.transform = min( best.transform, t.transform );
+            best.clip      = min( best.clip, t.clip );
+            best.fill      = min( best.fill, t.fill );
+            best.output    = min( best.output, t.output );
+        }
+
+        double total = best.transform + best.clip + best.fill + best.output;
+
+        cout << "    {" << endl;
+        cout << "      \"name\": \"" << w[i].name << "\"," << endl;
+        cout << "      \"polygons\": " << best.polys << "," << endl;
+        cout << "      \"emitted\": " << best.emitted << "," << endl;
+        cout << "      \"pixels\": " << best.pixels << "," << endl;
+        cout << "      \"stages\": {" << endl;
+        stageJSON( "transform", best.transform, best.polys, best.pixels,
+                   false );
+        stageJSON( "clip", best.clip, best.polys, best.pixels, false );
+        stageJSON( "fill", best.fill, best.polys, best.pixels, false );
+        stageJSON( "output", best.output, best.polys, best.pixels, false );
+        stageJSON( "total", total, best.polys, best.pixels, true );
+#if defined(PIPELINE_STATS)
+        cout << "      }," << endl;
+        cout << "      \"pipeline_stats\": ";
+        writeStatsJSON( cout, P.stats(), 6 );
+        cout << endl;
+#else
+        cout << "      }" << endl;
+#endif
+        cout << "    }" << (i < 3 ? "," : "") << endl;
+    }
+
+    cout << "  ]" << endl;
+    cout << "}" << endl;
+
+    return( failed ? 1 : 0 );
+}
@@ -0,0 +1,83 @@
+//
+//  imgdiff.cpp
+//
+//  Compare two PPM images produced by the headless renderer.
+//
+//  Reports the number of differing pixels, the largest per-channel
+//  difference, and the bounding box of the differences (in Canvas
+//  coordinates, origin at the lower left) as a single line of JSON.
+//  Optionally writes a mask image showing where the images differ.
+//
+//  Usage:  imgdiff [-edges] expected.ppm actual.ppm [mask.ppm]
+//
+//  Exit status is 0 if the images are identical, 1 if they differ,
+//  and 2 if either image could not be read.  With -edges, images that
+//  differ only on the edges of shapes (see Framebuffer::compare()) also
+//  count as the same; this is the tolerance used when comparing two
+//  different rasterizers, such as the CPU and GPU fill backends.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "Framebuffer.h"
+
+using namespace std;
+
+///
+/// Main program
+///
+/// @param argc   command-line argument count
+/// @param argv   command-line argument strings
+///
+int main( int argc, char *argv[] )
+{
+    bool edges = false;
+    if( argc > 1 && strcmp( argv[1], "-edges" ) == 0 ) {
+        edges = true;
+        --argc;
+        ++argv;
+    }
+
+    if( argc < 3 || argc > 4 ) {
+        cerr << "usage: imgdiff [-edges] expected.ppm actual.ppm [mask.ppm]"
+             << endl;
+        exit( 2 );
+    }
+
+    Framebuffer expected, actual, mask;
+
+    if( !expected.readPPM( argv[1] ) || !actual.readPPM( argv[2] ) ) {
+        exit( 2 );
+    }
+
+    ImageDiff diff;
+    expected.compare( actual, diff, argc > 3 ? &mask : 0 );
+
+    cout << "{ \"expected\": \"" << argv[1] << "\", \"actual\": \""
+         << argv[2] << "\"";
+
+    if( diff.sizeMismatch ) {
+        cout << ", \"size_mismatch\": [ [ " << expected.getWidth() << ", "
+             << expected.getHeight() << " ], [ " << actual.getWidth()
+             << ", " << actual.getHeight() << " ] ] }" << endl;
+        return 1;
+    }
+
+    cout << ", \"differing_pixels\": " << diff.count
+         << ", \"edge_pixels\": " << diff.edgeCount
+         << ", \"max_delta\": " << diff.maxDelta;
+    if( diff.count > 0 ) {
+        cout << ", \"bbox\": [ " << diff.xmin << ", " << diff.ymin << ", "
+             << diff.xmax << ", " << diff.ymax << " ]";
+    }
+    cout << " }" << endl;
+
+    if( argc > 3 && !mask.writePPM( argv[3] ) ) {
+        exit( 2 );
+    }
+
+    long counted = edges ? diff.count - diff.edgeCount : diff.count;
+    return counted > 0 ? 1 : 0;
+}
@@ -0,0 +1,362 @@
+//
+//  render.cpp
+//
+//  Headless renderer for the 2D Pipeline test scenes.
+//
+//  Runs drawObjects() from the application's Models module for each
+//  of the test images, converts the resulting Canvas pixel stream into
+//  a Framebuffer, and writes one image per scene.  No window or GL
+//  context is created, so this runs on machines without a GPU.
+//
+//  Usage:  render [-o dir] [-png] [-fixed] [-stats] [-gpu]
+//                 [-shaders dir] [image# ...]
+//
+//  Images are named sceneN.ppm (or sceneN.png) in the output directory
+//  (default ".").  With no image numbers, all N_IMAGES scenes are drawn.
+//  -fixed draws with the Pipeline's 16.16 fixed-point arithmetic.
+//  -stats also writes the Pipeline's counters and stage times for each
+//  scene to sceneN.json (this needs a PIPELINE_STATS build).
+//
+//  -gpu fills the polygons with the Pipeline's GPU backend instead (see
+//  StencilFill.h), drawing into a framebuffer object in the context of
+//  a hidden GLFW window and reading the image back with glReadPixels().
+//  This needs the render-gpu build (compiled with RENDER_GPU), and runs
+//  without a GPU under Mesa's llvmpipe:  set LIBGL_ALWAYS_SOFTWARE=1.
+//  The shaders are read from ../code, or from the -shaders directory.
+//
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Pipeline.h"
+#include "Models.h"
+#include "Framebuffer.h"
+
+#if defined(RENDER_GPU)
+#include "ShaderSetup.h"
+#include "StencilFill.h"
+#include "Utils.h"
+#endif
+
+using namespace std;
+
+//
+// Globals normally supplied by the Application module; Models.cpp
+// refers to them when it sets up each scene.
+//
+
+int w_width  = 501;
+int w_height = 501;
+GLFWwindow *w_window = NULL;
+
+#if defined(RENDER_GPU)
+
+//
+// GL objects used by -gpu
+//
+
+static GLuint program, vao;
+static GLuint fbo, rbuffers[2];
+static StencilFill gpuFill;
+
+///
+/// gpuInit() - create a hidden window for its GL context, the shader
+///     program, and a framebuffer object to draw into
+///
+/// @param shaders   directory holding the shader files
+///
+/// @return true on success
+///
+static bool gpuInit( const string &shaders )
+{
+    if( !glfwInit() ) {
+        cerr << "Can't initialize GLFW!" << endl;
+        return false;
+    }
+
+    // the same context the application asks for, but never shown
+    glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 3 );
+    glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 2 );
+    glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
+    glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+    glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+
+    w_window = glfwCreateWindow( w_width, w_height, "render", NULL, NULL );
+    if( !w_window ) {
+        cerr << "GLFW window create failed!" << endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent( w_window );
+
+    GLenum err = glewInit();
+    if( err != GLEW_OK ) {
+        cerr << "GLEW error: " << glewGetErrorString(err) << endl;
+        glfwTerminate();
+        return false;
+    }
+
+    ShaderError error;
+    string vs = shaders + "/v150.vert";
+    string fs = shaders + "/v150.frag";
+    program = shaderSetup( vs.c_str(), fs.c_str(), &error );
+    if( !program ) {
+        cerr << "Error setting up shaders - " << errorString(error) << endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glGenVertexArrays( 1, &vao );
+    glBindVertexArray( vao );
+
+    // draw into a framebuffer object, not the window:  the pixels of a
+    // hidden window need not exist
+    glGenRenderbuffers( 2, rbuffers );
+    glBindRenderbuffer( GL_RENDERBUFFER, rbuffers[0] );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, w_width, w_height );
+    glBindRenderbuffer( GL_RENDERBUFFER, rbuffers[1] );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
+                           w_width, w_height );
+
+    glGenFramebuffers( 1, &fbo );
+    glBindFramebuffer( GL_FRAMEBUFFER, fbo );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_RENDERBUFFER, rbuffers[0] );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_RENDERBUFFER, rbuffers[1] );
+    if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) !=
+        GL_FRAMEBUFFER_COMPLETE ) {
+        cerr << "Can't set up the framebuffer object" << endl;
+        glfwTerminate();
+        return false;
+    }
+
+    // the same state the application sets up
+    glViewport( 0, 0, w_width, w_height );
+    glEnable( GL_DEPTH_TEST );
+    glClearColor( 0.0, 0.0, 0.0, 1.0 );
+    glDepthFunc( GL_LEQUAL );
+    glClearDepth( 1.0f );
+    glClearStencil( 0 );
+
+    checkErrors( "gpuInit" );
+    return true;
+}
+
+///
+/// gpuDraw() - fill the polygons the Pipeline recorded on the GPU, and
+///     read the result back
+///
+/// @param P    the Pipeline
+/// @param fb   receives the image
+///
+static void gpuDraw( const Pipeline &P, Framebuffer &fb )
+{
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+             GL_STENCIL_BUFFER_BIT );
+
+    // as in the application's display()
+    glUseProgram( program );
+    GLuint sf = glGetUniformLocation( program, "sf" );
+    glUniform2f( sf, 2.0f / (w_width - 1.0f), 2.0f / (w_height - 1.0f) );
+
+    gpuFill.draw( P, program, "vPosition", "vColor" );
+
+    vector<unsigned char> pixels( (size_t) w_width * w_height * 4 );
+    glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+    glReadPixels( 0, 0, w_width, w_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                  &pixels[0] );
+    checkErrors( "gpuDraw" );
+
+    // the rows come back bottom to top, as the Canvas numbers them
+    const unsigned char *p = &pixels[0];
+    for( int y = 0; y < w_height; ++y ) {
+        for( int x = 0; x < w_width; ++x, p += 4 ) {
+            Color c = { p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, 1.0f };
+            fb.setPixel( x, y, c );
+        }
+    }
+}
+
+///
+/// gpuRelease() - undo gpuInit()
+///
+static void gpuRelease( void )
+{
+    gpuFill.release();
+    glDeleteFramebuffers( 1, &fbo );
+    glDeleteRenderbuffers( 2, rbuffers );
+    glDeleteVertexArrays( 1, &vao );
+    glDeleteProgram( program );
+    glfwDestroyWindow( w_window );
+    glfwTerminate();
+}
+
+#else
+
+//
+// Models.cpp sets the window title for each scene.  We have no window
+// and don't link against GLFW, so this does nothing.
+//
+void glfwSetWindowTitle( GLFWwindow *, const char * )
+{
+}
+
+//
+// Without RENDER_GPU there is no GL to draw with
+//
+
+static bool gpuInit( const string & )
+{
+    cerr << "error: -gpu needs the render-gpu build (see Makefile)" << endl;
+    return false;
+}
+
+static void gpuDraw( const Pipeline &, Framebuffer & )
+{
+}
+
+static void gpuRelease( void )
+{
+}
+
+#endif
+
+///
+/// Main program
+///
+/// @param argc   command-line argument count
+/// @param argv   command-line argument strings
+///
+int main( int argc, char *argv[] )
+{
+    string outdir = ".";
+    bool png = false;
+    bool fixedPoint = false;
+    bool stats = false;
+    bool gpu = false;
+    string shaders = "../code";
+    vector<int> scenes;
+
+    for( int i = 1; i < argc; ++i ) {
+        if( strcmp( argv[i], "-o" ) == 0 && i + 1 < argc ) {
+            outdir = argv[++i];
+        } else if( strcmp( argv[i], "-png" ) == 0 ) {
+            png = true;
+        } else if( strcmp( argv[i], "-fixed" ) == 0 ) {
+            fixedPoint = true;
+        } else if( strcmp( argv[i], "-stats" ) == 0 ) {
+            stats = true;
+        } else if( strcmp( argv[i], "-gpu" ) == 0 ) {
+            gpu = true;
+        } else if( strcmp( argv[i], "-shaders" ) == 0 && i + 1 < argc ) {
+            shaders = argv[++i];
+        } else {
+            char *endptr;
+            long n = strtol( argv[i], &endptr, 10 );
+            if( endptr == argv[i] || *endptr != '\0' ||
+                n < 0 || n >= N_IMAGES ) {
+                cerr << "usage: " << argv[0]
+                     << " [-o dir] [-png] [-fixed] [-stats] [-gpu]"
+                     << " [-shaders dir] [image# ...]" << endl;
+                exit( 1 );
+            }
+            scenes.push_back( n );
+        }
+    }
+
+    if( scenes.empty() ) {
+        for( int n = 0; n < N_IMAGES; ++n ) {
+            scenes.push_back( n );
+        }
+    }
+
+    Pipeline *pipeline = new Pipeline( w_width, w_height );
+    createObject( *pipeline );
+    if( fixedPoint ) {
+        pipeline->setArithmetic( ArithFixed );
+    }
+
+    if( gpu ) {
+        if( !gpuInit( shaders ) ) {
+            exit( 1 );
+        }
+        pipeline->setBackend( FillGPU );
+    }
+
+#if !defined(PIPELINE_STATS)
+    if( stats ) {
+        cerr << "warning: built without PIPELINE_STATS, "
+             << "all counters will be zero" << endl;
+    }
+#endif
+
+    // the application clears to black before drawing the points
+    Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
+    Framebuffer fb( w_width, w_height );
+
+    int status = 0;
+
+    for( size_t i = 0; i < scenes.size(); ++i ) {
+        which = scenes[i];
+        pipeline->resetStats();
+        drawObjects( *pipeline );
+
+        fb.clear( black );
+        long outside = 0;
+        if( gpu ) {
+            gpuDraw( *pipeline, fb );
+        } else {
+            outside = fb.drawPixels( pipeline->numVertices(),
+                                     pipeline->getVertices(),
+                                     pipeline->getColors() );
+        }
+
+        char name[32];
+        sprintf( name, "/scene%d.%s", which, png ? "png" : "ppm" );
+        string path = outdir + name;
+
+        bool ok = png ? fb.writePNG( path.c_str() )
+                      : fb.writePPM( path.c_str() );
+        if( !ok ) {
+            status = 1;
+            continue;
+        }
+
+        if( gpu ) {
+            cout << path << ": " << pipeline->gpuPolygons().size()
+                 << " polygons";
+        } else {
+            cout << path << ": " << pipeline->numVertices() << " pixels";
+        }
+        if( outside > 0 ) {
+            cout << " (" << outside << " outside the canvas)";
+        }
+        cout << endl;
+
+        if( stats ) {
+            sprintf( name, "/scene%d.json", which );
+            ofstream js( (outdir + name).c_str() );
+            if( !js ) {
+                cerr << "can't write " << outdir + name << endl;
+                status = 1;
+                continue;
+            }
+            writeStatsJSON( js, pipeline->stats() );
+            js << endl;
+        }
+    }
+
+    if( gpu ) {
+        gpuRelease();
+    }
+
+    delete pipeline;
+    return status;
+}